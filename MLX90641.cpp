@@ -25,50 +25,207 @@
 // 3.3V - VDD
 
 #include <Wire.h>
+#include <stddef.h>
 #include "MLX90641.h"
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Preferences.h>
+#endif
+
+// Largest sequential read that fits in the platform's Wire receive buffer (in bytes)
+#if defined(I2C_BUFFER_LENGTH)  // ESP32 core
+#define WIRE_BUFFER_BYTES I2C_BUFFER_LENGTH
+#elif defined(BUFFER_LENGTH)    // AVR core
+#define WIRE_BUFFER_BYTES BUFFER_LENGTH
+#else
+#define WIRE_BUFFER_BYTES 32
+#endif
+// requestFrom() takes the byte count as a uint8_t, so a burst is also capped to 127 words (254 bytes)
+#if (BLOCK_SIZE < WIRE_BUFFER_BYTES / 2) && (BLOCK_SIZE <= 127)
+#define BURST_WORDS BLOCK_SIZE               // words per I2C read transaction
+#elif (WIRE_BUFFER_BYTES / 2 <= 127)
+#define BURST_WORDS (WIRE_BUFFER_BYTES / 2)  // words per I2C read transaction
+#else
+#define BURST_WORDS 127                      // words per I2C read transaction
+#endif
+static_assert(BURST_WORDS >= 1 && 2 * BURST_WORDS <= 255, "2 * BURST_WORDS must fit the uint8_t length of requestFrom()");
+
+#define SLOT_FRESH 0x04  // sharedSlot flag: the shared slot holds a frame the consumer has not seen
+
+// Stage timing hooks (PROFILE_PIPELINE). They compile to nothing otherwise.
+#ifdef PROFILE_PIPELINE
+#if !defined(ARDUINO)
+#include <chrono>
+#endif
+// Adds the time until the end of the enclosing block to a stage (safe with early returns)
+struct MLX90641_StageTimer {
+  MLX90641_Profiler &prof;
+  uint8_t stage;
+  uint32_t t0;
+  MLX90641_StageTimer(MLX90641_Profiler &p, uint8_t s) : prof(p), stage(s), t0(MLX90641_Profiler::ticks()) {}
+  ~MLX90641_StageTimer() { prof.accumulate(stage, MLX90641_Profiler::ticks() - t0); }
+};
+#define PROFILE_SCOPE(stage) MLX90641_StageTimer stageTimer(profile, stage)
+#define PROFILE_MARK() uint32_t profileLap = MLX90641_Profiler::ticks()
+#define PROFILE_LAP(stage) \
+  do { \
+    uint32_t now = MLX90641_Profiler::ticks(); \
+    profile.accumulate(stage, now - profileLap); \
+    profileLap = now; \
+  } while (0)
+#define PROFILE_BEGIN() profile.beginFrame()
+#define PROFILE_END() profile.endFrame()
+#else
+#define PROFILE_SCOPE(stage)
+#define PROFILE_MARK()
+#define PROFILE_LAP(stage)
+#define PROFILE_BEGIN()
+#define PROFILE_END()
+#endif
 
-MLX90641::MLX90641()
+// 4-lane float vectors for compensateSoA_vector(): SSE2 (x86 hosts) or NEON (64-bit ARM hosts).
+// Other targets (ESP32, ESP32-S3: PIE has no float lanes, AVR) run the scalar reference instead.
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SOA_LANES 4
+typedef __m128 soa_f;  // 4 floats
+typedef __m128 soa_m;  // 4 lane masks
+static inline soa_f soa_load(const float *p) { return _mm_loadu_ps(p); }
+static inline void soa_store(float *p, soa_f v) { _mm_storeu_ps(p, v); }
+static inline soa_f soa_set(float x) { return _mm_set1_ps(x); }
+static inline soa_f soa_raw(const int16_t *p) {  // 4 signed raw words to floats
+  __m128i w = _mm_loadl_epi64((const __m128i *)p);
+  return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(w, w), 16));
+}
+static inline soa_f soa_add(soa_f a, soa_f b) { return _mm_add_ps(a, b); }
+static inline soa_f soa_sub(soa_f a, soa_f b) { return _mm_sub_ps(a, b); }
+static inline soa_f soa_mul(soa_f a, soa_f b) { return _mm_mul_ps(a, b); }
+static inline soa_f soa_div(soa_f a, soa_f b) { return _mm_div_ps(a, b); }
+static inline soa_f soa_max(soa_f a, soa_f b) { return _mm_max_ps(a, b); }
+static inline soa_f soa_sqrt(soa_f a) { return _mm_sqrt_ps(a); }
+static inline soa_m soa_ge(soa_f a, soa_f b) { return _mm_cmpge_ps(a, b); }
+static inline soa_m soa_lt(soa_f a, soa_f b) { return _mm_cmplt_ps(a, b); }
+static inline soa_m soa_and(soa_m a, soa_m b) { return _mm_and_ps(a, b); }
+static inline soa_f soa_select(soa_m m, soa_f a, soa_f b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SOA_LANES 4
+typedef float32x4_t soa_f;  // 4 floats
+typedef uint32x4_t soa_m;   // 4 lane masks
+static inline soa_f soa_load(const float *p) { return vld1q_f32(p); }
+static inline void soa_store(float *p, soa_f v) { vst1q_f32(p, v); }
+static inline soa_f soa_set(float x) { return vdupq_n_f32(x); }
+static inline soa_f soa_raw(const int16_t *p) { return vcvtq_f32_s32(vmovl_s16(vld1_s16(p))); }  // 4 signed raw words to floats
+static inline soa_f soa_add(soa_f a, soa_f b) { return vaddq_f32(a, b); }
+static inline soa_f soa_sub(soa_f a, soa_f b) { return vsubq_f32(a, b); }
+static inline soa_f soa_mul(soa_f a, soa_f b) { return vmulq_f32(a, b); }
+static inline soa_f soa_div(soa_f a, soa_f b) { return vdivq_f32(a, b); }
+static inline soa_f soa_max(soa_f a, soa_f b) { return vmaxq_f32(a, b); }
+static inline soa_f soa_sqrt(soa_f a) { return vsqrtq_f32(a); }
+static inline soa_m soa_ge(soa_f a, soa_f b) { return vcgeq_f32(a, b); }
+static inline soa_m soa_lt(soa_f a, soa_f b) { return vcltq_f32(a, b); }
+static inline soa_m soa_and(soa_m a, soa_m b) { return vandq_u32(a, b); }
+static inline soa_f soa_select(soa_m m, soa_f a, soa_f b) { return vbslq_f32(m, a, b); }
+#endif
+
+char MLX90641::frameBuffer[FRAME_BUFFER_SIZE] __attribute__((aligned(16)));  // shared by all sensors (printFrame() formats one frame at a time)
+uint8_t MLX90641::neighbours[NUM_PIXELS][4];  // shared by all sensors (same 16x12 layout)
+
+MLX90641::MLX90641(TwoWire &wire, uint8_t addr)
 { 
+	bus = &wire;                         // I2C bus of this sensor
+	i2cAddr = addr;                      // I2C address of this sensor
 	Vdd = 0.0;                           // to hold calculated Vdd (measured sensor operating voltage)
 	Vdd_25 = 0;                          // to store Vdd at 25°C
 	K_Vdd = 0;                           // to store K_Vdd
 	Ta = 0.0;                            // calculated Ta (ambient temperature)
 	Kgain = 0.0;                         // Kgain coefficient
+	for (int i = 0; i < EEPROM_HEADER_WORDS; ++i) eeData[i]=0;
+	eeImage=NULL;                        // no EEPROM dump outside calibrate()
+	alphaShift=0.f;                      // nothing taken off pixCal.alpha[] yet
 	for (int i = 0; i < NUM_PIXELS; ++i) {
-		pix_OS_ref_SP0[i]=0;	         // pixel offset reference sp0
-		pix_OS_ref_SP1[i]=0;	         // pixel offset reference sp1
-		alpha_pixel[i]=0.f;		         // pixel sensitivity
-		Kta[i]=0.f;                      // Kta[i,j] coefficients
-		Kv[i]=0.f;                       // Kv[i,j] coefficients
+		pixCal.alpha[i]=0.f;             // pixel sensitivity
+		pixCal.offset[0][i]=0.f;         // pixel offset reference sp0
+		pixCal.offset[1][i]=0.f;         // pixel offset reference sp1
+		pixCal.Kta[i]=0.f;               // Kta[i,j] coefficients
+		pixCal.Kv[i]=0.f;                // Kv[i,j] coefficients
 		V_IR_compensated[i] = 0.f;       // V_IR_compensated values
 	    T_o[i]=0.f;                      // Matrix to hold final T_o[i] values
-		badPixels[i]=false;				 // Matrix to hold bad pixels
+		badPixels[i]=0;                  // defect map: no pixel flagged
 	}
+	for (int i = 0; i < FRAME_WORDS; ++i) frameData[i]=0;  // raw RAM snapshot
+	buildNeighbours();                   // shared neighbour table for fixBadPixels()
+	defectWindow=DEFECT_WINDOW;          // frames per defect statistics window
+	defectOutlier=DEFECT_OUTLIER_C;      // outlier threshold (°C)
+	for (int i = 0; i < NUM_PIXELS / 32; ++i) goodMask[i]=0;
+	resetDefectWindow();                 // defect statistics start empty
+	for (int i = 0; i < 3; ++i) deviceID[i]=0;  // set by calibrate() or deserializeCalibration()
+	eepromCRC=0;
+	pixCalValid=false;                   // per-pixel calibration table not built yet
+	subpage=0;                           // subpage of the last frame
+	Ta_r=0.f;                            // reflected temperature term of the last frame
+	dTa=0.f;                             // per-frame factors (see prepareFrame())
+	dVdd=0.f;
+	alpha_Ta=1.f;
+	V_CP=0.f;
+	KsTo_abs=1.f;
+	for (int i = 0; i < 8; ++i) CT_f[i]=0.f;
+	invEm=1.f;
+	CP_OS_ref=0.f;
+	refreshPolicy=REFRESH_EVERY_FRAME;   // Kgain, Vdd and Ta recomputed on every frame
+	refreshCount=0;
+	refreshDue=true;
+	refreshEveryN=REFRESH_N;
+	framesSinceRefresh=0;
+	refreshDriftTa=REFRESH_DRIFT_TA;
+	refreshDriftVdd=REFRESH_DRIFT_VDD;
+	refreshDriftKgain=REFRESH_DRIFT_KGAIN;
+	frameConstValid=false;               // constants of readVdd()/readTa()/readKgain() not parsed yet
+	controlReg=0;
+	controlRegValid=false;               // 0x800D not read yet
+	Resolution_EE=0;
+	Resolution_REG=0;
+	Resolution_corr=1.f;
+	Kv_PTAT_f=0.f;
+	Kt_PTAT_f=1.f;
+	V_PTAT25_f=0.f;
+	Alpha_PTAT=0.f;
+	GAIN_f=0.f;
+	subpageMode=SUBPAGE_LATEST;          // whole frame from the latest subpage
+	subpagesSeen=0;                      // no subpage compensated yet
+	for (int i = 0; i < NUM_PIXELS; ++i) {
+		T_o_SP[0][i]=0.f;                // last result of subpage 0
+		T_o_SP[1][i]=0.f;                // last result of subpage 1
+	}
+	state=MLX90641_IDLE;                 // acquisition engine stopped
+	frameCount=0;                        // frames completed by poll()
+	frameErrors=0;                       // frames abandoned by poll()
+	frameCallback=NULL;                  // no onFrame() callback
+	filter=NULL;                         // no temporal filter
+	recorder=NULL;                       // no event recorder
+	rawFrame=NULL;                       // poll() compensates every frame
+	statusWord=0;
+	rawSeq=0;
+	lastPoll=0;
+	busTime=0;
+	stepPos=0;
+	frameStore=NULL;                     // no frames published
+	setHistogram(STATS_HIST_MIN, STATS_HIST_MAX);  // frame histogram range
+	memset(roiMask, 0, sizeof(roiMask));  // no region of interest
+	publishSeq=0;
+	backSlot=0;                          // producer writes here
+	sharedSlot=1;                        // handed over on publish
+	frontSlot=2;                         // consumer reads here
+	frameValid=false;                    // no snapshot read yet
+	frameReadTime=0;                     // bus time of the last frame read (us)
+	streamEncodeTime=0;                  // encode time of the last streamFrame() (us)
+	eepromReadTime=0;                    // duration of the last EEPROM dump (us)
+	eepromRetries=0;                     // blocks re-read during the last EEPROM dump
 	KsTa=0.f;                            // KsTa coefficient
-	CT1=0;                               // Corner temperatures
-	CT2=0;                               // Corner temperatures
-	CT3=0;                               // Corner temperatures
-	CT4=0;                               // Corner temperatures
-	CT5=0;                               // Corner temperatures
-	CT6=0;                               // Corner temperatures
-	CT7=0;                               // Corner temperatures
-	CT8=0;                               // Corner temperatures
-	KsTo1=0.f;                           // KsTo coefficients
-	KsTo2=0.f;                           // KsTo coefficients
-	KsTo3=0.f;                           // KsTo coefficients
-	KsTo4=0.f;                           // KsTo coefficients
-	KsTo5=0.f;                           // KsTo coefficients
-	KsTo6=0.f;                           // KsTo coefficients
-	KsTo7=0.f;                           // KsTo coefficients
-	KsTo8=0.f;                           // KsTo coefficients
-	Alpha_cr1=0.f;                       // Alpha correction coefficients for each range
-	Alpha_cr2=0.f;                       // Alpha correction coefficients for each range
-	Alpha_cr3=0.f;                       // Alpha correction coefficients for each range
-	Alpha_cr4=0.f;                       // Alpha correction coefficients for each range
-	Alpha_cr5=0.f;                       // Alpha correction coefficients for each range
-	Alpha_cr6=0.f;                       // Alpha correction coefficients for each range
-	Alpha_cr7=0.f;                       // Alpha correction coefficients for each range
-	Alpha_cr8=0.f;                       // Alpha correction coefficients for each range
+	for (int i = 0; i < 8; ++i) {
+		CT[i]=0;                         // Corner temperatures
+		KsTo[i]=0.f;                     // KsTo coefficients
+		Alpha_cr[i]=0.f;                 // Alpha correction coefficients for each range
+	}
 	alpha_reference_row1=0.f;            // Alpha references for sensitivity adjustment
 	alpha_reference_row2=0.f;            // Alpha references for sensitivity adjustment
 	alpha_reference_row3=0.f;            // Alpha references for sensitivity adjustment
@@ -76,6 +233,8 @@ MLX90641::MLX90641()
 	alpha_reference_row5=0.f;            // Alpha references for sensitivity adjustment
 	alpha_reference_row6=0.f;            // Alpha references for sensitivity adjustment
 	Emissivity=1.0;                      // Emissivity coefficient (default: 1)
+	calSlope=CAL_SLOPE;                  // post-hoc calibration (can be changed at run time, e.g. to reprocess raw frames)
+	calIntercept=CAL_INT;
 	alpha_CP=0.f;                        // Sensitivity alpha_CP coefficient
 	pix_OS_ref_CP=0;                     // Offset CP (known in datasheet as Off_CP or pix_OS_ref_CP)
 	Kv_CP=0.f;                           // Kv CP coefficient, because there should be one of those for sure.
@@ -92,33 +251,54 @@ bool MLX90641::readEEPROMBlock(uint16_t startAddr, uint16_t numWords, uint16_t *
   // It will contain all the calibration data, such as per-pixel offsets, sensitivites,
   // temperature compensation coefficients, and other parameters essential to convert
   // the raw IR sensor readings into accurate temperature values.
-  for (uint16_t i = 0; i < numWords; i++) {
-    Wire.beginTransmission(MLX90641_ADDR);
-    uint16_t addr = startAddr + i;
-    Wire.write(addr >> 8);
-    Wire.write(addr & 0xFF);
-    if (Wire.endTransmission(false) != 0) return false;
-    if (Wire.requestFrom(MLX90641_ADDR, (uint8_t)2) != 2) return false;
-    uint8_t hi = Wire.read();
-    uint8_t lo = Wire.read();
-    dest[i] = ((uint16_t)hi << 8) | lo;
-    delayMicroseconds(5);  // small delay to help with reading at high I2C speeds
+  // The EEPROM is read in sequential blocks of BURST_WORDS words (BLOCK_SIZE, capped to the Wire buffer).
+  // A block that fails is re-read up to EEPROM_RETRIES times without restarting the whole dump.
+  unsigned long t0 = micros();
+  eepromRetries = 0;
+  if (dest == eeData) {
+    if (numWords > EEPROM_HEADER_WORDS) return false;  // eeData only holds the header: calibrate() reads the whole EEPROM
+    frameConstValid = false;                            // readVdd(), readTa() and readKgain() parse their constants again
   }
+  for (uint16_t i = 0; i < numWords; i += BURST_WORDS) {
+    uint16_t n = (numWords - i > BURST_WORDS) ? BURST_WORDS : numWords - i;  // words in this block
+    uint8_t attempt = 0;
+    while (!readWords(startAddr + i, n, &dest[i])) {
+      if (++attempt >= EEPROM_RETRIES) {
+        eepromReadTime = micros() - t0;
+#ifdef DEBUG
+        Serial.print("readEEPROMBlock() failed at address: 0x");
+        Serial.println(startAddr + i, HEX);
+#endif
+        return false;
+      }
+      eepromRetries++;
+      delayMicroseconds(50);  // let the bus settle before re-reading this block
+    }
+  }
+  eepromReadTime = micros() - t0;  // total time for the dump
+#ifdef DEBUG
+  Serial.print("readEEPROMBlock() words: ");
+  Serial.print(numWords);
+  Serial.print(", retries: ");
+  Serial.print(eepromRetries);
+  Serial.print(", time (us): ");
+  Serial.println(eepromReadTime);
+#endif
   return true;
 }
 
 // Check if new data is available
 bool MLX90641::isNewDataAvailable() {
-  Wire.beginTransmission(MLX90641_ADDR);
-  Wire.write(STATUS_ADDR >> 8);
-  Wire.write(STATUS_ADDR & 0xFF);
-  if (Wire.endTransmission(false) != 0) return false;
+  bus->beginTransmission(i2cAddr);
+  bus->write(STATUS_ADDR >> 8);
+  bus->write(STATUS_ADDR & 0xFF);
+  if (bus->endTransmission(false) != 0) return false;
 
-  Wire.requestFrom(MLX90641_ADDR, 2);
-  if (Wire.available() < 2) return false;
+  bus->requestFrom(i2cAddr, (uint8_t)2);
+  if (bus->available() < 2) return false;
 
-  uint8_t hi = Wire.read();
-  uint8_t lo = Wire.read();
+  uint8_t hi = bus->read();
+  uint8_t lo = bus->read();
   uint16_t status = (hi << 8) | lo;
 
   return (status & (1 << 3)) != 0;
@@ -126,70 +306,150 @@ bool MLX90641::isNewDataAvailable() {
 
 // Clear the new data available bit (must be done after each read)
 bool MLX90641::clearNewDataBit() {
-  Wire.beginTransmission(MLX90641_ADDR);
-  Wire.write(STATUS_ADDR >> 8);
-  Wire.write(STATUS_ADDR & 0xFF);
-  Wire.write(0xFF);  // High byte
-  Wire.write(0xFF);  // Low byte
-  return (Wire.endTransmission() == 0);
+  uint16_t status = readAddr_unsigned(STATUS_ADDR);
+  if (status == 0xFC19) return false;  // bus error (-999)
+  return writeStatus(status & ~(1 << 3));  // bit 3 = new data available; the other bits are written back unchanged
+}
+
+// Write the status register in one transaction
+bool MLX90641::writeStatus(uint16_t status) {
+  bus->beginTransmission(i2cAddr);
+  bus->write(STATUS_ADDR >> 8);
+  bus->write(STATUS_ADDR & 0xFF);
+  bus->write(status >> 8);    // High byte
+  bus->write(status & 0xFF);  // Low byte
+  return (bus->endTransmission() == 0);
 }
 
 // Read a 16-bit unsigned integer from RAM or EEPROM at the address readByte:
 uint16_t MLX90641::readAddr_unsigned(const uint16_t readByte) {
-  Wire.beginTransmission(MLX90641_ADDR);
-  Wire.write(readByte >> 8);    // MSB of VDD_ADDR
-  Wire.write(readByte & 0xFF);  // LSB of VDD_ADDR
-  if (Wire.endTransmission(false) != 0) return -999;
-  Wire.requestFrom(MLX90641_ADDR, 2);
-  if (Wire.available() < 2) return -999;
-  uint8_t hi = Wire.read();
-  uint8_t lo = Wire.read();
+  PROFILE_SCOPE(MLX90641_STAGE_REGISTER);
+  bus->beginTransmission(i2cAddr);
+  bus->write(readByte >> 8);    // MSB of VDD_ADDR
+  bus->write(readByte & 0xFF);  // LSB of VDD_ADDR
+  if (bus->endTransmission(false) != 0) return -999;
+  bus->requestFrom(i2cAddr, (uint8_t)2);
+  if (bus->available() < 2) return -999;
+  uint8_t hi = bus->read();
+  uint8_t lo = bus->read();
   uint16_t raw = (uint16_t)((hi << 8) | lo);
   return raw;
 }
 
 // Read a 16-bit signed integer from RAM or EEPROM at the address readByte:
 int16_t MLX90641::readAddr_signed(const uint16_t readByte) {
-  Wire.beginTransmission(MLX90641_ADDR);
-  Wire.write(readByte >> 8);    // MSB of VDD_ADDR
-  Wire.write(readByte & 0xFF);  // LSB of VDD_ADDR
-  if (Wire.endTransmission(false) != 0) return -999;
-  Wire.requestFrom(MLX90641_ADDR, 2);
-  if (Wire.available() < 2) return -999;
-  uint8_t hi = Wire.read();
-  uint8_t lo = Wire.read();
+  PROFILE_SCOPE(MLX90641_STAGE_REGISTER);
+  bus->beginTransmission(i2cAddr);
+  bus->write(readByte >> 8);    // MSB of VDD_ADDR
+  bus->write(readByte & 0xFF);  // LSB of VDD_ADDR
+  if (bus->endTransmission(false) != 0) return -999;
+  bus->requestFrom(i2cAddr, (uint8_t)2);
+  if (bus->available() < 2) return -999;
+  uint8_t hi = bus->read();
+  uint8_t lo = bus->read();
   int16_t raw = (int16_t)((hi << 8) | lo);
   return raw;
 }
 
-// Read a 16-bit unsigned integer from eeData at the address addr:
+// Read a 16-bit unsigned integer from the EEPROM dump at the address addr. Outside calibrate(), only the header
+// (eeData) is kept: the per-pixel words read as 0.
 uint16_t MLX90641::readEEPROM_unsigned(uint16_t addr) {
   if (addr < 0x2400 || addr >= (0x2400 + EEPROM_WORDS)) {
     // Address invalid or out of bounds
     return 0;
   }
+  if (eeImage != NULL) return eeImage[addr - 0x2400];
+  if (addr >= 0x2400 + EEPROM_HEADER_WORDS) return 0;
   return eeData[addr - 0x2400];
 }
 
-// Read a 16-bit signed integer from eeData at the address addr:
-int16_t MLX90641::readEEPROM_signed(uint16_t addr) {  // helper function to read signed integer from eeData
+// Read a 16-bit signed integer from the EEPROM dump at the address addr:
+int16_t MLX90641::readEEPROM_signed(uint16_t addr) {  // helper function to read signed integer from the EEPROM dump
   return (int16_t)MLX90641::readEEPROM_unsigned(addr);
 }
 
-float MLX90641::readVdd() {  //(From 11.1.1, worked example in 11.2.2.2)
+// Read numWords sequential words starting at startAddr, in bursts sized to the Wire buffer.
+// The MLX90641 auto-increments the address, so one address write + one read covers a whole burst.
+bool MLX90641::readWords(uint16_t startAddr, uint16_t numWords, uint16_t *dest) {
+  while (numWords > 0) {
+    uint16_t n = (numWords > BURST_WORDS) ? BURST_WORDS : numWords;  // words in this burst (2 * n fits a uint8_t)
+    bus->beginTransmission(i2cAddr);
+    bus->write(startAddr >> 8);
+    bus->write(startAddr & 0xFF);
+    if (bus->endTransmission(false) != 0) return false;
+    if (bus->requestFrom(i2cAddr, (uint8_t)(2 * n)) != 2 * n) return false;
+    for (uint16_t i = 0; i < n; i++) {
+      uint8_t hi = bus->read();
+      uint8_t lo = bus->read();
+      dest[i] = ((uint16_t)hi << 8) | lo;
+    }
+    startAddr += n;
+    dest += n;
+    numWords -= n;
+  }
+  return true;
+}
+
+// Burst-read the frame RAM (0x0400..0x05BF) into frameData[].
+// All pixel, CP, Vdd, PTAT, VBE and gain words used by readTempC() come from this one snapshot.
+bool MLX90641::readFrame() {
+  unsigned long t0 = micros();
+  frameValid = readWords(FRAME_ADDR, FRAME_WORDS, frameData);
+  frameReadTime = micros() - t0;  // bus time for the whole frame
+#ifdef DEBUG
+  Serial.print("readFrame() bus time (us): ");
+  Serial.println(frameReadTime);
+#endif
+  return frameValid;
+}
+
+// Read a 16-bit unsigned integer from frameData at the address addr (falls back to the bus if there is no snapshot):
+uint16_t MLX90641::readFrame_unsigned(uint16_t addr) {
+  if (!frameValid || addr < FRAME_ADDR || addr >= (FRAME_ADDR + FRAME_WORDS)) {
+    return readAddr_unsigned(addr);  // outside the snapshot: read from the device
+  }
+  return frameData[addr - FRAME_ADDR];
+}
+
+// Read a 16-bit signed integer from frameData at the address addr:
+int16_t MLX90641::readFrame_signed(uint16_t addr) {
+  return (int16_t)MLX90641::readFrame_unsigned(addr);
+}
+
+// Parse the EEPROM-derived constants of readVdd(), readTa() and readKgain() once. The control register
+// is read once too: only setRefreshRate() writes it. The raw RAM words still come from each frame snapshot.
+void MLX90641::calcFrameConstants() {
+  if (!controlRegValid) {
+    controlReg = readAddr_unsigned(0x800D);
+    controlRegValid = (controlReg != (uint16_t)-999);  // retried on the next call after a bus error
+  }
   //Note: Resolution correction is not needed if you are sticking with the defaults of the device.
-  uint16_t Resolution_EE = (readEEPROM_unsigned(0x2433) & 0x0600) / 512;           // 11.1.18: Cal resolution is bits 10 and 9 at address 2433 (Figure 14) - Example 11.2.2.1
-  uint16_t Resolution_REG = (readAddr_unsigned(0x800D) & 0x0C00) / 1024;           // 11.2.2.1: Cal resolution is bits 10 and 9 at address 0x800D from memory (Figure 14) - Example 11.2.2.1
-  float Resolution_corr = two_to_the(Resolution_EE) / two_to_the(Resolution_REG);  // 2^Res_EE/2^Res_REG. this number should be 1 by default
-  // example value of Vdd reading from datasheet: 0xCB8A (-13430) (Table 10)
+  Resolution_EE = (readEEPROM_unsigned(0x2433) & 0x0600) / 512;                // 11.1.18: Cal resolution is bits 10 and 9 at address 2433 (Figure 14) - Example 11.2.2.1
+  Resolution_REG = (controlReg & 0x0C00) / 1024;                              // 11.2.2.1: Cal resolution is bits 10 and 9 at address 0x800D from memory (Figure 14) - Example 11.2.2.1
+  Resolution_corr = two_to_the(Resolution_EE) / two_to_the(Resolution_REG);  // 2^Res_EE/2^Res_REG. this number should be 1 by default
   K_Vdd = readEEPROM_signed(0x2427) & 0x07FF;   // K_Vdd register in EEPROM is 0x2427.
   if (K_Vdd > 1023) K_Vdd = K_Vdd - 2048;       // impose limits
   K_Vdd = K_Vdd * 32;                           // Multiply by 2^5. Example K_Vdd: -3136 (Table 11)
   Vdd_25 = readEEPROM_signed(0x2426) & 0x07FF;  // Vdd_25 register in EEPROM is 0x2426. Example number: -13568 (Table 11)
   if (Vdd_25 > 1023) Vdd_25 = Vdd_25 - 2048;
-  Vdd_25 = Vdd_25 * 32;                 // multiply by 2^5. Example value Vdd_25: -13568 (Table 11)
-  int16_t x = readAddr_signed(0x05AA);  // Vdd register in RAM is 0x05AA
-  if (x > 32767) x = x - 65536;
+  Vdd_25 = Vdd_25 * 32;                         // multiply by 2^5. Example value Vdd_25: -13568 (Table 11)
+  //Kv_PTAT is in 0x242A (fixed scale 3) and 0x242B (fixed scale 12). Example: 0.005615234 (Table 11.2.1.2)
+  int16_t Kv_PTAT = readEEPROM_signed(0x242B) & 0x07FF;
+  if (Kv_PTAT > 1023) Kv_PTAT = Kv_PTAT - 2048;          // impose limits
+  Kv_PTAT_f = (float)Kv_PTAT / 4096.0;                   // divide Kv_PTAT by 2^12 (float math, example in 11.2.2.3)
+  int16_t Kt_PTAT = readEEPROM_signed(0x242A) & 0x07FF;  // read Kt_PTAT from 0x242A
+  if (Kt_PTAT > 1023) Kt_PTAT = Kt_PTAT - 2048;          // impose limits
+  Kt_PTAT_f = (float)Kt_PTAT / 8.0;                      // divide by 2^3
+  V_PTAT25_f = 32 * (readEEPROM_unsigned(0x2428) & 0x07FF) + (readEEPROM_unsigned(0x2429) & 0x07FF);
+  Alpha_PTAT = (readEEPROM_unsigned(0x242C) & 0x07FF) / 128.0;  // divide answer by 2^7 (=128)
+  GAIN_f = 32 * (readEEPROM_unsigned(0x2424) & 0x07FF) + (readEEPROM_unsigned(0x2425) & 0x07FF);
+  frameConstValid = true;
+}
+
+float MLX90641::readVdd() {  //(From 11.1.1, worked example in 11.2.2.2)
+  if (!frameConstValid) calcFrameConstants();
+  // example value of Vdd reading from datasheet: 0xCB8A (-13430) (Table 10)
+  int16_t x = readFrame_signed(0x05AA);  // Vdd register in RAM is 0x05AA
   float Vdd_calc = (float)(((Resolution_corr * x - Vdd_25) / K_Vdd) + 3.3);  // final calculation for Vdd
 #ifdef DEBUG
   Serial.print("readVDD() Resolution_EE: ");
@@ -214,24 +474,13 @@ float MLX90641::readVdd() {  //(From 11.1.1, worked example in 11.2.2.2)
 }
 
 float MLX90641::readTa() {  // Read ambient temperature, datasheet, 11.1.2
-                  //Kv_PTAT is in 0x242A (fixed scale 3) and 0x242B (fixed scale 12). Example: 0.005615234 (Table 11.2.1.2)
-  int16_t Kv_PTAT = readEEPROM_signed(0x242B) & 0x07FF;
-  if (Kv_PTAT > 1023) Kv_PTAT = Kv_PTAT - 2048;              // impose limits
-  float Kv_PTAT_f = (float)Kv_PTAT / 4096.0;                 // divide Kv_PTAT by 2^12 (float math, example in 11.2.2.3)
-  int16_t Kt_PTAT = readEEPROM_signed(0x242A) & 0x07FF;      // read Kt_PTAT from 0x242A
-  if (Kt_PTAT > 1023) Kt_PTAT = Kt_PTAT - 2048;              // impose limits
-  float Kt_PTAT_f = (float)Kt_PTAT / 8.0;                    // divide by 2^3
-  int16_t Vdd_i = readAddr_signed(0x05AA);                   // Read Vdd again from RAM, address 0x05AA
-  if (Vdd_i > 32767) Vdd_i = Vdd_i - 65536;                  // impose limits
+  if (!frameConstValid) calcFrameConstants();
+  int16_t Vdd_i = readFrame_signed(0x05AA);                  // Read Vdd again from RAM, address 0x05AA
   float dV = ((float)Vdd_i - (float)Vdd_25) / (float)K_Vdd;  // calculate the change in voltage dV
-  uint16_t V_PTAT25 = 32 * (readEEPROM_unsigned(0x2428) & 0x07FF) + (readEEPROM_unsigned(0x2429) & 0x07FF);
-  int16_t V_PTAT = readAddr_signed(0x05A0);                                              // get V_PTAT at addr 0x05A0
-  if (V_PTAT > 32767) V_PTAT = V_PTAT - 65536;                                           // impose limits
-  int16_t V_BE = readAddr_signed(0x0580);                                                // get V_BE at addr 0x0580
-  if (V_BE > 32767) V_BE = V_BE - 65536;                                                 // impose limits
-  float Alpha_PTAT = (readEEPROM_unsigned(0x242C) & 0x07FF) / 128.0;                     // divide answer by 2^7 (=128)
+  int16_t V_PTAT = readFrame_signed(0x05A0);                                             // get V_PTAT at addr 0x05A0
+  int16_t V_BE = readFrame_signed(0x0580);                                               // get V_BE at addr 0x0580
   float V_PTATart = ((float)V_PTAT / ((float)V_PTAT * Alpha_PTAT + V_BE)) * 262144.0;    // multiply by 2^18 = 262144
-  float Ta_calc = ((V_PTATart / (1.0 + Kv_PTAT_f * dV) - V_PTAT25) / Kt_PTAT_f) + 25.0;  // final calculation for Ta
+  float Ta_calc = ((V_PTATart / (1.0 + Kv_PTAT_f * dV) - V_PTAT25_f) / Kt_PTAT_f) + 25.0;  // final calculation for Ta
 #ifdef DEBUG
   Serial.print("readTa() Ta: ");
   Serial.print(Ta_calc, 2);
@@ -242,13 +491,12 @@ float MLX90641::readTa() {  // Read ambient temperature, datasheet, 11.1.2
 }
 
 float MLX90641::readKgain() {  // calculate the Kgain coefficient, datasheet 11.1.7. This needs to be calculated once per frame, because it might change in RAM.
-  uint16_t GAIN = 32 * (readEEPROM_unsigned(0x2424) & 0x07FF) + (readEEPROM_unsigned(0x2425) & 0x07FF);
-  int16_t x = readAddr_signed(0x058A);        // example value: 9734
-  if (x > 32767) x = x - 65536;               // impose limits
-  float Kgain_calc = (float)GAIN / (float)x;  // final calculation for Kgain
+  if (!frameConstValid) calcFrameConstants();
+  int16_t x = readFrame_signed(0x058A);  // example value: 9734
+  float Kgain_calc = GAIN_f / (float)x;  // final calculation for Kgain
 #ifdef DEBUG
   Serial.print("readKgain() GAIN: ");
-  Serial.println(GAIN);  // example value: 9972 (11.2.2.4)
+  Serial.println(GAIN_f, 0);  // example value: 9972 (11.2.2.4)
   Serial.print("readKgain() Kgain: ");
   Serial.print(Kgain_calc, 8);
   Serial.println(", example value: 1.02445038");  // 11.2.2.4
@@ -257,11 +505,11 @@ float MLX90641::readKgain() {  // calculate the Kgain coefficient, datasheet 11.
   return Kgain_calc;
 }
 
-void MLX90641::readPixelOffset() {  // this function fills up the pixel offset variables: pix_OS_ref_SP0 and pix_OS_ref_SP1. datasheet 11.1.3
+void MLX90641::readPixelOffset() {  // this function fills up the pixel offset references pix_OS_ref_SP0 and pix_OS_ref_SP1 (pixCal.offset[]). datasheet 11.1.3
   // There are 2 pixel offset subpages, which have the memory dimensions 16 x 12 (no coincidences here.)
   // Subpage 1 starts at 0x2440 (words 0-F) and goes to 0x24F0 (words 0-F).
   // Subpage 2 starts at 0x2680 (words 0-F) and goes to 0x2730.
-  // These are all in the EEPROM, which has been read into memory already.
+  // These are all in the EEPROM, which calibrate() has read into memory already.
   uint16_t Offset_scale = (readEEPROM_unsigned(0x2410) & 0x07E0) / 32;                                        // divide by 2^5. Example value: 0/32 = 0.
   int16_t Offset_average = 32 * (readEEPROM_signed(0x2411) & 0x07FF) + (readEEPROM_signed(0x2412) & 0x07FF);  // this is Pix_ox_r1 in Table 11.2.1.2
   if (Offset_average > 32767) Offset_average = Offset_average - 65536;                                        // impose limits
@@ -271,51 +519,43 @@ void MLX90641::readPixelOffset() {  // this function fills up the pixel offset v
     if (offset_SP0 > 1023) offset_SP0 = offset_SP0 - 2048;                       // impose limits. Example value: -670 LSB (11.2.2.5.2)
     int16_t offset_SP1 = readEEPROM_signed(0x2680 + i) & 0x07FF;                 // get offset_SP1 (subpage 2, starting at 0x2680)
     if (offset_SP1 > 1023) offset_SP1 = offset_SP1 - 2048;                       // impose limits
-    pix_OS_ref_SP0[i] = Offset_average + offset_SP0 * two_to_the(Offset_scale);  // pix_OS_ref_SP0[i] = Offset_average + offset_SP0[i] * 2^Offset_scale
-    pix_OS_ref_SP1[i] = Offset_average + offset_SP1 * two_to_the(Offset_scale);  // pix_OS_ref_SP1[i] = Offset_average + offset_SP1[i] * 2^Offset_scale
+    pixCal.offset[0][i] = (int16_t)(Offset_average + offset_SP0 * two_to_the(Offset_scale));  // pix_OS_ref_SP0[i] = Offset_average + offset_SP0[i] * 2^Offset_scale
+    pixCal.offset[1][i] = (int16_t)(Offset_average + offset_SP1 * two_to_the(Offset_scale));  // pix_OS_ref_SP1[i] = Offset_average + offset_SP1[i] * 2^Offset_scale
   }
 #ifdef DEBUG
   Serial.print("readPixelOffset() pix_OS_ref_SP0[95]: ");
-  Serial.print(pix_OS_ref_SP0[95]);
+  Serial.print(pixCal.offset[0][95], 0);
   Serial.println(", example value: -673 LSB");  // 11.2.2.5.2
   Serial.print("readPixelOffset() pix_OS_ref_SP1[95]: ");
-  Serial.print(pix_OS_ref_SP1[95]);
+  Serial.print(pixCal.offset[1][95], 0);
   Serial.println(", example value: -671 LSB");  // 11.2.2.5.3
   Serial.println("Finished: read pixel offsets.");
 #endif
 }
 
-void MLX90641::readAlpha() {  // this function restores the sensitivity from EEPROM data (11.1.4), and fills alpha_pixel[].
+void MLX90641::readAlpha() {  // this function restores the sensitivity from EEPROM data (11.1.4), and fills pixCal.alpha[].
   // Sensitivity is divided into 6 ranges (1…32, 33…64 and so on) and for each range we store a reference value.
   // Pixel sensitivity (alpha) is stored in RAM, from 0x2500 to 0x25C0
   int16_t alpha_scale_row1 = ((readEEPROM_signed(0x2419) & 0x07E0) / 32) + 20;  // row 1
-  alpha_reference_row1 = (float)(readEEPROM_signed(0x241C) & 0x07FF) / (float)pow(2, (uint32_t)alpha_scale_row1);
+  alpha_reference_row1 = (float)(readEEPROM_signed(0x241C) & 0x07FF) / two_to_the(alpha_scale_row1);
   int16_t alpha_scale_row2 = (readEEPROM_signed(0x2419) & 0x001F) + 20;  // row 2
-  alpha_reference_row2 = (float)(readEEPROM_signed(0x241D) & 0x07FF) / (float)pow(2, (uint32_t)alpha_scale_row2);
+  alpha_reference_row2 = (float)(readEEPROM_signed(0x241D) & 0x07FF) / two_to_the(alpha_scale_row2);
   int16_t alpha_scale_row3 = ((readEEPROM_signed(0x241A) & 0x07E0) / 32) + 20;  // row 3
-  alpha_reference_row3 = (float)(readEEPROM_signed(0x241E) & 0x07FF) / (float)pow(2, (uint32_t)alpha_scale_row3);
+  alpha_reference_row3 = (float)(readEEPROM_signed(0x241E) & 0x07FF) / two_to_the(alpha_scale_row3);
   int16_t alpha_scale_row4 = (readEEPROM_signed(0x241A) & 0x001F) + 20;  // row 4
-  alpha_reference_row4 = (float)(readEEPROM_signed(0x241F) & 0x07FF) / (float)pow(2, (uint32_t)alpha_scale_row4);
+  alpha_reference_row4 = (float)(readEEPROM_signed(0x241F) & 0x07FF) / two_to_the(alpha_scale_row4);
   int16_t alpha_scale_row5 = ((readEEPROM_signed(0x241B) & 0x07E0) / 32) + 20;  // row 5
-  alpha_reference_row5 = (float)(readEEPROM_signed(0x2420) & 0x07FF) / (float)pow(2, (uint32_t)alpha_scale_row5);
+  alpha_reference_row5 = (float)(readEEPROM_signed(0x2420) & 0x07FF) / two_to_the(alpha_scale_row5);
   int16_t alpha_scale_row6 = (readEEPROM_signed(0x241B) & 0x001F) + 20;  // row 6
-  alpha_reference_row6 = (float)(readEEPROM_signed(0x2421) & 0x07FF) / (float)pow(2, (uint32_t)alpha_scale_row6);
-  // Sensitivity Max value for row 1 (pixels 1…32) is stored at EEPROM address 0x241C
-  for (int i = 0; i < 32; i++) alpha_pixel[i] = alpha_reference_row1 * (float)(readEEPROM_signed(0x2500 + i) & 0x07FF) / 2047.0;
-  // Sensitivity Max value for row 2 (pixels 33…64) is stored at EEPROM address 0x241D
-  for (int i = 32; i < 64; i++) alpha_pixel[i] = alpha_reference_row2 * (float)(readEEPROM_signed(0x2500 + i) & 0x07FF) / 2047.0;
-  // Sensitivity Max value for row 3 (pixels 65…96) is stored at EEPROM address 0x241E
-  for (int i = 64; i < 96; i++) alpha_pixel[i] = alpha_reference_row3 * (float)(readEEPROM_signed(0x2500 + i) & 0x07FF) / 2047.0;
-  // Sensitivity Max value for row 4 (pixels 97…128) is stored at EEPROM address 0x241F
-  for (int i = 96; i < 128; i++) alpha_pixel[i] = alpha_reference_row4 * (float)(readEEPROM_signed(0x2500 + i) & 0x07FF) / 2047.0;
-  // Sensitivity Max value for row 5 (pixels 129…160) is stored at EEPROM address 0x2420
-  for (int i = 128; i < 160; i++) alpha_pixel[i] = alpha_reference_row5 * (float)(readEEPROM_signed(0x2500 + i) & 0x07FF) / 2047.0;
-  // Sensitivity Max value for row 6 (pixels 161…192) is stored at EEPROM address 0x2421
-  for (int i = 160; i < 192; i++) alpha_pixel[i] = alpha_reference_row6 * (float)(readEEPROM_signed(0x2500 + i) & 0x07FF) / 2047.0;
-  // Read alpha_pixel (Pixel sensitivities, starting at address 0x2550) - 11.2.2.8
+  alpha_reference_row6 = (float)(readEEPROM_signed(0x2421) & 0x07FF) / two_to_the(alpha_scale_row6);
+  float alpha_reference[6] = { alpha_reference_row1, alpha_reference_row2, alpha_reference_row3,
+                               alpha_reference_row4, alpha_reference_row5, alpha_reference_row6 };
+  // Pixel sensitivity words (0x2500..0x25BF), scaled per range of 32 pixels - 11.2.2.8. calcPixelTable() CP-compensates them.
   for (int i = 0; i < NUM_PIXELS; i++) {
-    alpha_pixel[i] = readEEPROM_unsigned(0x2550 + i) & 0x07FF;  //11.2.2.8
+    float alpha_pixel = readEEPROM_unsigned(0x2500 + i) & 0x07FF;       // 11.2.2.8
+    pixCal.alpha[i] = alpha_reference[i / 32] * alpha_pixel / 2047.0f;  // 2^11 - 1 = 2047.0f
   }
+  alphaShift = 0.0f;  // not CP-compensated yet
 #ifdef DEBUG
   Serial.print("readAlpha() alpha_scale_row3: ");
   Serial.print(alpha_scale_row3);
@@ -324,13 +564,13 @@ void MLX90641::readAlpha() {  // this function restores the sensitivity from EEP
   Serial.print(float2exp(alpha_reference_row3, 6));
   Serial.println(", example value: 0.000000345520675182343");  // 11.2.2.8
   Serial.print("readAlpha() alpha_pixel[95]: ");
-  Serial.print(float2exp(alpha_pixel[95], 6));
-  Serial.println(", example value: 0.000000345520675182343");  // 11.2.2.8
+  Serial.print(readEEPROM_unsigned(0x2500 + 95) & 0x07FF);
+  Serial.println(", example value: 2047 (alpha = alpha_reference_row3)");  // 11.2.2.8
   Serial.println("Finished: read pixel sensitivities.");
 #endif
 }
 
-// To restore the Kta coefficients, 11.1.5 (fills Kta[]). In EEPROM, Kta values range from 0x25C0 to 0x267F.
+// To restore the Kta coefficients, 11.1.5 (fills pixCal.Kta[]). In EEPROM, Kta values range from 0x25C0 to 0x267F.
 void MLX90641::readKta() {
   uint16_t Kta_scale1 = (readEEPROM_unsigned(0x2416) & 0x07E0) / 32;  // divide by 2^5
   uint16_t Kta_scale2 = (readEEPROM_unsigned(0x2416) & 0x001F);
@@ -339,7 +579,7 @@ void MLX90641::readKta() {
   for (uint16_t i = 0; i < 192; i++) {
     int16_t Kta_EE = (readEEPROM_signed(0x25C0 + i) & 0x07E0) / 32;  // divide by 2^5
     if (Kta_EE > 31) Kta_EE = Kta_EE - 64;                           // impose limits
-    MLX90641::Kta[i] = ((float)Kta_EE * two_to_the(Kta_scale2) + (float)Kta_average) / two_to_the(Kta_scale1);
+    pixCal.Kta[i] = ((float)Kta_EE * two_to_the(Kta_scale2) + (float)Kta_average) / two_to_the(Kta_scale1);
   }
 #ifdef DEBUG
   Serial.print("readKta() Kta_average: ");
@@ -352,13 +592,13 @@ void MLX90641::readKta() {
   Serial.print(Kta_scale2);
   Serial.println(", example value: 3 (unsigned)");  // 11.2.2.5.3
   Serial.print("readKta() Kta[95]: ");
-  Serial.print(MLX90641::Kta[95], 9);
+  Serial.print(pixCal.Kta[95], 9);
   Serial.println(", example value: 0.003101349");  // 11.2.2.5.3
   Serial.println("Finished: read Kta coefficients.");
 #endif
 }
 
-// To restore the Kv coefficients, 11.1.6 (fills Kv[]). In EEPROM, Kv values range from 0x25C0 to 0x267F.
+// To restore the Kv coefficients, 11.1.6 (fills pixCal.Kv[]). In EEPROM, Kv values range from 0x25C0 to 0x267F.
 void MLX90641::readKv() {
   uint16_t Kv_scale1 = (readEEPROM_unsigned(0x2418) & 0x07E0) / 32;  // divide by 2^5
   uint16_t Kv_scale2 = (readEEPROM_unsigned(0x2418) & 0x001F);
@@ -367,7 +607,7 @@ void MLX90641::readKv() {
   for (uint16_t i = 0; i < 192; i++) {
     int16_t Kv_EE = (readEEPROM_signed(0x25C0 + i) & 0x001F);
     if (Kv_EE > 15) Kv_EE = Kv_EE - 32;  //impose limits
-    Kv[i] = (((float)Kv_EE * two_to_the(Kv_scale2) + (float)Kv_average)) / two_to_the(Kv_scale1);
+    pixCal.Kv[i] = (((float)Kv_EE * two_to_the(Kv_scale2) + (float)Kv_average)) / two_to_the(Kv_scale1);
   }
 #ifdef DEBUG
   Serial.print("readKv() Kv_average: ");
@@ -380,7 +620,7 @@ void MLX90641::readKv() {
   Serial.print(Kv_scale2);
   Serial.println(", example value: 4 (unsigned)");  // 11.2.2.5.3
   Serial.print("readKv() Kv[95]: ");
-  Serial.print(Kv[95], 9);
+  Serial.print(pixCal.Kv[95], 9);
   Serial.println(", example value: 0.3251953");  // 11.2.2.5.3
   Serial.println("Finished: read Kv coefficients.");
 #endif
@@ -402,23 +642,23 @@ float MLX90641::readKsTa() {
 
 // To restore the corner temperatures (CT1..CT8), 11.1.9
 void MLX90641::readCT() {
-  CT1 = -40;  // hard-coded
-  CT2 = -20;  // hard-coded
-  CT3 = 0;    // hard-coded
-  CT4 = 80;   // hard-coded
-  CT5 = 120;  // hard-coded
-  CT6 = readEEPROM_unsigned(0x243A) & 0x07FF;
-  CT7 = readEEPROM_unsigned(0x243C) & 0x07FF;
-  CT8 = readEEPROM_unsigned(0x243E) & 0x07FF;
+  CT[0] = -40;  // hard-coded
+  CT[1] = -20;  // hard-coded
+  CT[2] = 0;    // hard-coded
+  CT[3] = 80;   // hard-coded
+  CT[4] = 120;  // hard-coded
+  CT[5] = readEEPROM_unsigned(0x243A) & 0x07FF;
+  CT[6] = readEEPROM_unsigned(0x243C) & 0x07FF;
+  CT[7] = readEEPROM_unsigned(0x243E) & 0x07FF;
 #ifdef DEBUG
   Serial.print("readCT() CT6: ");
-  Serial.print(CT6);
+  Serial.print(CT[5]);
   Serial.println(", example value: 200");  // 11.2.2.9.1.1
   Serial.print("readCT() CT7: ");
-  Serial.print(CT7);
+  Serial.print(CT[6]);
   Serial.println(", example value: 400");  // 11.2.2.9.1.1
   Serial.print("readCT() CT8: ");
-  Serial.print(CT8);
+  Serial.print(CT[7]);
   Serial.println(", example value: 600");  // 11.2.2.9.1.1
   Serial.println("Finished: read corner temperatures.");
 #endif
@@ -427,100 +667,46 @@ void MLX90641::readCT() {
 // To restore the KsTo coefficients, 11.1.10
 void MLX90641::readKsTo() {
   // Addresses: KsTo1..KsTo8 are 0x2435 ..0x2439, and 0x243B, 0x243D, 0x243F
-  int16_t x;                                                   // to hold numerators
+  const uint16_t KsTo_addr[8] = { 0x2435, 0x2436, 0x2437, 0x2438, 0x2439, 0x243B, 0x243D, 0x243F };
   uint16_t KsTo_scale = readEEPROM_unsigned(0x2434) & 0x07FF;  // unsigned
-  x = (readEEPROM_signed(0x2435) & 0x07FF);
-  if (x > 1023) x = x - 2048;
-  KsTo1 = (float)x / two_to_the(KsTo_scale);
-  x = (readEEPROM_signed(0x2436) & 0x07FF);
-  if (x > 1023) x = x - 2048;
-  KsTo2 = (float)x / two_to_the(KsTo_scale);
-  x = (readEEPROM_signed(0x2437) & 0x07FF);
-  if (x > 1023) x = x - 2048;
-  KsTo3 = (float)x / two_to_the(KsTo_scale);
-  x = (readEEPROM_signed(0x2438) & 0x07FF);
-  if (x > 1023) x = x - 2048;
-  KsTo4 = (float)x / two_to_the(KsTo_scale);
-  x = (readEEPROM_signed(0x2439) & 0x07FF);
-  if (x > 1023) x = x - 2048;
-  KsTo5 = (float)x / two_to_the(KsTo_scale);
-  x = (readEEPROM_signed(0x243B) & 0x07FF);
-  if (x > 1023) x = x - 2048;
-  KsTo6 = (float)x / two_to_the(KsTo_scale);
-  x = (readEEPROM_signed(0x243D) & 0x07FF);
-  if (x > 1023) x = x - 2048;
-  KsTo7 = (float)x / two_to_the(KsTo_scale);
-  x = (readEEPROM_signed(0x243F) & 0x07FF);
-  if (x > 1023) x = x - 2048;
-  KsTo8 = (float)x / two_to_the(KsTo_scale);
-
+  for (int r = 0; r < 8; r++) {
+    int16_t x = (readEEPROM_signed(KsTo_addr[r]) & 0x07FF);  // numerator
+    if (x > 1023) x = x - 2048;                                // impose limits
+    KsTo[r] = (float)x / two_to_the(KsTo_scale);
+  }
 #ifdef DEBUG
   Serial.print("readKsTo() KsTo_scale: ");
   Serial.print(KsTo_scale);
   Serial.println(", example value: 20");  // 11.2.2.9
-  Serial.print("readKsTo() KsTo1: ");
-  Serial.print(KsTo1, 7);
-  Serial.println(", example value: -0.000699997");  // 11.2.2.9.1.2
-  Serial.print("readKsTo() KsTo2: ");
-  Serial.print(KsTo2, 7);
-  Serial.println(", example value: -0.000699997");  // 11.2.2.9.1.2
-  Serial.print("readKsTo() KsTo3: ");
-  Serial.print(KsTo3, 7);
-  Serial.println(", example value: -0.000699997");  // 11.2.2.9
-  Serial.print("readKsTo() KsTo4: ");
-  Serial.print(KsTo4, 7);
-  Serial.println(", example value: -0.000699997");  // 11.2.2.9.1.2
-  Serial.print("readKsTo() KsTo5: ");
-  Serial.print(KsTo5, 7);
-  Serial.println(", example value: -0.000699997");  // 11.2.2.9.1.2
-  Serial.print("readKsTo() KsTo6: ");
-  Serial.print(KsTo6, 7);
-  Serial.println(", example value: -0.000699997");  // 11.2.2.9.1.2
-  Serial.print("readKsTo() KsTo7: ");
-  Serial.print(KsTo7, 7);
-  Serial.println(", example value: -0.000699997");  // 11.2.2.9.1.2
-  Serial.print("readKsTo() KsTo8: ");
-  Serial.print(KsTo8, 7);
-  Serial.println(", example value: -0.000699997");  // 11.2.2.9.1.2
+  for (int r = 0; r < 8; r++) {
+    Serial.print("readKsTo() KsTo");
+    Serial.print(r + 1);
+    Serial.print(": ");
+    Serial.print(KsTo[r], 7);
+    Serial.println(", example value: -0.000699997");  // 11.2.2.9.1.2
+  }
   Serial.println("Finished: read KsTo coefficients.");
 #endif
 }
 
 // To restore the Sensitivity Correction coefficients for each temperature range, 11.1.11
 void MLX90641::readAlphaCorrRange() {
-  Alpha_cr2 = 1.0 / (1.0 + KsTo2 * (float)(CT3 - (CT2)));
-  Alpha_cr1 = Alpha_cr2 / (1.0 + KsTo1 * (float)(CT2 - (CT1)));
-  Alpha_cr3 = 1.0;  // hard-coded
-  Alpha_cr4 = (1.0 + KsTo3 * (float)(CT4 - CT3));
-  Alpha_cr5 = (1.0 + KsTo4 * (float)(CT5 - CT4)) * Alpha_cr4;
-  Alpha_cr6 = (1.0 + KsTo5 * (float)(CT6 - CT5)) * Alpha_cr5;
-  Alpha_cr7 = (1.0 + KsTo6 * (float)(CT7 - CT6)) * Alpha_cr6;
-  Alpha_cr8 = (1.0 + KsTo7 * (float)(CT8 - CT7)) * Alpha_cr7;
+  Alpha_cr[1] = 1.0 / (1.0 + KsTo[1] * (float)(CT[2] - CT[1]));
+  Alpha_cr[0] = Alpha_cr[1] / (1.0 + KsTo[0] * (float)(CT[1] - CT[0]));
+  Alpha_cr[2] = 1.0;  // hard-coded
+  for (int r = 3; r < 8; r++) {  // ranges 4..8 build on the range below
+    Alpha_cr[r] = (1.0 + KsTo[r - 1] * (float)(CT[r] - CT[r - 1])) * (r == 3 ? 1.0f : Alpha_cr[r - 1]);
+  }
 #ifdef DEBUG
-  Serial.print("readAlphaCorrRange() Alpha_cr1: ");
-  Serial.print(Alpha_cr1, 9);
-  Serial.println(", example value: 1.028599");  // 11.2.2.9.1.1
-  Serial.print("readAlphaCorrRange() Alpha_cr2: ");
-  Serial.print(Alpha_cr2, 9);
-  Serial.println(", example value: 1.014198721");  // 11.2.2.9.1.1
-  Serial.print("readAlphaCorrRange() Alpha_cr3: ");
-  Serial.print(Alpha_cr3, 2);
-  Serial.println(", example value: 1");  // 11.2.2.9.1.1
-  Serial.print("readAlphaCorrRange() Alpha_cr4: ");
-  Serial.print(Alpha_cr4, 6);
-  Serial.println(", example value: 0.94400024");  // 11.2.2.9.1.1
-  Serial.print("readAlphaCorrRange() Alpha_cr5: ");
-  Serial.print(Alpha_cr5, 6);
-  Serial.println(", example value: 0.917568347");  // 11.2.2.9.1.1
-  Serial.print("readAlphaCorrRange() Alpha_cr6: ");
-  Serial.print(Alpha_cr6, 6);
-  Serial.println(", example value: 0.86618474");  // 11.2.2.9.1.1
-  Serial.print("readAlphaCorrRange() Alpha_cr7: ");
-  Serial.print(Alpha_cr7, 6);
-  Serial.println(", example value: 0.744919396");  // 11.2.2.9.1.1
-  Serial.print("readAlphaCorrRange() Alpha_cr8: ");
-  Serial.print(Alpha_cr8, 6);
-  Serial.println(", example value: 0.640631128");  // 11.2.2.9.1.1
+  const char *example[8] = { "1.028599", "1.014198721", "1", "0.94400024", "0.917568347", "0.86618474", "0.744919396", "0.640631128" };  // 11.2.2.9.1.1
+  for (int r = 0; r < 8; r++) {
+    Serial.print("readAlphaCorrRange() Alpha_cr");
+    Serial.print(r + 1);
+    Serial.print(": ");
+    Serial.print(Alpha_cr[r], 9);
+    Serial.print(", example value: ");
+    Serial.println(example[r]);
+  }
   Serial.println("Finished: read sensitivity correction coefficients.");
 #endif
 }
@@ -622,11 +808,437 @@ float MLX90641::readTGC() {
   return tgc_calc;
 }
 
+// Finish the per-pixel calibration table (pixCal) the parsers filled, 11.2.2.5 - 11.2.2.8.
+// Call after readPixelOffset(), readAlpha(), readKta(), readKv(), readAlpha_CP() and readTGC()
+// (readTempC() builds it on the first frame if needed). Call again if TGC or alpha_CP change.
+void MLX90641::calcPixelTable() {
+  float shift = TGC * alpha_CP;
+  for (int i = 0; i < NUM_PIXELS; i++) {
+    pixCal.alpha[i] += alphaShift - shift;  // CP-compensated sensitivity (11.2.2.8): alpha_pixel - TGC * alpha_CP
+#ifdef FIXED_POINT_MATH
+    fx.offset[0][i] = (int16_t)pixCal.offset[0][i];
+    fx.offset[1][i] = (int16_t)pixCal.offset[1][i];
+    fx.Kta[i] = (int32_t)lroundf(pixCal.Kta[i] * 1048576.0f);  // Q20
+    fx.Kv[i] = (int32_t)lroundf(pixCal.Kv[i] * 65536.0f);      // Q16
+    fx.invAlpha[i] = (pixCal.alpha[i] > ALPHA_COMP_MIN) ? (int32_t)lroundf(1.0f / pixCal.alpha[i]) : (int32_t)(1.0 / ALPHA_COMP_MIN);  // 1 / alpha
+#endif
+  }
+  alphaShift = shift;
+  pixCalValid = true;
+  refreshDue = true;  // KsTa, TGC, Emissivity and the CP constants feed the per-frame factors
+#ifdef DEBUG
+  Serial.print("calcPixelTable() alpha[95]: ");
+  Serial.println(float2exp(pixCal.alpha[95], 6));
+  Serial.println("Finished: per-pixel calibration table.");
+#endif
+}
+
+// Cold boot: read the whole EEPROM and run every parser. The dump only lives on the stack while the parsers
+// run (EEPROM_WORDS * 2 bytes); the header is kept in eeData for the per-frame math and the stored calibration.
+bool MLX90641::calibrate() {
+  uint16_t image[EEPROM_WORDS];
+  if (!readEEPROMBlock(0x2400, EEPROM_WORDS, image)) return false;  // read full EEPROM (0x2400..0x272F)
+  for (int i = 0; i < EEPROM_HEADER_WORDS; i++) eeData[i] = image[i];
+  frameConstValid = false;                                        // parse the header words again
+  for (int i = 0; i < 3; i++) deviceID[i] = eeData[7 + i];        // 0x2407..0x2409
+  eepromCRC = MLX90641_crc16((const uint8_t *)image, sizeof(image));
+  eeImage = image;
+  Vdd = readVdd();
+  Ta = readTa();
+  readPixelOffset();
+  readAlpha();
+  readKta();
+  readKv();
+  KsTa = readKsTa();
+  readCT();
+  readKsTo();
+  readAlphaCorrRange();
+  Emissivity = readEmissivity();
+  alpha_CP = readAlpha_CP();
+  pix_OS_ref_CP = readOff_CP();
+  Kv_CP = readKv_CP();
+  KTa_CP = readKTa_CP();
+  TGC = readTGC();
+  readPixelDefects();
+  eeImage = NULL;  // the dump goes out of scope
+  calcPixelTable();
+  return true;
+}
+
+// Pack the parsed calibration (after calibrate(), or the read*() parsers and calcPixelTable()).
+void MLX90641::serializeCalibration(MLX90641_Calibration *c) {
+  memset(c, 0, sizeof(*c));  // padding bytes are covered by the CRC too
+  c->magic = CALIBRATION_MAGIC;
+  c->version = CALIBRATION_VERSION;
+  c->size = sizeof(MLX90641_Calibration);
+  for (int i = 0; i < 3; i++) c->deviceID[i] = eeData[7 + i];
+  c->eepromCRC = eepromCRC;
+  c->headerCRC = MLX90641_crc16((const uint8_t *)eeData, EEPROM_HEADER_WORDS * 2);
+  c->Vdd_25 = Vdd_25;
+  c->K_Vdd = K_Vdd;
+  c->pix_OS_ref_CP = pix_OS_ref_CP;
+  c->KsTa = KsTa;
+  for (int r = 0; r < 8; r++) {
+    c->CT[r] = CT[r];
+    c->KsTo[r] = KsTo[r];
+    c->Alpha_cr[r] = Alpha_cr[r];
+  }
+  c->alpha_reference[0] = alpha_reference_row1;
+  c->alpha_reference[1] = alpha_reference_row2;
+  c->alpha_reference[2] = alpha_reference_row3;
+  c->alpha_reference[3] = alpha_reference_row4;
+  c->alpha_reference[4] = alpha_reference_row5;
+  c->alpha_reference[5] = alpha_reference_row6;
+  c->Emissivity = Emissivity;
+  c->alpha_CP = alpha_CP;
+  c->Kv_CP = Kv_CP;
+  c->KTa_CP = KTa_CP;
+  c->TGC = TGC;
+  for (int i = 0; i < NUM_PIXELS; i++) {
+    c->pix_OS_ref_SP0[i] = (int16_t)pixCal.offset[0][i];
+    c->pix_OS_ref_SP1[i] = (int16_t)pixCal.offset[1][i];
+    c->alpha[i] = pixCal.alpha[i];
+    c->Kta[i] = pixCal.Kta[i];
+    c->Kv[i] = pixCal.Kv[i];
+    c->badPixels[i] = badPixels[i];  // defect map, all causes
+  }
+  c->crc = MLX90641_crc16((const uint8_t *)c, offsetof(MLX90641_Calibration, crc));
+}
+
+// Warm boot: restore a packed calibration. Only the EEPROM header (EEPROM_HEADER_WORDS words, one or two
+// bursts) is read from the sensor: it holds the device ID and the words the per-frame math still needs.
+// Returns false, leaving the parsed values untouched, if the blob is damaged, from another library version,
+// or from another sensor (device ID or EEPROM header checksum differ).
+bool MLX90641::deserializeCalibration(const MLX90641_Calibration *cal) {
+  const MLX90641_Calibration &c = *cal;
+  if (c.magic != CALIBRATION_MAGIC || c.version != CALIBRATION_VERSION || c.size != sizeof(MLX90641_Calibration)) return false;
+  if (MLX90641_crc16((const uint8_t *)cal, offsetof(MLX90641_Calibration, crc)) != c.crc) return false;
+  if (!readEEPROMBlock(0x2400, EEPROM_HEADER_WORDS, eeData)) return false;
+  for (int i = 0; i < 3; i++) {
+    if (eeData[7 + i] != c.deviceID[i]) return false;  // another sensor
+  }
+  if (MLX90641_crc16((const uint8_t *)eeData, EEPROM_HEADER_WORDS * 2) != c.headerCRC) return false;  // configuration changed
+  applyCalibration(c);
+  return true;
+}
+
+// Unpack a calibration blob whose keys have been checked, then rebuild the per-pixel table.
+void MLX90641::applyCalibration(const MLX90641_Calibration &c) {
+  for (int i = 0; i < 3; i++) deviceID[i] = c.deviceID[i];
+  eepromCRC = c.eepromCRC;
+  Vdd_25 = c.Vdd_25;
+  K_Vdd = c.K_Vdd;
+  pix_OS_ref_CP = c.pix_OS_ref_CP;
+  KsTa = c.KsTa;
+  for (int r = 0; r < 8; r++) {
+    CT[r] = c.CT[r];
+    KsTo[r] = c.KsTo[r];
+    Alpha_cr[r] = c.Alpha_cr[r];
+  }
+  alpha_reference_row1 = c.alpha_reference[0];
+  alpha_reference_row2 = c.alpha_reference[1];
+  alpha_reference_row3 = c.alpha_reference[2];
+  alpha_reference_row4 = c.alpha_reference[3];
+  alpha_reference_row5 = c.alpha_reference[4];
+  alpha_reference_row6 = c.alpha_reference[5];
+  Emissivity = c.Emissivity;
+  alpha_CP = c.alpha_CP;
+  Kv_CP = c.Kv_CP;
+  KTa_CP = c.KTa_CP;
+  TGC = c.TGC;
+  for (int i = 0; i < NUM_PIXELS; i++) {
+    pixCal.offset[0][i] = c.pix_OS_ref_SP0[i];
+    pixCal.offset[1][i] = c.pix_OS_ref_SP1[i];
+    pixCal.alpha[i] = c.alpha[i];
+    pixCal.Kta[i] = c.Kta[i];
+    pixCal.Kv[i] = c.Kv[i];
+    badPixels[i] = c.badPixels[i];
+  }
+  alphaShift = TGC * alpha_CP;  // the stored sensitivities are CP-compensated already
+  calcPixelTable();
+}
+
+// Pack the calibration together with the EEPROM header and the control register, so that another machine can
+// run compensateRaw() with no sensor attached. Returns false if the control register cannot be read.
+bool MLX90641::exportCalibration(MLX90641_CalibrationExport *exp) {
+  if (!controlRegValid) {
+    controlReg = readAddr_unsigned(0x800D);
+    controlRegValid = (controlReg != (uint16_t)-999);
+    if (!controlRegValid) return false;
+  }
+  memset(exp, 0, sizeof(*exp));
+  serializeCalibration(&exp->cal);
+  for (int i = 0; i < EEPROM_HEADER_WORDS; i++) exp->eepromHeader[i] = eeData[i];
+  exp->controlReg = controlReg;
+  exp->crc = MLX90641_crc16((const uint8_t *)exp->eepromHeader, offsetof(MLX90641_CalibrationExport, crc) - offsetof(MLX90641_CalibrationExport, eepromHeader));
+  return true;
+}
+
+// Restore an exported calibration without reading anything from the bus (offline compensation, e.g. in the
+// host build). Returns false, leaving the parsed values untouched, if the blob is damaged or from another version.
+bool MLX90641::importCalibration(const MLX90641_CalibrationExport *exp) {
+  const MLX90641_Calibration &c = exp->cal;
+  if (c.magic != CALIBRATION_MAGIC || c.version != CALIBRATION_VERSION || c.size != sizeof(MLX90641_Calibration)) return false;
+  if (MLX90641_crc16((const uint8_t *)&c, offsetof(MLX90641_Calibration, crc)) != c.crc) return false;
+  if (MLX90641_crc16((const uint8_t *)exp->eepromHeader, offsetof(MLX90641_CalibrationExport, crc) - offsetof(MLX90641_CalibrationExport, eepromHeader)) != exp->crc) return false;
+  if (MLX90641_crc16((const uint8_t *)exp->eepromHeader, EEPROM_HEADER_WORDS * 2) != c.headerCRC) return false;
+  for (int i = 0; i < EEPROM_HEADER_WORDS; i++) eeData[i] = exp->eepromHeader[i];
+  frameConstValid = false;             // parse the header words again
+  controlReg = exp->controlReg;
+  controlRegValid = true;
+  applyCalibration(c);
+  return true;
+}
+
+// Pack the settings of the pipeline that compensateRaw() cannot see in the calibration. Nothing is changed:
+// call beginRecording() just before the first recorded frame so the live pipeline starts from the same state.
+void MLX90641::exportSettings(MLX90641_PipelineSettings *settings) {
+  memset(settings, 0, sizeof(*settings));
+  settings->magic = SETTINGS_MAGIC;
+  settings->version = SETTINGS_VERSION;
+  settings->size = sizeof(MLX90641_PipelineSettings);
+  settings->subpageMode = subpageMode;
+  settings->refreshPolicy = refreshPolicy;
+  settings->refreshEveryN = refreshEveryN;
+  settings->refreshDriftTa = refreshDriftTa;
+  settings->refreshDriftVdd = refreshDriftVdd;
+  settings->refreshDriftKgain = refreshDriftKgain;
+  settings->defectWindow = defectWindow;
+  settings->defectOutlier = defectOutlier;
+  settings->calSlope = calSlope;
+  settings->calIntercept = calIntercept;
+  settings->filterMode = (filter != NULL) ? filter->mode() : FILTER_NONE;
+  if (filter != NULL) {
+    settings->filterAlpha = filter->alpha();
+    settings->filterWindow = filter->window();
+    settings->filterQ = filter->q();
+    settings->filterR = filter->r();
+    settings->filterGate = filter->gate();
+  }
+  settings->crc = MLX90641_crc16((const uint8_t *)settings, offsetof(MLX90641_PipelineSettings, crc));
+}
+
+// Restart the state carried from frame to frame (subpage merge, refresh counter, defect statistics, filter
+// history), as importSettings() does on the host. The frames read from now on are then compensated the same
+// way by importSettings() and compensateRaw() on another machine.
+void MLX90641::beginRecording() {
+  restartFrameState();
+}
+
+// Apply exported pipeline settings and restart the state carried from frame to frame, as beginRecording() did
+// on the recording sensor. A recorded filter is set up on filter, which becomes this sensor's filter. Returns
+// false, changing nothing, if the blob is damaged or from another version, or if it needs a filter and filter is NULL.
+bool MLX90641::importSettings(const MLX90641_PipelineSettings *settings, MLX90641_Filter *filter) {
+  const MLX90641_PipelineSettings &p = *settings;
+  if (p.magic != SETTINGS_MAGIC || p.version != SETTINGS_VERSION || p.size != sizeof(MLX90641_PipelineSettings)) return false;
+  if (MLX90641_crc16((const uint8_t *)&p, offsetof(MLX90641_PipelineSettings, crc)) != p.crc) return false;
+  if (p.subpageMode > SUBPAGE_AVERAGE || p.refreshPolicy > REFRESH_ON_DRIFT || p.refreshEveryN == 0 || p.defectWindow > 255) return false;
+  if (p.filterMode != FILTER_NONE) {
+    if (filter == NULL) return false;
+    bool ok = (p.filterMode == FILTER_IIR) ? filter->setIIR(p.filterAlpha)
+            : (p.filterMode == FILTER_MEDIAN) ? filter->setMedian((uint8_t)p.filterWindow)
+            : (p.filterMode == FILTER_KALMAN) ? filter->setKalman(p.filterQ, p.filterR, p.filterGate) : false;
+    if (!ok) return false;
+  }
+  setFilter(p.filterMode != FILTER_NONE ? filter : NULL);
+  setSubpageMode(p.subpageMode);
+  setRefreshPolicy(p.refreshPolicy, p.refreshEveryN, p.refreshDriftTa, p.refreshDriftVdd, p.refreshDriftKgain);
+  setDefectWindow(p.defectWindow, p.defectOutlier);
+  calSlope = p.calSlope;
+  calIntercept = p.calIntercept;
+  restartFrameState();
+  return true;
+}
+
+// Forget everything a frame passes on to the next one: the last result of each subpage, the refresh counter
+// (the next frame refreshes), the defect statistics window and the filter history. The defect map stays.
+void MLX90641::restartFrameState() {
+  subpagesSeen = 0;
+  refreshDue = true;
+  resetDefectWindow();
+  if (filter != NULL) filter->reset();
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+static_assert(FRAME_BUFFER_SIZE >= sizeof(MLX90641_Calibration), "FRAME_BUFFER_SIZE must hold a packed calibration");
+
+// Store the parsed calibration in NVS under "cal<I2C address>", using the shared frame buffer.
+bool MLX90641::saveCalibration(const char *ns) {
+  serializeCalibration((MLX90641_Calibration *)frameBuffer);
+  size_t n = sizeof(MLX90641_Calibration);
+  Preferences prefs;
+  if (!prefs.begin(ns, false)) return false;
+  char key[8];
+  snprintf(key, sizeof(key), "cal%02x", i2cAddr);
+  bool ok = (prefs.putBytes(key, frameBuffer, n) == n);
+  prefs.end();
+  return ok;
+}
+
+// Restore the calibration from NVS. Returns false if none is stored or it does not match this sensor.
+bool MLX90641::loadCalibration(const char *ns) {
+  Preferences prefs;
+  if (!prefs.begin(ns, true)) return false;
+  char key[8];
+  snprintf(key, sizeof(key), "cal%02x", i2cAddr);
+  size_t n = prefs.getBytesLength(key);
+  if (n != sizeof(MLX90641_Calibration)) {
+    prefs.end();
+    return false;
+  }
+  n = prefs.getBytes(key, frameBuffer, FRAME_BUFFER_SIZE);
+  prefs.end();
+  return n == sizeof(MLX90641_Calibration) && deserializeCalibration((const MLX90641_Calibration *)frameBuffer);
+}
+#endif
+
 // After importing and calculating all constants, we are ready to take a temperature reading.
-void MLX90641::readTempC() {      // take a temperature reading of all pixels
-  Kgain = readKgain();  // This needs to happen in the loop
-  Vdd = readVdd();      // Re-read Vdd
-  Ta = readTa();        // Re-read Ta
+// Frame path: readFrame() -> prepareFrame() -> compensatePixels() -> fixBadPixels().
+// Every stage works from member data and scalar temporaries only - no per-pixel arrays live on the stack.
+// Deepest call chain (g++ 12 -fstack-usage, x86-64): 224 bytes at -O3, 240 at -Os, 208 with FIXED_POINT_MATH, 264 with SIMD_MATH.
+void MLX90641::readTempC(float *scratch) {      // take a temperature reading of all pixels
+  PROFILE_BEGIN();
+  PROFILE_MARK();
+  subpage = readAddr_unsigned(STATUS_ADDR) & 0x01;  // read current subpage
+  if (!readFrame()) return;  // burst-read the whole frame RAM (pixels, CP, Vdd, PTAT, VBE, gain) in one snapshot
+  PROFILE_LAP(MLX90641_STAGE_BUS);
+  finishFrame(scratch);                       // all the math, from the snapshot only
+  PROFILE_END();
+#ifdef DEBUG
+  Serial.print("Subpage: ");
+  Serial.println(subpage);
+  Serial.print("readTempC() Ta_r/1e9 = ");
+  Serial.print(Ta_r / 1e9, 6);
+  Serial.println(", example value: 9899175739.92 ");  // 11.2.2.8
+  Serial.print("readTempC() T_o[95] = ");
+  Serial.print(T_o[95], 1);
+  Serial.println(", example value: 80.12");  // 11.2.2.8
+  Serial.println("Finished: basic temperature range.");
+#endif
+}
+
+// Everything after the bus read, shared by readTempC() and compensateRaw(): the frameData[] snapshot and
+// subpage are the only per-frame inputs, so the same raw frame always gives the same result.
+void MLX90641::finishFrame(float *scratch) {
+  PROFILE_MARK();
+  prepareFrame();                             // per-frame constants (Kgain, Vdd, Ta, CP, Ta_r)
+  PROFILE_LAP(MLX90641_STAGE_PREPARE);
+  compensatePixels(0, NUM_PIXELS, scratch);   // raw word -> T_o for every pixel
+  PROFILE_LAP(MLX90641_STAGE_COMPENSATE);
+  fixBadPixels();                             // fill in flagged pixels from their neighbours
+  PROFILE_LAP(MLX90641_STAGE_FIX_PIXELS);
+  if (filter != NULL) filter->apply(T_o);     // temporal filter (setFilter())
+  PROFILE_LAP(MLX90641_STAGE_FILTER);
+  publishFrame();                             // hand the finished frame to the consumer
+  PROFILE_LAP(MLX90641_STAGE_PUBLISH);
+}
+
+// Read one raw frame: the status register, then the frame RAM in one snapshot. Nothing is compensated, so this
+// costs only the bus time. Returns false (raw untouched) on a bus error.
+bool MLX90641::readRaw(MLX90641_RawFrame *raw) {
+  uint16_t status = readAddr_unsigned(STATUS_ADDR);
+  if (status == 0xFC19) return false;  // bus error (-999)
+  subpage = status & 0x01;
+  if (!readFrame()) return false;
+  copyRaw(raw, status);
+  return true;
+}
+
+void MLX90641::copyRaw(MLX90641_RawFrame *raw, uint16_t status) {
+  raw->seq = ++rawSeq;
+  raw->timestamp = millis();
+  raw->status = status;
+  memcpy(raw->words, frameData, sizeof(raw->words));
+}
+
+// Compensate a raw frame read earlier, here or on another machine (after calibrate(), deserializeCalibration()
+// or importCalibration()). Emissivity, the defect map and the filter in effect now are used, not those of the
+// time of the read (importSettings() restores those of the recording). Frames of a session must be compensated
+// in order, like live frames (subpage merge, refresh policy, defect statistics and filter state carry over from
+// one frame to the next).
+void MLX90641::compensateRaw(const MLX90641_RawFrame *raw, float *scratch) {
+  PROFILE_BEGIN();
+  memcpy(frameData, raw->words, sizeof(frameData));
+  frameValid = true;
+  subpage = raw->status & 0x01;
+  finishFrame(scratch);
+  PROFILE_END();
+}
+
+// In raw mode, poll() reads each frame and clears the new data bit, then fills *raw and calls the onFrame
+// callback without any math (prepareFrame() onwards is skipped), for recording at high refresh rates.
+// The buffer belongs to the caller (908 bytes); NULL goes back to compensating every frame.
+void MLX90641::setRawMode(MLX90641_RawFrame *raw) {
+  rawFrame = raw;
+}
+
+// Calculate the per-frame constants from the frameData[] snapshot (call after readFrame()).
+// Kgain, Vdd, Ta and the factors derived from them (dTa, dVdd, alpha_Ta, the CP offset, Ta_r) are
+// recomputed as the refresh policy says; the CP pixel itself is compensated on every frame.
+void MLX90641::prepareFrame() {
+  if (!pixCalValid) calcPixelTable();  // build the per-pixel calibration table on the first frame
+  bool refresh = true;
+  if (!refreshDue) {
+    if (refreshPolicy == REFRESH_EVERY_N) {
+      refresh = (framesSinceRefresh + 1 >= refreshEveryN);
+    } else if (refreshPolicy == REFRESH_ON_DRIFT) {  // cheap with the cached constants: compare with the values in use
+      refresh = fabsf(readTa() - Ta) > refreshDriftTa || fabsf(readVdd() - Vdd) > refreshDriftVdd ||
+                fabsf(readKgain() - Kgain) > refreshDriftKgain * fabsf(Kgain);
+    }
+  }
+  if (refresh) {
+    Kgain = readKgain();  // This needs to happen in the loop
+    Vdd = readVdd();      // Re-read Vdd
+    Ta = readTa();        // Re-read Ta
+
+    // Offset, Ta and Vdd compensation of the CP pixel reference - 11.2.2.6.2
+    dTa = Ta - 25.0f;                  // Ta - Ta0, Ta0 = 25 (°C)
+    dVdd = Vdd - 3.3f;                 // Vdd - VddV0, VddV0 = 3.3
+    CP_OS_ref = pix_OS_ref_CP * (1.0f + KTa_CP * dTa) * (1.0f + Kv_CP * dVdd);
+
+    // Per-frame factors, shared by every pixel
+    alpha_Ta = 1.0f + KsTa * dTa;      // sensitivity change with Ta - 11.2.2.8
+    KsTo_abs = 1.0f - KsTo[2] * 273.15f;             // (1 - KsTo3 * 273.15), basic range
+    for (int r = 0; r < 8; r++) CT_f[r] = (float)CT[r];  // corner temperatures as floats for the range lookup
+    invEm = 1.0f / Emissivity;         // multiply instead of divide per pixel
+
+    // Calculating To for basic temperature range (0-80°C) - 11.2.2.9
+    // From the datasheet: The IR signal received by the sensor has two components:
+    // 1. IR signal emitted by the object
+    // 2. IR signal reflected from the object (the source of this signal is surrounding environment of the sensor)
+    // In order to compensate correctly for the emissivity and achieve best accuracy we need to know the surrounding
+    // temperature which is responsible for the second component of the IR signal namely the reflected part - 𝑇𝑟.  In case
+    // this 𝑇𝑟 temperature is not available and cannot be provided it might be replaced by 𝑇𝑟≈𝑇𝑎−5.
+    float Ta_K4 = powf((Ta + 273.15), 4.0);               // powf() returns the a^b where a, b are both float numbers
+    float Tr_K4 = powf((Ta + 268.15), 4.0);               // assume Tr = Ta - 5.0 (surrounding air)
+    Ta_r = Tr_K4 - ((Tr_K4 - Ta_K4) / Emissivity);       // this is T_a-r in the datasheet
+#ifdef DEBUG
+    Serial.print("prepareFrame() Ta_K4/1e9 = ");
+    Serial.print(Ta_K4 / 1e9, 6);
+    Serial.println(", example value: 9866871831.80621 ");  // 11.2.2.8
+    Serial.print("prepareFrame() Tr_K4/1e9 = ");
+    Serial.print(Tr_K4 / 1e9, 6);
+    Serial.println(", example value: 9253097577.685506 ");  // 11.2.2.8
+#endif
+    refreshDue = false;
+    framesSinceRefresh = 0;
+    refreshCount++;
+  } else {
+    framesSinceRefresh++;
+  }
+
+  // Compensating gain of CP pixel - 11.2.2.6.1, then its offset (11.2.2.6.2) and TGC weight (11.2.2.7)
+  int16_t CP = readFrame_signed(0x0588);  // read CP at address 0x0588 (Example data: -105)
+  float CP_pix_gain = (float)CP * Kgain;  // final equation for CP_pix_gain
+  V_CP = TGC * (CP_pix_gain - CP_OS_ref);  // TGC-weighted CP offset
+#ifdef FIXED_POINT_MATH
+  prepareFixed();  // scaled-integer copies of the per-frame constants
+#endif
+}
+
+// Compensate count pixels starting at first, from raw word to T_o (call after prepareFrame()).
+// If scratch is not NULL (SCRATCH_FLOATS floats), alpha_comp[i] is kept in scratch[i] and S_x[i] in scratch[NUM_PIXELS + i].
+void MLX90641::compensatePixels(uint16_t first, uint16_t count, float *scratch) {
   // Gain compensation - 11.2.2.5.1
   // The pixel data is a bit wonky in memory. Here is the map: (10.6.2)
   // Pixels 1..32 subpage 0: 0x0400..0x041F
@@ -641,318 +1253,657 @@ void MLX90641::readTempC() {      // take a temperature reading of all pixels
   // Pixels 129..160 subpage 1: 0x0520..0x053F
   // Pixels 161..192 subpage 0: 0x0540..0x055F
   // Pixels 161..192 subpage 1: 0x0560..0x057F
+  // Edit the following formulas accordingly based on the temperature range the sensor will be measuring: 11.2.2.9.1
+  // If 𝑇𝑂(𝑖,𝑗) < -20°C we are in range 1 and we will use the parameters (𝐾𝑠𝑇𝑜1, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒1 and 𝐶𝑇1 = −40°𝐶)
+  // If -20°C < 𝑇𝑂(𝑖,𝑗) < -40°C we are in range 2 and we will use the parameters (𝐾𝑠𝑇𝑜2, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒2 and 𝐶𝑇2 = −20°𝐶)
+  // If 0°C < 𝑇𝑂(𝑖,𝑗) < 80°C we are in range 3 and we will use the parameters (𝐾𝑠𝑇𝑜3, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒3 and 𝐶𝑇3 = 0°𝐶)
+  // If 80°C < 𝑇𝑂(𝑖,𝑗) < 120°C we are in range 4 and we will use the parameters (𝐾𝑠𝑇𝑜4, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒4 and 𝐶𝑇4 = 80°𝐶)
+  // If 120°C < 𝑇𝑂(𝑖,𝑗) < CT6°C we are in range 5 and we will use the parameters (𝐾𝑠𝑇𝑜5, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒5 and 𝐶𝑇5 = 120°𝐶)
+  // If CT6°C < 𝑇𝑂(𝑖,𝑗) < CT7°C we are in range 6 and we will use the parameters (𝐾𝑠𝑇𝑜6, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒6 and 𝐶𝑇6 = 200°𝐶)
+  // If CT7°C < 𝑇𝑂(𝑖,𝑗) < CT8°C we are in range 7 and we will use the parameters (𝐾𝑠𝑇𝑜7, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒7 and 𝐶𝑇7 = 400°𝐶)
+  // If CT8°C < 𝑇𝑂(𝑖,𝑗)  we are in range 8 and we will use the parameters (𝐾𝑠𝑇𝑜8, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒8 and 𝐶𝑇8 = 600°𝐶)
+  const uint16_t *words = &frameData[32 * subpage];  // subpage 1 words sit 32 words after subpage 0 (10.6.2)
+  float *T_sp = T_o_SP[subpage];                     // last result of this subpage
+  const float *T_other = T_o_SP[subpage ^ 1];        // last result of the other subpage
+  bool merge = (subpageMode != SUBPAGE_LATEST) && (subpagesSeen & (1 << (subpage ^ 1)));
+  subpagesSeen |= 1 << subpage;
+  uint16_t last = (first + count > NUM_PIXELS) ? NUM_PIXELS : first + count;
+#if defined(SIMD_MATH) || defined(FIXED_POINT_MATH)
+  (void)scratch;  // only the float kernel fills alpha_comp[] and S_x[]
+#endif
 
-  uint8_t subpage = readAddr_unsigned(STATUS_ADDR) & 0x01;  // read current subpage
-  float alpha_comp[NUM_PIXELS] = { 0.0 };
-
-  // Compensating gain of CP pixel - 11.2.2.6.1 - only need this once
-  int16_t CP = readAddr_signed(0x0588);   // read CP at address 0x0580 (Example data: -105)
-  if (CP < 32767) CP = CP - 65536;        //impose limits
-  float CP_pix_gain = (float)CP * Kgain;  // final equation for CP_pix_gain
+#if defined(SIMD_MATH) && !defined(FIXED_POINT_MATH)
+  for (uint16_t i = first; i < last;) {  // one row segment at a time: the raw words of a row are contiguous
+    uint16_t end = ((i | 31) + 1 < last) ? (i | 31) + 1 : last;
+    compensateSoA_vector(i, end - i, (const int16_t *)&words[i + (i & ~31)], &T_sp[i]);
+    i = end;
+  }
+#endif
+  for (uint16_t i = first; i < last; i++) {
+#ifdef FIXED_POINT_MATH
+    float T = pixelTo_fixed(i, (int16_t)words[i + (i & ~31)]);          // scaled-integer kernel (same address map as pix_addr_S0/pix_addr_S1)
+#elif defined(SIMD_MATH)
+    float T = T_sp[i];                                                   // SoA kernel result from above
+#else
+    float T = pixelTo_float(i, (int16_t)words[i + (i & ~31)], scratch);  // float kernel (same address map as pix_addr_S0/pix_addr_S1)
+#endif
+    // NaN (math crashed) is filled in by fixBadPixels() and counted towards DEFECT_DEAD
+    // Apply post-hoc calibration equation - calibrate to desired surface (comment out if not needed)
+    //T = T + OFFSET;  // Only use OFFSET term for temperature adjustment
+    T = T * calSlope + calIntercept + OFFSET;  // adjust T_o based on calibration + OFFSET
+    T_sp[i] = T;
+    if (merge) {  // combine with the last result of the other subpage
+      uint8_t row = i / 16;
+      uint8_t col = i % 16;
+      if (subpageMode == SUBPAGE_AVERAGE) {
+        T = 0.5f * (T + T_other[i]);
+      } else {
+        uint8_t sp = (subpageMode == SUBPAGE_CHESS) ? ((row + col) & 1) : (row & 1);  // subpage this pixel comes from
+        if (sp != subpage) T = T_other[i];
+      }
+    }
+    T_o[i] = T;
+	//if(i==158)T_o[i]=100.0; // simulate a bad pixel (for debugging)
+	//if(i==176)T_o[i]=100.0; // simulate a bad pixel (for debugging)
+  }
+}
 
-  if (subpage == 0) {
-    // Gain compensation - 11.2.2.5.1
-    float pix_gain_S0[NUM_PIXELS] = { 0.0 };  // to store pixel gain.
+// Float kernel: raw pixel word to T_o (°C, before post-hoc calibration) for pixel i. Returns NaN if the math fails.
+float MLX90641::pixelTo_float(uint16_t i, int16_t raw, float *scratch) {
+  // Gain compensation - 11.2.2.5.1
+  float pix_gain = (float)raw * Kgain;
+  // IR data compensation - 11.2.2.5.3
+  float pix_OS = pix_gain - pixCal.offset[subpage][i] * (1.0f + pixCal.Kta[i] * dTa) * (1.0f + pixCal.Kv[i] * dVdd);
+  float V_IR = (pix_OS - V_CP) / Emissivity;  //11.2.2.7
+  V_IR_compensated[i] = V_IR;
+  // Normalizing to sensitivity - 11.2.2.8
+  float alpha_comp = pixCal.alpha[i] * alpha_Ta;
+  if (alpha_comp < ALPHA_COMP_MIN) alpha_comp = ALPHA_COMP_MIN;  // protects against small alpha_comp values
+  // Calculating To for basic temperature range (0-80°C) - 11.2.2.9
+  float S_x = KsTo[2] * fourth_root(powf(alpha_comp, 3.0) * V_IR + powf(alpha_comp, 4.0) * Ta_r);  // formula for S_x
+  float inner = (V_IR / (alpha_comp * KsTo_abs + S_x)) + Ta_r;
+  float T = fourth_root(inner) - 273.15;  // formula for T_o
+  // Extended temperature ranges - 11.2.2.9.1: the basic-range result picks the range (0..7 = range 1..8)
+  uint8_t r = 0;
+  for (int k = 1; k < 8; k++) r += (T >= CT_f[k]);  // table lookup, no if/else chain
+  if (r != 2) {  // range 3 (0..80°C) is the basic range: nothing to redo
+    inner = V_IR / (alpha_comp * Alpha_cr[r] * (1.0f + KsTo[r] * (T - CT_f[r]))) + Ta_r;
+    T = fourth_root(inner) - 273.15;  // redo T_o with this range's coefficients
+  }
+  if (scratch != NULL) {
+    scratch[i] = alpha_comp;
+    scratch[NUM_PIXELS + i] = S_x;
+  }
+#ifdef DEBUG
+  if (inner < 0 || isnan(inner)) {
+    Serial.print("BAD INNER @ " + (String)i + ", " + (String)inner);
+    Serial.print("Pixel ");
+    Serial.print(i);
+    Serial.print(" S_x[i] =");
+    Serial.print(S_x, 8);
+    Serial.print(" alpha_comp = ");
+    Serial.print(alpha_comp, 8);
+    Serial.print(" V_IR_comp = ");
+    Serial.println(V_IR, 8);
+  }
+  if (i == 95) {
+    Serial.print("pixelTo_float() S_x[95] * 1e8 = ");
+    Serial.print(S_x * 1e8, 6);
+    Serial.println(", example value: -8.18463664533495E-08");  // 11.2.2.8
+  }
+#endif
+  return T;  // sqrt of a negative inner term gives NaN
+}
 
-    for (int i = 0; i < NUM_PIXELS; i++) {
-      int16_t x1 = readAddr_signed(pix_addr_S0(i));  // read pixel data (sp0) for pixel
-      if (x1 < 32767) x1 = x1 - 65536;               //impose limits
-      pix_gain_S0[i] = (float)x1 * Kgain;
+// Branch-free struct-of-arrays kernel, reference version (call after prepareFrame()). Compensates count pixels starting at
+// pixel first, from the contiguous raw words raw[] (one row segment, see compensatePixels()) to T[] (°C, before post-hoc calibration).
+// Same datasheet steps as pixelTo_float(), rearranged so every pixel takes the same path:
+// S_x = KsTo3 * (alpha^3 * V_IR + alpha^4 * Ta_r)^(1/4) = KsTo3 * alpha * (V_IR / alpha + Ta_r)^(1/4), so no powf(),
+// and the range constants of 11.2.2.9.1 are picked with selects instead of a table lookup.
+void MLX90641::compensateSoA_scalar(uint16_t first, uint16_t count, const int16_t *raw, float *T) {
+  const float *alpha = &pixCal.alpha[first];
+  const float *offset = &pixCal.offset[subpage][first];
+  const float *Kta_p = &pixCal.Kta[first];
+  const float *Kv_p = &pixCal.Kv[first];
+  for (uint16_t n = 0; n < count; n++) {
+    // Gain, offset, Ta and Vdd compensation - 11.2.2.5.1, 11.2.2.5.3
+    float pix_OS = (float)raw[n] * Kgain - offset[n] * (1.0f + Kta_p[n] * dTa) * (1.0f + Kv_p[n] * dVdd);
+    float V_IR = (pix_OS - V_CP) * invEm;  // 11.2.2.7
+    V_IR_compensated[first + n] = V_IR;
+    float alpha_comp = fmaxf(alpha[n] * alpha_Ta, ALPHA_COMP_MIN);  // 11.2.2.8, same limit as pixelTo_float()
+    // Basic range - 11.2.2.9
+    float S_x = KsTo[2] * alpha_comp * fourth_root(V_IR / alpha_comp + Ta_r);
+    float T_basic = fourth_root(V_IR / (alpha_comp * KsTo_abs + S_x) + Ta_r) - 273.15f;
+    // Extended ranges - 11.2.2.9.1
+    float Acr = Alpha_cr[0], Ks = KsTo[0], ct = CT_f[0];
+    for (int k = 1; k < 8; k++) {
+      bool above = (T_basic >= CT_f[k]);
+      Acr = above ? Alpha_cr[k] : Acr;
+      Ks = above ? KsTo[k] : Ks;
+      ct = above ? CT_f[k] : ct;
     }
+    float T_ext = fourth_root(V_IR / (alpha_comp * Acr * (1.0f + Ks * (T_basic - ct))) + Ta_r) - 273.15f;
+    bool basic = (T_basic >= CT_f[2]) & (T_basic < CT_f[3]);  // range 3 keeps the basic result
+    T[n] = basic ? T_basic : T_ext;  // NaN if the math fails
+  }
+}
 
-    // IR data compensation - 11.2.2.5.3. Ta0 = 25 (°C), VddV0=3.3
-	float pix_OS_SP0[NUM_PIXELS] = { 0.0 };
-    for (int i = 0; i < NUM_PIXELS; i++) {
-      pix_OS_SP0[i] = pix_gain_S0[i] - (float)pix_OS_ref_SP0[i] * (1.0 + MLX90641::Kta[i] * (Ta - 25.0)) * (1.0 + Kv[i] * (Vdd - 3.3));
+// Vector version of compensateSoA_scalar(): 4 pixels per step with SSE2 or NEON, the remainder (and other targets) with the reference
+void MLX90641::compensateSoA_vector(uint16_t first, uint16_t count, const int16_t *raw, float *T) {
+  uint16_t n = 0;
+#ifdef SOA_LANES
+  const float *alpha = &pixCal.alpha[first];
+  const float *offset = &pixCal.offset[subpage][first];
+  const float *Kta_p = &pixCal.Kta[first];
+  const float *Kv_p = &pixCal.Kv[first];
+  const soa_f one = soa_set(1.0f), v_Kgain = soa_set(Kgain), v_dTa = soa_set(dTa), v_dVdd = soa_set(dVdd);
+  const soa_f v_V_CP = soa_set(V_CP), v_invEm = soa_set(invEm), v_alpha_Ta = soa_set(alpha_Ta), alpha_min = soa_set(ALPHA_COMP_MIN);
+  const soa_f v_Ta_r = soa_set(Ta_r), v_KsTo3 = soa_set(KsTo[2]), v_KsTo_abs = soa_set(KsTo_abs), kelvin = soa_set(273.15f);
+  for (; n + SOA_LANES <= count; n += SOA_LANES) {
+    soa_f gain = soa_mul(soa_raw(&raw[n]), v_Kgain);
+    soa_f f_Ta = soa_add(one, soa_mul(soa_load(&Kta_p[n]), v_dTa));
+    soa_f f_V = soa_add(one, soa_mul(soa_load(&Kv_p[n]), v_dVdd));
+    soa_f pix_OS = soa_sub(gain, soa_mul(soa_mul(soa_load(&offset[n]), f_Ta), f_V));
+    soa_f V_IR = soa_mul(soa_sub(pix_OS, v_V_CP), v_invEm);
+    soa_store(&V_IR_compensated[first + n], V_IR);
+    soa_f a = soa_max(soa_mul(soa_load(&alpha[n]), v_alpha_Ta), alpha_min);
+    soa_f S_x = soa_mul(soa_mul(v_KsTo3, a), soa_sqrt(soa_sqrt(soa_add(soa_div(V_IR, a), v_Ta_r))));
+    soa_f den = soa_add(soa_mul(a, v_KsTo_abs), S_x);
+    soa_f T_basic = soa_sub(soa_sqrt(soa_sqrt(soa_add(soa_div(V_IR, den), v_Ta_r))), kelvin);
+    soa_f Acr = soa_set(Alpha_cr[0]), Ks = soa_set(KsTo[0]), ct = soa_set(CT_f[0]);
+    for (int k = 1; k < 8; k++) {
+      soa_m above = soa_ge(T_basic, soa_set(CT_f[k]));
+      Acr = soa_select(above, soa_set(Alpha_cr[k]), Acr);
+      Ks = soa_select(above, soa_set(KsTo[k]), Ks);
+      ct = soa_select(above, soa_set(CT_f[k]), ct);
     }
+    den = soa_mul(soa_mul(a, Acr), soa_add(one, soa_mul(Ks, soa_sub(T_basic, ct))));
+    soa_f T_ext = soa_sub(soa_sqrt(soa_sqrt(soa_add(soa_div(V_IR, den), v_Ta_r))), kelvin);
+    soa_m basic = soa_and(soa_ge(T_basic, soa_set(CT_f[2])), soa_lt(T_basic, soa_set(CT_f[3])));
+    soa_store(&T[n], soa_select(basic, T_basic, T_ext));
+  }
+#endif
+  if (n < count) compensateSoA_scalar(first + n, count - n, &raw[n], &T[n]);
+}
 
-    // Compensating offset, Ta and Vdd of CP pixel - 11.2.2.6.2
-    float CP_pix_OS = CP_pix_gain - pix_OS_ref_CP * (1.0 + KTa_CP * (Ta - 25.0)) * (1.0 + Kv_CP * (Vdd - 3.3));
-    for (int i = 0; i < NUM_PIXELS; i++) {
-      V_IR_compensated[i] = (pix_OS_SP0[i] - (TGC * CP_pix_OS)) / Emissivity;  //11.2.2.7
+#ifdef FIXED_POINT_MATH
+// Integer square root of a 64-bit number (bit by bit, no division)
+static uint32_t isqrt64(uint64_t n) {
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+  while (bit > n) bit >>= 2;
+  while (bit != 0) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
     }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
 
-    // Normalizing to sensitivity - 11.2.2.8
-    float alpha_SP0[NUM_PIXELS] = { 0.0 };
-    // Scaling for Row 1:
-    for (int i = 0; i < 32; i++) {
-      alpha_SP0[i] = (float)alpha_reference_row1 * (float)alpha_pixel[i] / 2047.0f;
-    }
-    // Scaling for Row 2:
-    for (int i = 32; i < 64; i++) {
-      alpha_SP0[i] = (float)alpha_reference_row2 * (float)alpha_pixel[i] / 2047.0f;
-    }
-    // Scaling for Row 3:
-    for (int i = 64; i < 96; i++) {
-      alpha_SP0[i] = (float)alpha_reference_row3 * (float)alpha_pixel[i] / 2047.0f;
-    }
-    // Scaling for Row 4:
-    for (int i = 96; i < 128; i++) {
-      alpha_SP0[i] = (float)alpha_reference_row4 * (float)alpha_pixel[i] / 2047.0f;
-    }
-    // Scaling for Row 5:
-    for (int i = 128; i < 160; i++) {
-      alpha_SP0[i] = (float)alpha_reference_row5 * (float)alpha_pixel[i] / 2047.0f;
-    }
-    // Scaling for Row 6:
-    for (int i = 160; i < 192; i++) {
-      alpha_SP0[i] = (float)alpha_reference_row6 * (float)alpha_pixel[i] / 2047.0f;
-    }
-    // Define and calculate alpha_comp[i] - 11.2.2.8
-    for (int i = 0; i < NUM_PIXELS; i++) {
-      alpha_comp[i] = (alpha_SP0[i] - TGC * alpha_CP) * (1.0 + KsTa * (Ta - 25.0));
+// Kelvin in Q8 (1/256 K) from T^4 in units of 2^12 K^4: (X * 2^12 * 2^36)^(1/4) = T * 256, rounded to nearest
+static int32_t fourth_root_q8(int64_t X) {
+  return (int32_t)((isqrt64((uint64_t)isqrt64((uint64_t)X << 36) << 6) + 1) >> 1);
+}
+
+// Scaled-integer kernel: raw pixel word to T_o (°C, before post-hoc calibration) for pixel i. Returns NaN if the math fails.
+// Fixed-point formats: Qn = value * 2^n. Same steps as pixelTo_float(), with S_x folded into the denominator:
+// S_x = KsTo3 * alpha_comp * (V_IR / alpha_comp + Ta_r)^(1/4), so the basic range is 1 + KsTo3 * T1 (T1 in °C).
+float MLX90641::pixelTo_fixed(uint16_t i, int16_t raw) {
+  // Gain and IR data compensation - 11.2.2.5.1, 11.2.2.5.3 (Q20 LSB: a real pixel sees a few hundred LSB per 10°C)
+  int64_t pix_gain = (int64_t)raw * fx.Kgain;
+  int32_t f_Ta = ((int32_t)1 << 20) + ((fx.Kta[i] * fx.dTa) >> 8);   // Q20 * Q8 -> Q20
+  int32_t f_V = ((int32_t)1 << 20) + ((fx.Kv[i] * fx.dVdd) >> 10);   // Q16 * Q14 -> Q20
+  int32_t offset = fx.offset[subpage][i];
+  int64_t pix_OS = pix_gain - offset * (((int64_t)f_Ta * f_V) >> 20);
+  int32_t V_IR = (int32_t)(((pix_OS - fx.V_CP) * fx.invEm) >> 28);  // 11.2.2.7, Q20 * Q16 -> Q8 LSB
+  V_IR_compensated[i] = (float)V_IR * (1.0f / 256.0f);
+  // Sensitivity - 11.2.2.8: 1 / alpha_comp, limited like alpha_comp >= ALPHA_COMP_MIN
+  int64_t inv_alpha = ((int64_t)fx.invAlpha[i] * fx.invAlpha_Ta) >> 20;
+  if (inv_alpha > (int64_t)(1.0 / ALPHA_COMP_MIN)) inv_alpha = (int64_t)(1.0 / ALPHA_COMP_MIN);
+  int64_t V_alpha = ((int64_t)V_IR * inv_alpha) >> 20;  // V_IR / alpha_comp in units of 2^12 K^4
+  // Basic range - 11.2.2.9: first pass without S_x, then with it
+  int64_t X = V_alpha + fx.Ta_r;
+  if (X <= 0 || X >= ((int64_t)1 << 28)) return NAN;
+  int32_t T = fourth_root_q8(X) - 69926;  // °C, Q8 (273.15 * 256 = 69926)
+  for (uint8_t pass = 0; pass < 2; pass++) {
+    uint8_t r = 2;  // pass 0: basic range (range 3)
+    if (pass == 1) {  // Extended temperature ranges - 11.2.2.9.1
+      r = 0;
+      for (int k = 1; k < 8; k++) r += (T >= fx.CT[k]);  // table lookup
+      if (r == 2) break;  // range 3 is the basic range: nothing to redo
     }
-  }  // end subpage 0
+    int32_t den = ((int32_t)1 << 20) + (int32_t)(((int64_t)fx.KsTo[r] * (T - fx.CT[r])) >> 12);  // Q24 * Q8 -> Q20
+    den = (int32_t)(((int64_t)den * fx.Alpha_cr[r]) >> 20);
+    if (den <= 0) return NAN;
+    X = ((V_alpha << 20) / den) + fx.Ta_r;
+    if (X <= 0 || X >= ((int64_t)1 << 28)) return NAN;
+    T = fourth_root_q8(X) - 69926;
+  }
+  return (float)T * (1.0f / 256.0f);
+}
 
-  // Now to read Subpage 1
-  if (subpage == 1) {
-    // Gain compensation - 11.2.2.5.1
-    float pix_gain_S1[NUM_PIXELS] = { 0.0 };  // to store pixel gain.
+// Per-frame constants of the scaled-integer kernel (a handful of float operations per frame, none per pixel)
+void MLX90641::prepareFixed() {
+  fx.Kgain = (int32_t)lroundf(Kgain * 1048576.0f);            // Q20
+  fx.dTa = (int32_t)lroundf(dTa * 256.0f);                    // Q8
+  fx.dVdd = (int32_t)lroundf(dVdd * 16384.0f);                // Q14
+  fx.V_CP = (int64_t)llroundf(V_CP * 1048576.0f);             // Q20
+  fx.invEm = (int32_t)lroundf(65536.0f / Emissivity);         // Q16
+  fx.invAlpha_Ta = (int32_t)lroundf(1048576.0f / alpha_Ta);   // Q20
+  fx.Ta_r = (int64_t)llroundf(Ta_r / 4096.0f);                // units of 2^12 K^4
+  for (int r = 0; r < 8; r++) {
+    fx.CT[r] = (int32_t)CT[r] * 256;                          // Q8
+    fx.KsTo[r] = (int32_t)lroundf(KsTo[r] * 16777216.0f);     // Q24
+    fx.Alpha_cr[r] = (int32_t)lroundf(Alpha_cr[r] * 1048576.0f);  // Q20
+  }
+}
+#endif
 
-    for (int i = 0; i < NUM_PIXELS; i++) {
-      int16_t x1 = readAddr_signed(pix_addr_S1(i));  // read pixel data (sp0) for pixel
-      if (x1 < 32767) x1 = x1 - 65536;               //impose limits
-      pix_gain_S1[i] = (float)x1 * Kgain;
+// Choose how the two subpages are combined into T_o[]. Each MLX90641 subpage measures all 192 pixels
+// (with its own offsets), so the last result of each subpage is kept and merged pixel by pixel:
+// SUBPAGE_LATEST (default, whole frame from the newest subpage), SUBPAGE_CHESS, SUBPAGE_INTERLEAVED or SUBPAGE_AVERAGE.
+bool MLX90641::setSubpageMode(uint8_t mode) {
+  if (mode > SUBPAGE_AVERAGE) return false;  // invalid mode
+  subpageMode = mode;
+  return true;
+}
+
+// Fill the neighbour table once: up, left, right and down neighbour of every pixel. A pixel on the edge
+// lists itself for the neighbours it does not have, so every pixel has exactly four entries.
+void MLX90641::buildNeighbours() {
+  static bool built = false;
+  if (built) return;
+  for (int i = 0; i < NUM_PIXELS; i++) {
+    int row = i / 16, col = i % 16;
+    neighbours[i][0] = (row > 0) ? i - 16 : i;
+    neighbours[i][1] = (col > 0) ? i - 1 : i;
+    neighbours[i][2] = (col < 15) ? i + 1 : i;
+    neighbours[i][3] = (row < 11) ? i + 16 : i;
+  }
+  built = true;
+}
+
+static const float invCount[5] = { 0.0f, 1.0f, 0.5f, 1.0f / 3.0f, 0.25f };  // 1 / number of good neighbours (0: none)
+
+// Flag the pixels the EEPROM marks as defective: all four calibration words (offset of both subpages,
+// alpha, Kta/Kv) are zero. Clears DEFECT_EEPROM from the other pixels. Call after readEEPROMBlock().
+void MLX90641::readPixelDefects() {
+  for (int i = 0; i < NUM_PIXELS; i++) {
+    uint16_t words = readEEPROM_unsigned(0x2440 + i) | readEEPROM_unsigned(0x2500 + i) | readEEPROM_unsigned(0x25C0 + i) | readEEPROM_unsigned(0x2680 + i);
+    badPixels[i] = (badPixels[i] & ~DEFECT_EEPROM) | (((words & 0x07FF) == 0) ? DEFECT_EEPROM : 0);
+  }
+#ifdef DEBUG
+  Serial.print("readPixelDefects() pixels marked in EEPROM: ");
+  Serial.println(countDefects(DEFECT_EEPROM));
+#endif
+}
+
+// Frames per statistics window for dead, stuck and outlier detection (1..255, 0 switches the statistics off),
+// and the outlier threshold in °C. Restarts the window.
+bool MLX90641::setDefectWindow(uint16_t frames, float outlier) {
+  if (frames > 255) return false;  // the per-pixel counters are 8 bits
+  defectWindow = frames;
+  defectOutlier = outlier;
+  resetDefectWindow();
+  return true;
+}
+
+// Number of pixels flagged for any of the given DEFECT_* causes.
+uint16_t MLX90641::countDefects(uint8_t causes) {
+  uint16_t n = 0;
+  for (int i = 0; i < NUM_PIXELS; i++) n += (badPixels[i] & causes) != 0;
+  return n;
+}
+
+// Clear the given DEFECT_* causes from every pixel, and restart the statistics window.
+void MLX90641::clearDefects(uint8_t causes) {
+  for (int i = 0; i < NUM_PIXELS; i++) badPixels[i] &= ~causes;
+  resetDefectWindow();
+}
+
+void MLX90641::resetDefectWindow() {
+  for (int i = 0; i < NUM_PIXELS; i++) {
+    defectDead[i] = 0;
+    defectStill[i] = 0;
+    defectFar[i] = 0;
+  }
+  defectFrames = 0;
+  defectCompared = 0;
+  defectRawValid = 0;
+}
+
+// Add the current subpage result to the defect statistics. At the end of a window of defectWindow frames the
+// detected causes are set again from scratch: a pixel is
+//   dead     if it had no valid output (NaN, or a raw word at the rail) on more than half of the frames,
+//   stuck    if its raw word never changed from one frame of a subpage to the next while most pixels did,
+//   outlier  if it was more than defectOutlier °C away from every good neighbour (at least two) on 3/4 of the frames.
+// A single hot pixel does not drag its neighbours along, because each of them is close to its other neighbours.
+void MLX90641::updateDefectMap() {
+  if (defectWindow == 0) return;
+  const uint16_t *words = &frameData[32 * subpage];  // raw words of this subpage (same map as compensatePixels())
+  const float *T = T_o_SP[subpage];                  // this subpage's result, before the merge and the fill-in
+  bool compare = (defectRawValid >> subpage) & 1;
+  for (int i = 0; i < NUM_PIXELS; i++) {
+    int16_t raw = (int16_t)words[i + (i & ~31)];
+    defectDead[i] += isnan(T[i]) || raw == 32767 || raw == -32768;
+    defectStill[i] += compare && raw == defectRaw[subpage][i];
+    defectRaw[subpage][i] = raw;
+    uint8_t good = 0, close = 0;
+    for (int k = 0; k < 4; k++) {
+      uint8_t j = neighbours[i][k];
+      bool g = (j != i) && !isnan(T[j]) && badPixels[j] == 0;
+      good += g;
+      close += g && fabsf(T[i] - T[j]) <= defectOutlier;
     }
+    defectFar[i] += !isnan(T[i]) && good >= 2 && close == 0;
+  }
+  defectCompared += compare;
+  defectRawValid |= 1 << subpage;
+  if (++defectFrames < defectWindow) return;
 
-    // IR data compensation - 11.2.2.5.3. Ta0 = 25 (°C), VddV0=3.3
-	float pix_OS_SP1[NUM_PIXELS] = { 0.0 };
-    for (int i = 0; i < NUM_PIXELS; i++) {
-      pix_OS_SP1[i] = pix_gain_S1[i] - (float)pix_OS_ref_SP1[i] * (1.0 + MLX90641::Kta[i] * (Ta - 25.0)) * (1.0 + Kv[i] * (Vdd - 3.3));
+  uint16_t moving = 0;  // pixels whose raw word changed during the window
+  for (int i = 0; i < NUM_PIXELS; i++) moving += defectStill[i] < defectCompared;
+  bool sceneMoves = defectCompared > 0 && moving >= NUM_PIXELS / 2;
+  for (int i = 0; i < NUM_PIXELS; i++) {
+    uint8_t causes = 0;
+    if (2 * defectDead[i] > defectFrames) causes |= DEFECT_DEAD;
+    if (sceneMoves && defectStill[i] >= defectCompared) causes |= DEFECT_STUCK;
+    if (4 * defectFar[i] >= 3 * defectFrames) causes |= DEFECT_OUTLIER;
+    badPixels[i] = (badPixels[i] & ~DEFECT_DETECTED) | causes;
+  }
+#ifdef DEBUG
+  Serial.print("updateDefectMap() flagged pixels: ");
+  Serial.println(countDefects());
+#endif
+  resetDefectWindow();
+}
+
+// Update the defect statistics, then replace every flagged pixel (and any pixel without a valid result in
+// this frame) with the average of its good neighbours - or 0 if it has none. One pass over the constant
+// neighbour table with selects instead of the old corner/edge/middle branches: a pixel listed as its own
+// neighbour is never good when it needs the fill-in, so it adds nothing.
+void MLX90641::fixBadPixels() {
+  updateDefectMap();
+  for (int w = 0; w < NUM_PIXELS / 32; w++) goodMask[w] = 0;
+  for (int i = 0; i < NUM_PIXELS; i++) goodMask[i >> 5] |= (uint32_t)(badPixels[i] == 0 && !isnan(T_o[i])) << (i & 31);
+  for (int i = 0; i < NUM_PIXELS; i++) {
+    float sum = 0.0f;
+    uint8_t n = 0;
+    for (int k = 0; k < 4; k++) {
+      uint8_t j = neighbours[i][k];
+      bool g = (goodMask[j >> 5] >> (j & 31)) & 1;
+      sum += g ? T_o[j] : 0.0f;
+      n += g;
     }
+    bool good = (goodMask[i >> 5] >> (i & 31)) & 1;
+    T_o[i] = good ? T_o[i] : sum * invCount[n];
+  }
+}
 
-    // Compensating offset, Ta and Vdd of CP pixel - 11.2.2.6.2
-    float CP_pix_OS = CP_pix_gain - pix_OS_ref_CP * (1.0 + KTa_CP * (Ta - 25.0)) * (1.0 + Kv_CP * (Vdd - 3.3));
-    for (int i = 0; i < NUM_PIXELS; i++) {
-      V_IR_compensated[i] = (pix_OS_SP1[i] - (TGC * CP_pix_OS)) / Emissivity;  //11.2.2.7
+// Start the non-blocking acquisition engine. Call poll() often (e.g. every loop() or from its own task).
+void MLX90641::start() {
+  state = MLX90641_WAIT_DATA;
+  lastPoll = millis() - POLL_INTERVAL;  // check the status register on the first poll()
+}
+
+// Stop the non-blocking acquisition engine (a frame in progress is dropped).
+void MLX90641::stop() {
+  state = MLX90641_IDLE;
+}
+
+// Set the function poll() calls when a new frame is ready in T_o[].
+void MLX90641::onFrame(MLX90641_FrameCallback callback) {
+  frameCallback = callback;
+}
+
+// Advance the acquisition engine by one short step and return. Each call does at most one
+// I2C transaction or COMPENSATE_STEP pixels of math, so the caller is never blocked for a whole frame.
+// Returns true when a new frame has been completed (after the onFrame() callback has run).
+bool MLX90641::poll() {
+  switch (state) {
+    case MLX90641_IDLE:
+      return false;
+
+    case MLX90641_WAIT_DATA: {
+      if (millis() - lastPoll < POLL_INTERVAL) return false;  // not time to check yet
+      lastPoll = millis();
+      uint16_t status = readAddr_unsigned(STATUS_ADDR);
+      if (status == 0xFC19 || (status & (1 << 3)) == 0) return false;  // bus error (-999) or no new data
+      subpage = status & 0x01;
+      statusWord = status;
+      frameValid = false;
+      busTime = 0;
+      stepPos = 0;
+      PROFILE_BEGIN();
+      state = MLX90641_READ_FRAME;
+      return false;
     }
 
-    // Normalizing to sensitivity - 11.2.2.8
-    float alpha_SP1[NUM_PIXELS] = { 0.0 };
-    // Scaling for Row 1:
-    for (int i = 0; i < 32; i++) {
-      alpha_SP1[i] = (float)alpha_reference_row1 * (float)alpha_pixel[i] / 2047.0f;  // 2^11 - 1 = 2047.0f
+    case MLX90641_READ_FRAME: {
+      PROFILE_SCOPE(MLX90641_STAGE_BUS);
+      uint16_t n = (FRAME_WORDS - stepPos > BURST_WORDS) ? BURST_WORDS : FRAME_WORDS - stepPos;
+      unsigned long t0 = micros();
+      bool ok = readWords(FRAME_ADDR + stepPos, n, &frameData[stepPos]);
+      busTime += micros() - t0;
+      if (!ok) {
+        frameErrors++;
+        state = MLX90641_WAIT_DATA;  // drop this frame, wait for the next one
+        return false;
+      }
+      stepPos += n;
+      if (stepPos >= FRAME_WORDS) {
+        frameValid = true;
+        frameReadTime = busTime;
+        state = MLX90641_CLEAR_BIT;
+      }
+      return false;
     }
-    // Scaling for Row 2:
-    for (int i = 32; i < 64; i++) {
-      alpha_SP1[i] = (float)alpha_reference_row2 * (float)alpha_pixel[i] / 2047.0f;
+
+    case MLX90641_CLEAR_BIT: {
+      // A single write: the status word read in WAIT_DATA with the new data bit cleared. If it fails, the
+      // bit stays set and the same frame is read again.
+      if (!writeStatus(statusWord & ~(1 << 3))) {
+        frameErrors++;
+        state = MLX90641_WAIT_DATA;
+        return false;
+      }
+      if (rawFrame != NULL) {  // hand the snapshot over as it is
+        copyRaw(rawFrame, statusWord);
+        PROFILE_END();
+        frameCount++;
+        state = MLX90641_WAIT_DATA;
+        if (frameCallback != NULL) frameCallback(this);
+        return true;
+      }
+      PROFILE_SCOPE(MLX90641_STAGE_PREPARE);
+      prepareFrame();  // per-frame constants from the snapshot
+      stepPos = 0;
+      state = MLX90641_COMPENSATE;
+      return false;
     }
-    // Scaling for Row 3:
-    for (int i = 64; i < 96; i++) {
-      alpha_SP1[i] = (float)alpha_reference_row3 * (float)alpha_pixel[i] / 2047.0f;
+
+    case MLX90641_COMPENSATE: {
+      PROFILE_SCOPE(MLX90641_STAGE_COMPENSATE);
+      compensatePixels(stepPos, COMPENSATE_STEP);
+      stepPos += COMPENSATE_STEP;
+      if (stepPos >= NUM_PIXELS) state = MLX90641_FIX_PIXELS;
+      return false;
     }
-    // Scaling for Row 4:
-    for (int i = 96; i < 128; i++) {
-      alpha_SP1[i] = (float)alpha_reference_row4 * (float)alpha_pixel[i] / 2047.0f;
+
+    case MLX90641_FIX_PIXELS: {
+      PROFILE_MARK();
+      fixBadPixels();
+      PROFILE_LAP(MLX90641_STAGE_FIX_PIXELS);
+      if (filter != NULL) filter->apply(T_o);
+      PROFILE_LAP(MLX90641_STAGE_FILTER);
+      publishFrame();
+      PROFILE_LAP(MLX90641_STAGE_PUBLISH);
+      PROFILE_END();
+      frameCount++;
+      state = MLX90641_WAIT_DATA;
+      if (frameCallback != NULL) frameCallback(this);
+      return true;
     }
-    // Scaling for Row 5:
-    for (int i = 128; i < 160; i++) {
-      alpha_SP1[i] = (float)alpha_reference_row5 * (float)alpha_pixel[i] / 2047.0f;
+  }
+  return false;
+}
+
+// Set the temporal filter run on T_o[] after the bad pixel fill-in, before the frame is published (NULL: none).
+// The filter keeps its own state, so give each sensor its own MLX90641_Filter.
+void MLX90641::setFilter(MLX90641_Filter *filter) {
+  this->filter = filter;
+}
+
+// Add every published frame to an event recorder (NULL: none). The recorder runs on the producer side, so it
+// sees every frame even when the consumer is slow.
+void MLX90641::setRecorder(MLX90641_EventRecorder *recorder) {
+  this->recorder = recorder;
+}
+
+// Publish every frame to a triple buffer owned by the application (about 2.7 KB), so latestFrame() hands
+// out whole frames. Without one (NULL, the default) nothing is published and the event recorder is not fed.
+// Set it before start(), not while poll() may publish.
+void MLX90641::setFrameStore(MLX90641_FrameStore *store) {
+  if (store != NULL) memset(store, 0, sizeof(*store));  // seq 0: nothing published yet
+  backSlot = 0;
+  sharedSlot = 1;
+  frontSlot = 2;
+  frameStore = store;
+}
+
+// Copy T_o[] into the producer's slot (with its statistics) and swap it with the shared slot (lock-free, single producer / single consumer).
+// The producer never waits for the consumer: if the consumer is slow, older unread frames are simply replaced.
+void MLX90641::publishFrame() {
+  if (frameStore == NULL) return;  // no frame store (setFrameStore())
+  MLX90641_Frame *f = &frameStore->slot[backSlot];
+  f->seq = ++publishSeq;
+  f->timestamp = millis();
+  f->subpage = subpage;
+  f->Ta = Ta;
+  computeStats(T_o, &f->stats, f->T_o);  // copy the pixels and gather the statistics in one pass
+  if (recorder != NULL) recorder->add(f);  // pre-trigger ring and event triggers (setRecorder())
+  backSlot = __atomic_exchange_n(&sharedSlot, (uint8_t)(backSlot | SLOT_FRESH), __ATOMIC_ACQ_REL) & 0x03;
+}
+
+// Statistics of 192 temperatures in one pass: global min/max with their pixel, mean, histogram and the
+// aggregates of every region of interest. NaN pixels are left out. If copy is not NULL, T[] is copied
+// into it on the way (publishFrame() fills the frame store this way, so the pixels are read only once).
+void MLX90641::computeStats(const float *T, MLX90641_Stats *stats, float *copy) {
+  float sum = 0.f, lo = INFINITY, hi = -INFINITY;
+  uint8_t n = 0, loPix = 0, hiPix = 0;
+  float roiSum[MAX_ROIS];
+  for (int r = 0; r < MAX_ROIS; r++) {
+    MLX90641_RoiStats &roi = stats->roi[r];
+    roi.pixels = 0;
+    roi.minPixel = 0;
+    roi.maxPixel = 0;
+    roi.min = INFINITY;
+    roi.max = -INFINITY;
+    roiSum[r] = 0.f;
+  }
+  memset(stats->histogram, 0, sizeof(stats->histogram));
+  for (int i = 0; i < NUM_PIXELS; i++) {
+    float v = T[i];
+    if (copy != NULL) copy[i] = v;
+    if (isnan(v)) continue;
+    n++;
+    sum += v;
+    if (v < lo) {
+      lo = v;
+      loPix = i;
     }
-    // Scaling for Row 6:
-    for (int i = 160; i < 192; i++) {
-      alpha_SP1[i] = (float)alpha_reference_row6 * (float)alpha_pixel[i] / 2047.0f;
+    if (v > hi) {
+      hi = v;
+      hiPix = i;
     }
-    // Define and calculate alpha_comp[i] - 11.2.2.8
-    for (int i = 0; i < NUM_PIXELS; i++) {
-      alpha_comp[i] = (alpha_SP1[i] - TGC * alpha_CP) * (1.0 + KsTa * (Ta - 25.0));
+    float b = (v - histMin) * histScale;  // clamp as float first, so that +-inf and far outliers are safe
+    stats->histogram[(b < 1.f) ? 0 : (b >= (float)(STATS_BINS - 1)) ? STATS_BINS - 1 : (int)b]++;
+    uint32_t word = i >> 5, bit = 1UL << (i & 31);
+    for (int r = 0; r < MAX_ROIS; r++) {
+      if (!(roiMask[r][word] & bit)) continue;
+      MLX90641_RoiStats &roi = stats->roi[r];
+      roi.pixels++;
+      roiSum[r] += v;
+      if (v < roi.min) {
+        roi.min = v;
+        roi.minPixel = i;
+      }
+      if (v > roi.max) {
+        roi.max = v;
+        roi.maxPixel = i;
+      }
     }
-  }  // end subpage 1
-  // Calculating To for basic temperature range (0-80°C) - 11.2.2.9
-  // From the datasheet: The IR signal received by the sensor has two components:
-  // 1. IR signal emitted by the object
-  // 2. IR signal reflected from the object (the source of this signal is surrounding environment of the sensor)
-  // In order to compensate correctly for the emissivity and achieve best accuracy we need to know the surrounding
-  // temperature which is responsible for the second component of the IR signal namely the reflected part - 𝑇𝑟.  In case
-  // this 𝑇𝑟 temperature is not available and cannot be provided it might be replaced by 𝑇𝑟≈𝑇𝑎−5.
-  float Ta_K4 = powf((Ta + 273.15), 4.0);               // powf() returns the a^b where a, b are both float numbers
-  float Tr_K4 = powf((Ta + 268.15), 4.0);               // assume Tr = Ta - 5.0 (surrounding air)
-  float Ta_r = Tr_K4 - ((Tr_K4 - Ta_K4) / Emissivity);  // this is T_a-r in the datasheet
-  float S_x[NUM_PIXELS] = { 0.0 };                      // define matrix to hold Sx values
-  // Edit the following formulas accordingly based on the temperature range the sensor will be measuring: 11.2.2.9.1
-  // If 𝑇𝑂(𝑖,𝑗) < -20°C we are in range 1 and we will use the parameters (𝐾𝑠𝑇𝑜1, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒1 and 𝐶𝑇1 = −40°𝐶)
-  // If -20°C < 𝑇𝑂(𝑖,𝑗) < -40°C we are in range 2 and we will use the parameters (𝐾𝑠𝑇𝑜2, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒2 and 𝐶𝑇2 = −20°𝐶)
-  // If 0°C < 𝑇𝑂(𝑖,𝑗) < 80°C we are in range 3 and we will use the parameters (𝐾𝑠𝑇𝑜3, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒3 and 𝐶𝑇3 = 0°𝐶)
-  // If 80°C < 𝑇𝑂(𝑖,𝑗) < 120°C we are in range 4 and we will use the parameters (𝐾𝑠𝑇𝑜4, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒4 and 𝐶𝑇4 = 80°𝐶)
-  // If 120°C < 𝑇𝑂(𝑖,𝑗) < CT6°C we are in range 5 and we will use the parameters (𝐾𝑠𝑇𝑜5, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒5 and 𝐶𝑇5 = 120°𝐶)
-  // If CT6°C < 𝑇𝑂(𝑖,𝑗) < CT7°C we are in range 6 and we will use the parameters (𝐾𝑠𝑇𝑜6, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒6 and 𝐶𝑇6 = 200°𝐶)
-  // If CT7°C < 𝑇𝑂(𝑖,𝑗) < CT8°C we are in range 7 and we will use the parameters (𝐾𝑠𝑇𝑜7, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒7 and 𝐶𝑇7 = 400°𝐶)
-  // If CT8°C < 𝑇𝑂(𝑖,𝑗)  we are in range 8 and we will use the parameters (𝐾𝑠𝑇𝑜8, 𝐴𝑙𝑝ℎ𝑎𝑐𝑜𝑟𝑟𝑟𝑎𝑛𝑔𝑒8 and 𝐶𝑇8 = 600°𝐶)
+  }
+  stats->pixels = n;
+  stats->minPixel = loPix;
+  stats->maxPixel = hiPix;
+  stats->min = n ? lo : NAN;
+  stats->max = n ? hi : NAN;
+  stats->mean = n ? sum / (float)n : NAN;
+  stats->histMin = histMin;
+  stats->histMax = histMax;
+  for (int r = 0; r < MAX_ROIS; r++) {
+    MLX90641_RoiStats &roi = stats->roi[r];
+    if (roi.pixels == 0) roi.min = roi.max = NAN;
+    roi.mean = roi.pixels ? roiSum[r] / (float)roi.pixels : NAN;
+  }
+}
 
-  for (int i = 0; i < NUM_PIXELS; i++) {
-    if (alpha_comp[i] < 1.0e-6) alpha_comp[i] = 1.0e-6;                                                                 // protects against small alpha_comp[] values
-    S_x[i] = KsTo3 * MLX90641::fourth_root(powf(alpha_comp[i], 3.0) * V_IR_compensated[i] + powf(alpha_comp[i], 4.0) * Ta_r);     // formula for S_x[i]
-    T_o[i] = MLX90641::fourth_root((V_IR_compensated[i] / (alpha_comp[i] * (1.0 - (KsTo3 * 273.15)) + S_x[i])) + Ta_r) - 273.15;  // formula for T_o[i]
-    // Apply post-hoc calibration equation - calibrate to desired surface (comment out if not needed)
-    //T_o[i] = T_o[i] + OFFSET;  // Only use OFFSET term for temperature adjustment
-    T_o[i] = T_o[i] * CAL_SLOPE + CAL_INT + OFFSET;  // adjust T_o based on calibration + OFFSET
-	//if(i==158)T_o[i]=100.0; // simulate a bad pixel (for debugging)
-	//if(i==176)T_o[i]=100.0; // simulate a bad pixel (for debugging)
+// Range of the frame histogram: STATS_BINS equal bins from lo to hi (°C). Returns false if hi <= lo.
+bool MLX90641::setHistogram(float lo, float hi) {
+  if (!(hi > lo)) return false;
+  histMin = lo;
+  histMax = hi;
+  histScale = (float)STATS_BINS / (hi - lo);
+  return true;
+}
 
-    float inner = (V_IR_compensated[i] / (alpha_comp[i] * (1.0 - (KsTo3 * 273.15)) + S_x[i])) + Ta_r;
-    if (inner < 0 || isnan(inner)) {
-	  badPixels[i]=true; // mark pixel as bad (math crashed)
-#ifdef DEBUG
-      Serial.print("BAD INNER @ " + (String)i + ", " + (String)inner);
-      Serial.print("Pixel ");
-      Serial.print(i);
-      Serial.print(" S_x[i] =");
-      Serial.print(S_x[i], 8);
-      Serial.print(" alpha_comp = ");
-      Serial.print(alpha_comp[i], 8);
-      Serial.print(" V_IR_comp = ");
-      Serial.println(V_IR_compensated[i], 8);
-#endif
+// Set region of interest n to the rectangle of width x height pixels whose top left pixel is (col, row).
+// Returns false if n or the rectangle is out of range.
+bool MLX90641::setRoi(uint8_t n, uint8_t col, uint8_t row, uint8_t width, uint8_t height) {
+  if (n >= MAX_ROIS || width == 0 || height == 0 || col + width > 16 || row + height > 12) return false;
+  memset(roiMask[n], 0, sizeof(roiMask[n]));
+  for (uint8_t y = row; y < row + height; y++) {
+    for (uint8_t x = col; x < col + width; x++) {
+      uint16_t i = y * 16 + x;
+      roiMask[n][i >> 5] |= 1UL << (i & 31);
     }
   }
-  // Bad pixel handling
-  for (int i = 0; i < NUM_PIXELS; i++) {
-    if(badPixels[i]){
-	  int numAdj=0;
-	  T_o[i]=0.0; 			   // clear out stored data in bad pixel
-	  if(i==0){                // Upper left corner: average of 2 surrounding pixels
-		if(!badPixels[i+1]){
-		  numAdj++;
-		  T_o[i]+=T_o[i+1];
-		}
-		if(!badPixels[i+16]){
-		  numAdj++;
-		  T_o[i]+=T_o[i+16];
-		}
-
-	  }else if(i==15){         // Upper right corner: average of 2 surrounding pixels
-	  	if(!badPixels[i-1]){
-		  numAdj++;
-		  T_o[i]+=T_o[i-1];
-		}
-		if(!badPixels[i+16]){
-		  numAdj++;
-		  T_o[i]+=T_o[i+16];
-		}
-	  
-	  }else if(i==176){        // Bottom left corner: average of 2 surrounding pixels
-	  	if(!badPixels[i+1]){
-		  numAdj++;
-		  T_o[i]+=T_o[i+1];
-		}
-		if(!badPixels[i-16]){
-		  numAdj++;
-		  T_o[i]+=T_o[i-16];
-		} 
-
-	  }else if(i==191){        // Bottom right corner: average of 2 surrounding pixels	
-	  	if(!badPixels[i-1]){
-		  numAdj++;
-		  T_o[i]+=T_o[i-1];
-		}
-		if(!badPixels[i-16]){
-		  numAdj++;
-		  T_o[i]+=T_o[i-16];
-		}
-  
-	  }else if(i>0 && i<15){   // Top row (minus corners): average of 3 surrounding pixels
-	  	if(!badPixels[i-1]){
-		  numAdj++;
-		  T_o[i]+=T_o[i-1];
-		}
-		if(!badPixels[i+1]){
-		  numAdj++;
-		  T_o[i]+=T_o[i+1];
-		}
-		if(!badPixels[i+16]){
-		  numAdj++;
-		  T_o[i]+=T_o[i+16];
-		}
-  
-	  }else if(i>176 && i <191){  // Bottom row (minus corners): average of 3 surrounding pixels
-	  	if(!badPixels[i-1]){
-		  numAdj++;
-		  T_o[i]+=T_o[i-1];
-		}
-		if(!badPixels[i+1]){
-		  numAdj++;
-		  T_o[i]+=T_o[i+1];
-		}
-		if(!badPixels[i-16]){
-		  numAdj++;
-		  T_o[i]+=T_o[i-16];
-		}  
-
-	  }else if(i>0 && i<176 && i%16==0){ // Left column (minus corners): average of 3 surrounding pixels
-		if(!badPixels[i-16]){
-		  numAdj++;
-		  T_o[i]+=T_o[i-16];
-		}
-		if(!badPixels[i+1]){
-		  numAdj++;
-		  T_o[i]+=T_o[i+1];
-		}
-		if(!badPixels[i+16]){
-		  numAdj++;
-		  T_o[i]+=T_o[i+16];
-		} 
-	  
-	  }else if(i>15 && i<191 && (i+1)%16==0){  // Right column (minus corners): average of 3 surrounding pixels
-		if(!badPixels[i-16]){
-		  numAdj++;
-		  T_o[i]+=T_o[i-16];
-		}
-		if(!badPixels[i-1]){
-		  numAdj++;
-		  T_o[i]+=T_o[i-1];
-		}
-		if(!badPixels[i+16]){
-		  numAdj++;
-		  T_o[i]+=T_o[i+16];
-		} 	   
-	  
-	  }else{  // Middle (not an edge pixel): average of 4 surrounding pixels
-		if(!badPixels[i-16]){
-		  numAdj++;
-		  T_o[i]+=T_o[i-16];
-		}
-		if(!badPixels[i-1]){
-		  numAdj++;
-		  T_o[i]+=T_o[i-1];
-		}
-		if(!badPixels[i+16]){
-		  numAdj++;
-		  T_o[i]+=T_o[i+16];
-		}
-		if(!badPixels[i+1]){
-		  numAdj++;
-		  T_o[i]+=T_o[i+1];
-		}		
-	  }
-	  if(numAdj>0){
-		T_o[i]/=(float)numAdj;   // calculate average	
-	  }
-    }
+  return true;
+}
+
+// Set region of interest n to any set of pixels: pixel i belongs to it if mask[i] != 0 (192 bytes, row by row).
+bool MLX90641::setRoiMask(uint8_t n, const uint8_t *mask) {
+  if (n >= MAX_ROIS || mask == NULL) return false;
+  memset(roiMask[n], 0, sizeof(roiMask[n]));
+  for (uint16_t i = 0; i < NUM_PIXELS; i++) {
+    if (mask[i]) roiMask[n][i >> 5] |= 1UL << (i & 31);
   }
+  return true;
+}
 
-#ifdef DEBUG
-  Serial.print("Subpage: ");
-  Serial.println(subpage);
-  Serial.print("readTempC() Ta_K4: ");
-  Serial.print("Ta_K4/1e9 = ");
-  Serial.print(Ta_K4 / 1e9, 6);
-  Serial.println(", example value: 9866871831.80621 ");  // 11.2.2.8
-  Serial.print("readTempC() Tr_K4: ");
-  Serial.print("Tr_K4/1e9 = ");
-  Serial.print(Tr_K4 / 1e9, 6);
-  Serial.println(", example value: 9253097577.685506 ");  // 11.2.2.8
-  Serial.print("readTempC() Ta_r/1e9 = ");
-  Serial.print(Ta_r / 1e9, 6);
-  Serial.println(", example value: 9899175739.92 ");  // 11.2.2.8
-  Serial.print("readTempC() S_x[95] * 1e8 = ");
-  Serial.print(S_x[95] * 1e8, 6);
-  Serial.println(", example value: -8.18463664533495E-08");  // 11.2.2.8
-  Serial.print("readTempC() T_o[95] = ");
-  Serial.print(T_o[95], 1);
-  Serial.println(", example value: 80.12");  // 11.2.2.8
+// Stop aggregating region of interest n (its entry in the frame statistics reads 0 pixels).
+void MLX90641::clearRoi(uint8_t n) {
+  if (n < MAX_ROIS) memset(roiMask[n], 0, sizeof(roiMask[n]));
+}
 
-  Serial.println("Finished: basic temperature range.");
-#endif
+// True if a frame has been published since the last latestFrame() call.
+bool MLX90641::newFrameAvailable() {
+  return (__atomic_load_n(&sharedSlot, __ATOMIC_ACQUIRE) & SLOT_FRESH) != 0;
+}
+
+// Newest published frame (seq is 0 if nothing has been published yet, NULL without a frame store). Call from
+// one consumer only. The returned frame is not touched by the producer until the next latestFrame() call.
+const MLX90641_Frame *MLX90641::latestFrame() {
+  if (frameStore == NULL) return NULL;
+  if (newFrameAvailable()) {
+    frontSlot = __atomic_exchange_n(&sharedSlot, frontSlot, __ATOMIC_ACQ_REL) & 0x03;
+  }
+  return &frameStore->slot[frontSlot];
 }
 
 // To print a number to the Serial Monitor in exponential format (for debugging)
@@ -979,7 +1930,7 @@ String MLX90641::float2exp(float num, byte sigDigits) {
 
 // safer way to 2^ (won't overflow for big numbers)
 float MLX90641::two_to_the(uint32_t n) {
-  return (float)pow(2.0, (double)n);
+  return ldexpf(1.0f, (int)n);  // exact power of two, no double math
 }
 
 // fourth root done with two square roots
@@ -1024,17 +1975,36 @@ bool MLX90641::setRefreshRate(uint8_t rate) {
   config |= (rate << 7);   // Set new RR value
 
   // Write back to 0x800D
-  Wire.beginTransmission(MLX90641_ADDR);
-  Wire.write(0x80);
-  Wire.write(0x0D);           // Config register address
-  Wire.write(config >> 8);    // High byte
-  Wire.write(config & 0xFF);  // Low byte
+  bus->beginTransmission(i2cAddr);
+  bus->write(0x80);
+  bus->write(0x0D);           // Config register address
+  bus->write(config >> 8);    // High byte
+  bus->write(config & 0xFF);  // Low byte
 #ifdef DEBUG
   Serial.println("setRefreshRate() refreshrate");
   Serial.print("refresh rate set to 0x0");
   Serial.println(rate, HEX);
 #endif
-  return (Wire.endTransmission() == 0);
+  if (bus->endTransmission() != 0) return false;
+  controlReg = config;         // keep the cached control word (readVdd() resolution) in step
+  controlRegValid = true;
+  frameConstValid = false;
+  return true;
+}
+
+// Choose when prepareFrame() recomputes Kgain, Vdd and Ta, and the factors derived from them:
+// REFRESH_EVERY_FRAME (default), REFRESH_EVERY_N (every everyN frames) or REFRESH_ON_DRIFT (when Ta moves by more
+// than driftTa °C, Vdd by more than driftVdd V or Kgain by more than the fraction driftKgain since the last refresh).
+// Between refreshes the last values are kept. The next frame always refreshes.
+bool MLX90641::setRefreshPolicy(uint8_t policy, uint16_t everyN, float driftTa, float driftVdd, float driftKgain) {
+  if (policy > REFRESH_ON_DRIFT || everyN == 0) return false;  // invalid policy
+  refreshPolicy = policy;
+  refreshEveryN = everyN;
+  refreshDriftTa = driftTa;
+  refreshDriftVdd = driftVdd;
+  refreshDriftKgain = driftKgain;
+  refreshDue = true;
+  return true;
 }
 
 // Print pixels to serial monitor
@@ -1053,3 +2023,610 @@ void MLX90641::printFrame(float *Tdat) {
   Serial.write((uint8_t*)frameBuffer, index);
 }
 
+// Write a published frame in the binary stream format: 406 bytes absolute, about 214 bytes as a delta frame
+// (vs. ~1.2 KB for printFrame()). Frames that are not sent do not break the delta chain. The encoder holds
+// the scale, the keyframe interval and the delta reference: use one encoder per stream.
+size_t MLX90641::streamFrame(const MLX90641_Frame *frame, MLX90641_StreamEncoder &encoder, Print &out, uint8_t encoding) {
+  unsigned long t0 = micros();
+  size_t n = encoder.encode(frame->T_o, frame->Ta, frame->seq, (uint32_t)frame->timestamp, frame->subpage, encoding, (uint8_t *)frameBuffer);
+  streamEncodeTime = micros() - t0;
+  return out.write((const uint8_t *)frameBuffer, n);
+}
+
+MLX90641_Filter::MLX90641_Filter(uint8_t mode) {
+  filterMode = (mode > FILTER_KALMAN) ? FILTER_NONE : mode;
+  iirAlpha = FILTER_ALPHA;
+  medianWindow = 3;
+  kalmanQ = FILTER_Q;
+  kalmanR = FILTER_R;
+  kalmanGate = FILTER_GATE;
+  reset();
+}
+
+bool MLX90641_Filter::setIIR(float alpha) {
+  if (!(alpha > 0.0f && alpha <= 1.0f)) return false;
+  iirAlpha = alpha;
+  filterMode = FILTER_IIR;
+  reset();
+  return true;
+}
+
+bool MLX90641_Filter::setMedian(uint8_t window) {
+  if (window != 3 && window != 5) return false;  // sorting networks for 3 and 5 frames
+  medianWindow = window;
+  filterMode = FILTER_MEDIAN;
+  reset();
+  return true;
+}
+
+bool MLX90641_Filter::setKalman(float q, float r, float gate) {
+  if (!(q >= 0.0f && r > 0.0f && gate >= 0.0f)) return false;
+  kalmanQ = q;
+  kalmanR = r;
+  kalmanGate = gate;
+  filterMode = FILTER_KALMAN;
+  reset();
+  return true;
+}
+
+void MLX90641_Filter::reset() {
+  for (int k = 0; k < FILTER_MEDIAN_MAX; k++) {
+    for (int i = 0; i < NUM_PIXELS; i++) state[k][i] = 0.0f;
+  }
+  pos = 0;
+  primed = false;
+}
+
+static inline float median3(float a, float b, float c) {
+  return fmaxf(fminf(a, b), fminf(fmaxf(a, b), c));
+}
+
+// Median of 5 with min/max only: the larger of the two pair minimums and the smaller of the two pair maximums
+// bracket the median of the first four, and the fifth value picks between them.
+static inline float median5(float a, float b, float c, float d, float e) {
+  return median3(e, fmaxf(fminf(a, b), fminf(c, d)), fminf(fmaxf(a, b), fmaxf(c, d)));
+}
+
+// Filter one frame in place. One branch-free loop over the pixels: a multiply-add for the IIR, min/max for
+// the median, and one division (the gain) per pixel for the Kalman filter.
+void MLX90641_Filter::apply(float *T) {
+  if (filterMode == FILTER_NONE) return;
+  if (!primed) {  // first frame: start every filter from it
+    for (int i = 0; i < NUM_PIXELS; i++) {
+      for (int k = 0; k < FILTER_MEDIAN_MAX; k++) state[k][i] = T[i];
+      if (filterMode == FILTER_KALMAN) state[1][i] = kalmanR;  // variance of a single measurement
+    }
+    primed = true;
+    return;
+  }
+  if (filterMode == FILTER_IIR) {
+    float *y = state[0];
+    for (int i = 0; i < NUM_PIXELS; i++) {
+      y[i] += iirAlpha * (T[i] - y[i]);
+      T[i] = y[i];
+    }
+  } else if (filterMode == FILTER_MEDIAN) {
+    for (int i = 0; i < NUM_PIXELS; i++) state[pos][i] = T[i];
+    pos = (pos + 1 < medianWindow) ? pos + 1 : 0;
+    if (medianWindow == 3) {
+      for (int i = 0; i < NUM_PIXELS; i++) T[i] = median3(state[0][i], state[1][i], state[2][i]);
+    } else {
+      for (int i = 0; i < NUM_PIXELS; i++) T[i] = median5(state[0][i], state[1][i], state[2][i], state[3][i], state[4][i]);
+    }
+  } else {
+    float *x = state[0], *P = state[1];
+    float gate2 = kalmanGate * kalmanGate;
+    for (int i = 0; i < NUM_PIXELS; i++) {
+      float p = P[i] + kalmanQ;                    // predict: the scene may have moved by q
+      float e = T[i] - x[i];                       // innovation
+      float k = p / (p + kalmanR);                 // Kalman gain
+      bool jump = gate2 > 0.0f && e * e > gate2 * (p + kalmanR);  // a real change: restart from the measurement
+      x[i] = jump ? T[i] : x[i] + k * e;
+      P[i] = jump ? kalmanR : (1.0f - k) * p;
+      T[i] = x[i];
+    }
+  }
+}
+
+uint8_t MLX90641_Filter::mode() {
+  return filterMode;
+}
+
+float MLX90641_Filter::alpha() {
+  return iirAlpha;
+}
+
+uint8_t MLX90641_Filter::window() {
+  return medianWindow;
+}
+
+float MLX90641_Filter::q() {
+  return kalmanQ;
+}
+
+float MLX90641_Filter::r() {
+  return kalmanR;
+}
+
+float MLX90641_Filter::gate() {
+  return kalmanGate;
+}
+
+// Pre-trigger event recorder: a ring of compact frames, frozen around the frame that fired a trigger.
+MLX90641_EventRecorder::MLX90641_EventRecorder() {
+  preFrames = EVENT_FRAMES / 2;
+  postFrames = EVENT_FRAMES / 2 - 1;
+  triggers = 0;
+  maxThreshold = 0.0f;
+  maxRoi = EVENT_WHOLE_FRAME;
+  riseThreshold = 0.0f;
+  riseRoi = EVENT_WHOLE_FRAME;
+  countThreshold = 0;
+  countPixels = NUM_PIXELS;
+  triggerSlot = 0;
+  preKept = 0;
+  postSeen = 0;
+  memset(ring, 0, sizeof(ring));
+  rearm();
+}
+
+// Frames to keep around the trigger frame. Returns false if pre + 1 + post exceeds EVENT_FRAMES.
+bool MLX90641_EventRecorder::setWindow(uint16_t pre, uint16_t post) {
+  if ((uint32_t)pre + 1 + post > EVENT_FRAMES) return false;
+  preFrames = pre;
+  postFrames = post;
+  rearm();
+  return true;
+}
+
+// °C to 1/EVENT_SCALE °C, clamped to ±655.34 °C; NaN becomes -32768
+static inline int16_t eventUnits(float T) {
+  float v = T * (float)EVENT_SCALE;
+  return isnan(v) ? -32768 : (v >= 32767.0f) ? 32767 : (v <= -32767.0f) ? -32767 : (int16_t)lroundf(v);
+}
+
+// Hottest pixel of a region of interest, or of the whole frame
+static inline float eventHottest(const MLX90641_Stats &s, uint8_t roi) {
+  return (roi < MAX_ROIS) ? s.roi[roi].max : s.max;
+}
+
+void MLX90641_EventRecorder::triggerOnMax(float threshold, uint8_t roi) {
+  maxThreshold = threshold;
+  maxRoi = roi;
+  triggers |= TRIGGER_MAX;
+}
+
+void MLX90641_EventRecorder::triggerOnRise(float degPerSecond, uint8_t roi) {
+  riseThreshold = degPerSecond;
+  riseRoi = roi;
+  riseLast = NAN;
+  triggers |= TRIGGER_RISE;
+}
+
+// The threshold is compared in stored units, so it must be within their range: a clamped threshold could never
+// be exceeded (or always would be). Returns false, leaving the trigger as it was, otherwise.
+bool MLX90641_EventRecorder::triggerOnCount(float threshold, uint16_t pixels) {
+  if (!(fabsf(threshold * (float)EVENT_SCALE) < 32767.0f)) return false;  // also rejects NaN
+  countThreshold = eventUnits(threshold);
+  countPixels = pixels;
+  triggers |= TRIGGER_COUNT;
+  return true;
+}
+
+// Can be called from another task: the flag is picked up by the next add().
+void MLX90641_EventRecorder::trigger() {
+  __atomic_store_n(&manual, true, __ATOMIC_RELEASE);
+}
+
+// Store the frame in the next slot (converting to 1/EVENT_SCALE °C and counting the pixels over the TRIGGER_COUNT
+// threshold in the same pass), then check the triggers from the frame statistics. Once a trigger fires, the
+// slots of the kept pre-trigger frames are never reached again before the event is frozen (pre + 1 + post <= EVENT_FRAMES).
+void MLX90641_EventRecorder::add(const MLX90641_Frame *frame) {
+  if (__atomic_load_n(&status, __ATOMIC_ACQUIRE) == EVENT_FROZEN) return;
+  MLX90641_EventFrame &e = ring[head];
+  e.seq = frame->seq;
+  e.timestamp = (uint32_t)frame->timestamp;
+  e.Ta = eventUnits(frame->Ta);
+  uint16_t over = 0;
+  for (int i = 0; i < NUM_PIXELS; i++) {
+    e.T[i] = eventUnits(frame->T_o[i]);
+    over += (e.T[i] > countThreshold);
+  }
+  uint16_t slot = head;
+  head = (head + 1) % EVENT_FRAMES;
+  if (count < EVENT_FRAMES) count++;
+
+  if (status == EVENT_TRIGGERED) {
+    if (++postSeen >= postFrames) __atomic_store_n(&status, (uint8_t)EVENT_FROZEN, __ATOMIC_RELEASE);
+    return;
+  }
+  uint8_t fired = __atomic_exchange_n(&manual, false, __ATOMIC_ACQ_REL) ? TRIGGER_MANUAL : 0;
+  if ((triggers & TRIGGER_MAX) && eventHottest(frame->stats, maxRoi) > maxThreshold) fired |= TRIGGER_MAX;
+  if (triggers & TRIGGER_RISE) {
+    float hot = eventHottest(frame->stats, riseRoi);
+    uint32_t dt = e.timestamp - riseTime;
+    if (!isnan(riseLast) && dt > 0 && (hot - riseLast) * 1000.0f > riseThreshold * (float)dt) fired |= TRIGGER_RISE;
+    riseLast = hot;
+    riseTime = e.timestamp;
+  }
+  if ((triggers & TRIGGER_COUNT) && over >= countPixels) fired |= TRIGGER_COUNT;
+  if (fired) {
+    cause = fired;
+    triggerSlot = slot;
+    preKept = (count - 1 < preFrames) ? count - 1 : preFrames;
+    postSeen = 0;
+    __atomic_store_n(&status, (uint8_t)(postFrames ? EVENT_TRIGGERED : EVENT_FROZEN), __ATOMIC_RELEASE);
+  }
+}
+
+uint8_t MLX90641_EventRecorder::state() {
+  return __atomic_load_n(&status, __ATOMIC_ACQUIRE);
+}
+
+uint16_t MLX90641_EventRecorder::eventFrames() {
+  return (state() == EVENT_FROZEN) ? preKept + 1 + postSeen : 0;
+}
+
+uint16_t MLX90641_EventRecorder::triggerIndex() {
+  return preKept;
+}
+
+// Frame k of a frozen event, oldest first: the trigger frame is frame triggerIndex().
+const MLX90641_EventFrame *MLX90641_EventRecorder::eventFrame(uint16_t k) {
+  if (k >= eventFrames()) return NULL;
+  return &ring[(triggerSlot + EVENT_FRAMES - preKept + k) % EVENT_FRAMES];
+}
+
+// Forget the event and the recorded frames. Call it from the producer's task, or once the event is frozen.
+void MLX90641_EventRecorder::rearm() {
+  head = 0;
+  count = 0;
+  cause = 0;
+  riseLast = NAN;
+  riseTime = 0;
+  __atomic_store_n(&manual, false, __ATOMIC_RELEASE);
+  __atomic_store_n(&status, (uint8_t)EVENT_ARMED, __ATOMIC_RELEASE);
+}
+
+// Blob detector: one-pass connected-component labelling with union-find.
+MLX90641_BlobDetector::MLX90641_BlobDetector() {
+  mode = BLOB_ABSOLUTE;
+  threshold = 0.0f;
+  minArea = 1;
+  diagonal = true;
+  count = 0;
+  found = 0;
+  memset(blobs, 0, sizeof(blobs));
+}
+
+void MLX90641_BlobDetector::setThreshold(float threshold, uint8_t mode) {
+  this->threshold = threshold;
+  this->mode = (mode > BLOB_ABOVE_TA) ? BLOB_ABSOLUTE : mode;
+}
+
+uint8_t MLX90641_BlobDetector::detect(const MLX90641_Frame *frame) {
+  float base = (mode == BLOB_ABOVE_MEAN) ? frame->stats.mean : (mode == BLOB_ABOVE_TA) ? frame->Ta : 0.0f;
+  return label(frame->T_o, threshold + base);
+}
+
+uint8_t MLX90641_BlobDetector::detect(const float *T, float Ta) {
+  float base = 0.0f;
+  if (mode == BLOB_ABOVE_MEAN) {
+    float sum = 0.0f;
+    int n = 0;
+    for (int i = 0; i < NUM_PIXELS; i++) {
+      if (isnan(T[i])) continue;
+      sum += T[i];
+      n++;
+    }
+    base = n ? sum / n : NAN;
+  } else if (mode == BLOB_ABOVE_TA) {
+    base = Ta;
+  }
+  return label(T, threshold + base);
+}
+
+// Keep the older (smaller) label as the root and merge the other one's statistics into it
+uint8_t MLX90641_BlobDetector::join(uint8_t a, uint8_t b) {
+  if (a == b) return a;
+  if (b < a) {
+    uint8_t t = a;
+    a = b;
+    b = t;
+  }
+  Label &r = labels[a];
+  const Label &o = labels[b];
+  r.area += o.area;
+  r.sumX += o.sumX;
+  r.sumY += o.sumY;
+  if (o.left < r.left) r.left = o.left;
+  if (o.right > r.right) r.right = o.right;
+  if (o.top < r.top) r.top = o.top;
+  if (o.bottom > r.bottom) r.bottom = o.bottom;
+  if (o.peak > r.peak) {
+    r.peak = o.peak;
+    r.peakPixel = o.peakPixel;
+  }
+  parent[b] = a;
+  return a;
+}
+
+// Raster scan. row[] holds the labels of the row above, overwritten left to right with the current row's, so
+// at column x: row[x - 1] is the left neighbour, row[x] the upper one and row[x + 1] the upper right one; the
+// upper left one is kept aside. Labels are resolved to their roots (path halving) before they are joined.
+// NaN pixels (and a NaN level) are background.
+uint8_t MLX90641_BlobDetector::label(const float *T, float level) {
+  uint8_t row[16];
+  uint8_t n = 0;
+  memset(row, 0, sizeof(row));
+  for (uint8_t y = 0; y < 12; y++) {
+    uint8_t upLeft = 0;
+    for (uint8_t x = 0; x < 16; x++) {
+      uint8_t i = y * 16 + x;
+      uint8_t up = row[x];
+      uint8_t l = 0;
+      if (T[i] > level) {
+        uint8_t nb[4] = { x ? row[x - 1] : (uint8_t)0, up, 0, 0 };
+        if (diagonal) {
+          nb[2] = upLeft;
+          nb[3] = (x < 15) ? row[x + 1] : 0;
+        }
+        for (int k = 0; k < 4; k++) {
+          uint8_t m = nb[k];
+          if (m == 0) continue;
+          while (parent[m] != m) m = parent[m] = parent[parent[m]];
+          l = l ? join(l, m) : m;
+        }
+        if (l == 0) {  // no labelled neighbour: new label (at most 8 per row, see BLOB_LABELS)
+          l = ++n;
+          parent[l] = l;
+          Label &c = labels[l];
+          c.area = 0;
+          c.sumX = 0;
+          c.sumY = 0;
+          c.left = c.right = x;
+          c.top = c.bottom = y;
+          c.peak = T[i];
+          c.peakPixel = i;
+        }
+        Label &c = labels[l];
+        c.area++;
+        c.sumX += x;
+        c.sumY += y;
+        if (x < c.left) c.left = x;
+        if (x > c.right) c.right = x;
+        c.bottom = y;  // rows are scanned in order: y is the lowest row so far
+        if (T[i] > c.peak) {
+          c.peak = T[i];
+          c.peakPixel = i;
+        }
+      }
+      upLeft = up;
+      row[x] = l;
+    }
+  }
+
+  // Roots are the blobs: keep the MAX_BLOBS largest, sorted by insertion
+  count = 0;
+  found = 0;
+  for (uint8_t l = 1; l <= n; l++) {
+    const Label &c = labels[l];
+    if (parent[l] != l || c.area < minArea) continue;
+    found++;
+    int k = count;
+    while (k > 0 && (blobs[k - 1].area < c.area || (blobs[k - 1].area == c.area && blobs[k - 1].peak < c.peak))) k--;
+    if (k >= MAX_BLOBS) continue;
+    int last = (count < MAX_BLOBS) ? count : MAX_BLOBS - 1;
+    for (int j = last; j > k; j--) blobs[j] = blobs[j - 1];
+    if (count < MAX_BLOBS) count++;
+    MLX90641_Blob &b = blobs[k];
+    b.area = c.area;
+    b.x = (float)c.sumX / c.area;
+    b.y = (float)c.sumY / c.area;
+    b.left = c.left;
+    b.top = c.top;
+    b.right = c.right;
+    b.bottom = c.bottom;
+    b.peak = c.peak;
+    b.peakPixel = c.peakPixel;
+  }
+  return count;
+}
+
+#ifdef PROFILE_PIPELINE
+// Per-stage frame timing. Samples are per-frame sums, so a stage split over several poll() calls counts once per frame.
+MLX90641_Profiler::MLX90641_Profiler() {
+  reset();
+}
+
+void MLX90641_Profiler::reset() {
+  frames = 0;
+  next = 0;
+  for (int s = 0; s < MLX90641_STAGES; s++) {
+    frameTicks[s] = 0;
+    for (int k = 0; k < PROFILE_SAMPLES; k++) samples[s][k] = 0;
+  }
+}
+
+void MLX90641_Profiler::beginFrame() {
+  for (int s = 0; s < MLX90641_STAGES; s++) frameTicks[s] = 0;
+}
+
+void MLX90641_Profiler::accumulate(uint8_t stage, uint32_t ticks) {
+  if (stage < MLX90641_STAGES) frameTicks[stage] += ticks;
+}
+
+void MLX90641_Profiler::endFrame() {
+  frameTicks[MLX90641_STAGE_FRAME] = 0;
+  for (int s = MLX90641_STAGE_BUS; s < MLX90641_STAGE_FRAME; s++) frameTicks[MLX90641_STAGE_FRAME] += frameTicks[s];
+  for (int s = 0; s < MLX90641_STAGES; s++) samples[s][next] = frameTicks[s];
+  next = (next + 1) % PROFILE_SAMPLES;
+  frames++;
+}
+
+uint32_t MLX90641_Profiler::count(uint8_t stage) {
+  if (stage >= MLX90641_STAGES) return 0;
+  return (frames < PROFILE_SAMPLES) ? frames : PROFILE_SAMPLES;
+}
+
+float MLX90641_Profiler::minUs(uint8_t stage) {
+  uint32_t n = count(stage);
+  if (n == 0) return 0.0f;
+  uint32_t m = samples[stage][0];
+  for (uint32_t k = 1; k < n; k++) {
+    if (samples[stage][k] < m) m = samples[stage][k];
+  }
+  return (float)m / ticksPerUs();
+}
+
+float MLX90641_Profiler::meanUs(uint8_t stage) {
+  uint32_t n = count(stage);
+  if (n == 0) return 0.0f;
+  uint64_t sum = 0;
+  for (uint32_t k = 0; k < n; k++) sum += samples[stage][k];
+  return (float)sum / (float)n / ticksPerUs();
+}
+
+// Nearest-rank 99th percentile: sorts a copy of the kept samples on the stack (insertion sort, PROFILE_SAMPLES
+// is small), so profilers on different tasks can report at the same time
+float MLX90641_Profiler::p99Us(uint8_t stage) {
+  uint32_t sorted[PROFILE_SAMPLES];
+  uint32_t n = count(stage);
+  if (n == 0) return 0.0f;
+  for (uint32_t k = 0; k < n; k++) {
+    uint32_t v = samples[stage][k];
+    uint32_t j = k;
+    while (j > 0 && sorted[j - 1] > v) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = v;
+  }
+  uint32_t rank = (99 * n + 99) / 100;  // ceil(0.99 * n)
+  return (float)sorted[rank - 1] / ticksPerUs();
+}
+
+float MLX90641_Profiler::maxUs(uint8_t stage) {
+  uint32_t n = count(stage);
+  uint32_t m = 0;
+  for (uint32_t k = 0; k < n; k++) {
+    if (samples[stage][k] > m) m = samples[stage][k];
+  }
+  return (float)m / ticksPerUs();
+}
+
+// Print one JSON object, e.g. {"frames":128,"stages":{"bus":{"n":128,"min_us":...,"mean_us":...,"p99_us":...,"max_us":...},...}}
+void MLX90641_Profiler::printReport(Print &out) {
+  out.print("{\"frames\":");
+  out.print(frames);
+  out.print(",\"stages\":{");
+  for (uint8_t s = 0; s < MLX90641_STAGES; s++) {
+    if (s > 0) out.print(",");
+    out.print("\"");
+    out.print(stageName(s));
+    out.print("\":{\"n\":");
+    out.print(count(s));
+    out.print(",\"min_us\":");
+    out.print(minUs(s), 2);
+    out.print(",\"mean_us\":");
+    out.print(meanUs(s), 2);
+    out.print(",\"p99_us\":");
+    out.print(p99Us(s), 2);
+    out.print(",\"max_us\":");
+    out.print(maxUs(s), 2);
+    out.print("}");
+  }
+  out.print("}}");
+}
+
+// CPU cycles on the ESP32 (wraps after ~17 s at 240 MHz, fine for per-stage differences)
+uint32_t MLX90641_Profiler::ticks() {
+#if defined(ARDUINO_ARCH_ESP32)
+  return ESP.getCycleCount();
+#elif !defined(ARDUINO)
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+  return micros();
+#endif
+}
+
+float MLX90641_Profiler::ticksPerUs() {
+#if defined(ARDUINO_ARCH_ESP32)
+  return (float)ESP.getCpuFreqMHz();
+#elif !defined(ARDUINO)
+  return 1000.0f;
+#else
+  return 1.0f;
+#endif
+}
+
+const char *MLX90641_Profiler::stageName(uint8_t stage) {
+  static const char *const names[MLX90641_STAGES] = {"bus", "prepare", "compensate", "fix_pixels", "filter", "publish", "frame", "register"};
+  return (stage < MLX90641_STAGES) ? names[stage] : "?";
+}
+#endif
+
+// Scheduler for several sensors: each sensor keeps its own bus, address, refresh rate and onFrame() callback.
+MLX90641_Scheduler::MLX90641_Scheduler() {
+  numSensors = 0;
+  numBuses = 0;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    sensors[i] = NULL;
+    buses[i] = NULL;
+    reading[i] = -1;
+    nextCheck[i] = 0;
+  }
+}
+
+// Add a sensor (calibrate it first). Sensors sharing a TwoWire object share a bus.
+bool MLX90641_Scheduler::add(MLX90641 *sensor) {
+  if (numSensors >= MAX_SENSORS) return false;
+  sensors[numSensors++] = sensor;
+  for (uint8_t b = 0; b < numBuses; b++) {
+    if (buses[b] == sensor->bus) return true;  // bus already known
+  }
+  buses[numBuses++] = sensor->bus;
+  return true;
+}
+
+void MLX90641_Scheduler::start() {
+  for (uint8_t i = 0; i < numSensors; i++) sensors[i]->start();
+}
+
+void MLX90641_Scheduler::stop() {
+  for (uint8_t i = 0; i < numSensors; i++) sensors[i]->stop();
+  for (uint8_t b = 0; b < numBuses; b++) reading[b] = -1;
+}
+
+// One scheduling round. On each bus, one frame read at a time is carried through to the end (one burst per round),
+// so the snapshot is taken as quickly as possible after the sensor signals new data. While no read is in progress,
+// the sensors on that bus get their (rate-limited) status checks in round-robin order, starting after the last one
+// that had data. The math steps (COMPENSATE, FIX_PIXELS) use no bus and run for every sensor in every round.
+// Returns the number of frames completed in this round.
+uint8_t MLX90641_Scheduler::poll() {
+  uint8_t frames = 0;
+  for (uint8_t b = 0; b < numBuses; b++) {
+    int8_t r = reading[b];
+    if (r >= 0 && (sensors[r]->state == MLX90641_READ_FRAME || sensors[r]->state == MLX90641_CLEAR_BIT)) {
+      frames += sensors[r]->poll();  // next burst of the frame in progress (a raw frame ends on its last step)
+      continue;
+    }
+    reading[b] = -1;
+    for (uint8_t k = 0; k < numSensors; k++) {
+      uint8_t i = (nextCheck[b] + k) % numSensors;
+      MLX90641 *s = sensors[i];
+      if (s->bus != buses[b] || s->state != MLX90641_WAIT_DATA) continue;
+      s->poll();  // status check (no bus traffic if POLL_INTERVAL has not elapsed)
+      if (s->state == MLX90641_READ_FRAME) {  // new data: read this frame before checking the others
+        reading[b] = i;
+        nextCheck[b] = (i + 1) % numSensors;
+        break;
+      }
+    }
+  }
+  for (uint8_t i = 0; i < numSensors; i++) {
+    MLX90641 *s = sensors[i];
+    if (s->state == MLX90641_COMPENSATE || s->state == MLX90641_FIX_PIXELS) frames += s->poll();
+  }
+  return frames;
+}
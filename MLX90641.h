@@ -2,69 +2,496 @@
 #define MLX90641_h
 
 #include <Arduino.h>
+#include <Wire.h>
+#include "MLX90641_Stream.h"
 
-// USER CONFIGURATION - Override these in your .ino AFTER #include "MLX90641.h"
+// USER CONFIGURATION - edit these here, or set them from the build (e.g. -DCAL_SLOPE=1.0) so the library and the sketch agree
 //#define DEBUG                             // show calculated and example values for calibration constants
+//#define FIXED_POINT_MATH                  // scaled-integer compensation kernel for MCUs without an FPU (ATmega2560, ESP32-C3), within 0.03°C of the float kernel
+//#define SIMD_MATH                         // branch-free struct-of-arrays float kernel, 4 pixels at a time with SSE2/NEON (host builds)
+//#define PROFILE_PIPELINE                  // time each frame stage (cycle counter on the ESP32), see MLX90641_Profiler
+#ifndef OFFSET
 #define OFFSET 0.0                          // posthoc cheap temperature adjustment (shift)
+#endif
+#ifndef MLX90641_ADDR
 #define MLX90641_ADDR 0x33                  // I2C bit address of the MLX90641
+#endif
 #define NUM_PIXELS 192                      // number of pixels
-#define BLOCK_SIZE 8                        // block size for reading words
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 64                       // max words per sequential I2C read (capped to the Wire buffer)
+#endif
+#ifndef EEPROM_RETRIES
+#define EEPROM_RETRIES 3                    // attempts per EEPROM block before readEEPROMBlock() gives up
+#endif
+#ifndef I2C_SPEED
 #define I2C_SPEED 100000                    // safe speed is 100 kHz
+#endif
+#ifndef REFRESH_RATE
 #define REFRESH_RATE 0x03                   // 0x00 (0.5 Hz) to 0x07 (64 Hz). Default: 0x03 (4 Hz)
+#endif
+#ifndef SAMPLE_DELAY
 #define SAMPLE_DELAY 300                    // delay between reading samples (see setRefreshRate() table)
+#endif
+#ifndef POR_DELAY
 #define POR_DELAY SAMPLE_DELAY * 2.0 * 1.2  // delay required after power on reset (see setRefreshRate() table)
+#endif
 #define FRAME_ADDR 0x0400                   // Starting address for pixel data in RAM
 #define STATUS_ADDR 0x8000                  // Address for Status Register
-#define CAL_INT -45.4209807273067           // Intercept of T_meas vs. T_o calibration curve (post-hoc calibration). My value: -45.4209807273067 
-#define CAL_SLOPE 2.64896693658985          // Slope of T_meas vs. T_o calibration curve (post-hoc calibration). My value: 2.64896693658985 
+#define FRAME_WORDS 448                     // RAM words read per frame (0x0400..0x05BF: pixels, VBE, CP, gain, PTAT, Vdd)
+#ifndef CAL_INT
+#define CAL_INT 0.0                         // Intercept of T_meas vs. T_o calibration curve (post-hoc calibration). Fit made under the old 1e-6 alpha_comp limit: -45.4209807273067
+#endif
+#ifndef CAL_SLOPE
+#define CAL_SLOPE 1.0                       // Slope of T_meas vs. T_o calibration curve (post-hoc calibration). Fit made under the old 1e-6 alpha_comp limit: 2.64896693658985
+#endif
+#define ALPHA_COMP_MIN 1.0e-9               // lower limit of alpha_comp (11.2.2.8), real pixels are ~1e-7..1e-6
 #define EEPROM_WORDS 832                    // MLX90641 EEPROM size in 16-bit words
+#define SUBPAGE_LATEST 0                    // setSubpageMode(): whole frame from the latest subpage (default)
+#define SUBPAGE_CHESS 1                     // setSubpageMode(): chess pattern, pixel (row+col) even from subpage 0, odd from subpage 1
+#define SUBPAGE_INTERLEAVED 2               // setSubpageMode(): even rows from subpage 0, odd rows from subpage 1
+#define SUBPAGE_AVERAGE 3                   // setSubpageMode(): average of the last result of both subpages
+#ifndef POLL_INTERVAL
+#define POLL_INTERVAL 10                    // ms between status checks while poll() waits for a new frame
+#endif
+#ifndef COMPENSATE_STEP
+#define COMPENSATE_STEP 32                  // pixels compensated per poll() call
+#endif
+#define REFRESH_EVERY_FRAME 0               // setRefreshPolicy(): recompute Kgain, Vdd and Ta on every frame (default)
+#define REFRESH_EVERY_N 1                   // setRefreshPolicy(): recompute them every N frames
+#define REFRESH_ON_DRIFT 2                  // setRefreshPolicy(): recompute the factors derived from them only when one drifts past its threshold
+#ifndef REFRESH_N
+#define REFRESH_N 8                         // default N for REFRESH_EVERY_N
+#endif
+#ifndef REFRESH_DRIFT_TA
+#define REFRESH_DRIFT_TA 0.05               // default REFRESH_ON_DRIFT threshold for Ta (°C)
+#endif
+#ifndef REFRESH_DRIFT_VDD
+#define REFRESH_DRIFT_VDD 0.005             // default REFRESH_ON_DRIFT threshold for Vdd (V)
+#endif
+#ifndef REFRESH_DRIFT_KGAIN
+#define REFRESH_DRIFT_KGAIN 0.001           // default REFRESH_ON_DRIFT threshold for Kgain (relative)
+#endif
+#define DEFECT_MANUAL 0x01                  // badPixels[] cause bits: flagged by the sketch (badPixels[i] = true)
+#define DEFECT_EEPROM 0x02                  // marked defective in the EEPROM (all four calibration words zero)
+#define DEFECT_DEAD 0x04                    // no valid output (NaN or a railed raw word) on most frames of a window
+#define DEFECT_STUCK 0x08                   // raw word did not change over a window while most pixels did
+#define DEFECT_OUTLIER 0x10                 // far from its neighbours on most frames of a window
+#define DEFECT_DETECTED (DEFECT_DEAD | DEFECT_STUCK | DEFECT_OUTLIER)  // re-evaluated at the end of every window
+#define DEFECT_ANY 0xFF
+#ifndef DEFECT_WINDOW
+#define DEFECT_WINDOW 0                     // frames per defect statistics window (1..255, 0: no statistics; opt-in, see setDefectWindow())
+#endif
+#ifndef DEFECT_OUTLIER_C
+#define DEFECT_OUTLIER_C 8.0                // outlier threshold: distance to every good neighbour (°C)
+#endif
+#define FILTER_NONE 0                       // MLX90641_Filter modes: pass frames through unchanged
+#define FILTER_IIR 1                        // exponential moving average
+#define FILTER_MEDIAN 2                     // running median of the last 3 or 5 frames
+#define FILTER_KALMAN 3                     // 1-D Kalman filter (random walk), resets on a jump
+#define FILTER_MEDIAN_MAX 5                 // longest running median window (frames)
+#ifndef FILTER_ALPHA
+#define FILTER_ALPHA 0.25                   // default FILTER_IIR weight of the new frame
+#endif
+#ifndef FILTER_Q
+#define FILTER_Q 0.01                       // default FILTER_KALMAN process noise (°C^2 per frame)
+#endif
+#ifndef FILTER_R
+#define FILTER_R 0.25                       // default FILTER_KALMAN measurement noise (°C^2)
+#endif
+#ifndef FILTER_GATE
+#define FILTER_GATE 4.0                     // default FILTER_KALMAN jump gate (standard deviations, 0: off)
+#endif
+#ifndef EVENT_FRAMES
+#define EVENT_FRAMES 64                     // frames an MLX90641_EventRecorder keeps: pre-trigger + trigger + post-trigger (about 400 bytes each)
+#endif
+#define EVENT_SCALE 50                      // MLX90641_EventFrame units per °C: int16 covers ±655.34 °C, the whole range of the sensor
+#define EVENT_WHOLE_FRAME 0xFF              // trigger on the whole frame instead of a region of interest
+#define TRIGGER_MAX 0x01                    // trigger causes: the hottest pixel (of a region) above a threshold
+#define TRIGGER_RISE 0x02                   // the hottest pixel (of a region) rising faster than a threshold (°C/s)
+#define TRIGGER_COUNT 0x04                  // at least n pixels above a threshold
+#define TRIGGER_MANUAL 0x08                 // trigger() was called
+#define EVENT_ARMED 0                       // MLX90641_EventRecorder states: recording into the ring, watching the triggers
+#define EVENT_TRIGGERED 1                   // recording the post-trigger frames
+#define EVENT_FROZEN 2                      // event complete: frames kept until rearm()
+#ifndef MAX_BLOBS
+#define MAX_BLOBS 8                         // blobs an MLX90641_BlobDetector reports per frame (the largest ones)
+#endif
+#define BLOB_ABSOLUTE 0                     // MLX90641_BlobDetector thresholds: pixels above a temperature (°C)
+#define BLOB_ABOVE_MEAN 1                   // pixels more than a margin (°C) above the frame mean
+#define BLOB_ABOVE_TA 2                     // pixels more than a margin (°C) above the ambient temperature
+#define BLOB_LABELS (NUM_PIXELS / 2)        // provisional labels of one pass: a new label needs a background pixel on its left
+#ifndef STATS_BINS
+#define STATS_BINS 16                       // histogram bins of the frame statistics
+#endif
+#ifndef STATS_HIST_MIN
+#define STATS_HIST_MIN -20.0                // default lower edge of the histogram (°C)
+#endif
+#ifndef STATS_HIST_MAX
+#define STATS_HIST_MAX 140.0                // default upper edge of the histogram (°C)
+#endif
+#ifndef MAX_ROIS
+#define MAX_ROIS 4                          // regions of interest aggregated with every frame (setRoi(), setRoiMask())
+#endif
+#define SCRATCH_FLOATS (2 * NUM_PIXELS)     // size of the optional readTempC() scratch arena (alpha_comp[], S_x[], float kernel only)
+#ifndef MAX_SENSORS
+#define MAX_SENSORS 8                       // sensors one MLX90641_Scheduler can drive
+#endif
+#ifndef PROFILE_SAMPLES
+#define PROFILE_SAMPLES 128                 // frames kept per stage for the profiler's p99 (PROFILE_PIPELINE)
+#endif
+#ifndef FRAME_BUFFER_SIZE
 #define FRAME_BUFFER_SIZE 6000   			// for reading the temperatures and a faster serial print
+#endif
+#if FRAME_BUFFER_SIZE < STREAM_MAX_BYTES
+#error "FRAME_BUFFER_SIZE must hold one binary stream frame (STREAM_MAX_BYTES)"
+#endif
+#ifndef CALIBRATION_NAMESPACE
+#define CALIBRATION_NAMESPACE "mlx90641"     // NVS namespace used by saveCalibration() / loadCalibration() (ESP32)
+#endif
+
+// Per-pixel calibration table, filled by the EEPROM parsers and calcPixelTable() (struct of arrays, one entry per pixel, 16-byte aligned)
+struct __attribute__((aligned(16))) MLX90641_PixelCal {
+	float alpha[NUM_PIXELS];             // sensitivity, row-scaled and CP-compensated (alpha_SP - TGC * alpha_CP)
+	float offset[2][NUM_PIXELS];         // offset reference per subpage (pix_OS_ref_SP0, pix_OS_ref_SP1)
+	float Kta[NUM_PIXELS];               // Kta[i,j] coefficients
+	float Kv[NUM_PIXELS];                // Kv[i,j] coefficients
+};
+
+// Aggregates of one region of interest (see setRoi() / setRoiMask()). NaN pixels are left out.
+struct MLX90641_RoiStats {
+	uint8_t pixels;                      // valid pixels in the region (0: region not set, or no valid pixel)
+	uint8_t minPixel;                    // index of the coldest pixel (row = index / 16, column = index % 16)
+	uint8_t maxPixel;                    // index of the hottest pixel
+	float min;                           // lowest temperature (NaN if pixels is 0)
+	float max;                           // highest temperature (NaN if pixels is 0)
+	float mean;                          // average temperature (NaN if pixels is 0)
+};
+
+// Statistics of one frame, gathered by computeStats() in the same pass that publishes T_o[]. NaN pixels are left out.
+struct MLX90641_Stats {
+	uint8_t pixels;                      // valid pixels in the frame
+	uint8_t minPixel;                    // index of the coldest pixel (row = index / 16, column = index % 16)
+	uint8_t maxPixel;                    // index of the hottest pixel
+	float min;                           // lowest temperature (NaN if pixels is 0)
+	float max;                           // highest temperature (NaN if pixels is 0)
+	float mean;                          // average temperature (NaN if pixels is 0)
+	float histMin;                       // lower edge of histogram[0] (°C)
+	float histMax;                       // upper edge of histogram[STATS_BINS - 1] (°C)
+	uint8_t histogram[STATS_BINS];       // pixels per bin of (histMax - histMin) / STATS_BINS °C. Pixels outside the range count in the first or last bin
+	MLX90641_RoiStats roi[MAX_ROIS];     // one entry per region of interest
+};
+
+// One published frame (see publishFrame() / latestFrame())
+struct MLX90641_Frame {
+	uint32_t seq;                        // sequence number, counts up from 1 for each published frame
+	unsigned long timestamp;             // millis() when the frame was published
+	uint8_t subpage;                     // subpage the frame was measured on
+	float Ta;                            // ambient temperature for this frame
+	float T_o[NUM_PIXELS];               // final temperatures for this frame
+	MLX90641_Stats stats;                // min/max with their locations, mean, histogram and ROI aggregates of T_o[]
+};
+
+// Triple buffer of published frames, owned by the application (see setFrameStore())
+struct MLX90641_FrameStore {
+	MLX90641_Frame slot[3];              // producer slot, shared slot, consumer slot
+};
 
-// Static Variables:
-static uint16_t eeData[EEPROM_WORDS];       // to hold the EEPROM contents
+// Parsed calibration of one sensor, as stored by serializeCalibration() (e.g. in NVS) to skip the EEPROM
+// dump and parsing on a warm boot. Keyed by the device ID and the EEPROM checksums. Only 2- and 4-byte
+// members, so the layout is the same on the ESP32 and on host builds.
+#define CALIBRATION_MAGIC 0x4C43             // "CL"
+#define CALIBRATION_VERSION 3
+#define EEPROM_HEADER_WORDS 64               // EEPROM 0x2400..0x243F: device ID, configuration, and the words readVdd()/readTa()/readKgain() use each frame
+struct MLX90641_Calibration {
+	uint16_t magic;                      // CALIBRATION_MAGIC
+	uint16_t version;                    // CALIBRATION_VERSION
+	uint16_t size;                       // sizeof(MLX90641_Calibration)
+	uint16_t deviceID[3];                // key: device ID, EEPROM 0x2407..0x2409
+	uint16_t eepromCRC;                  // key: CRC-16 of all EEPROM_WORDS words
+	uint16_t headerCRC;                  // key: CRC-16 of the first EEPROM_HEADER_WORDS words (checked on load)
+	int16_t Vdd_25;
+	int16_t K_Vdd;
+	int16_t CT[8];
+	int16_t pix_OS_ref_CP;
+	int16_t pix_OS_ref_SP0[NUM_PIXELS];
+	int16_t pix_OS_ref_SP1[NUM_PIXELS];
+	float KsTa;
+	float KsTo[8];
+	float Alpha_cr[8];
+	float alpha_reference[6];            // alpha_reference_row1..6
+	float Emissivity;
+	float alpha_CP;
+	float Kv_CP;
+	float KTa_CP;
+	float TGC;
+	float alpha[NUM_PIXELS];             // pixCal.alpha (CP-compensated sensitivity)
+	float Kta[NUM_PIXELS];
+	float Kv[NUM_PIXELS];
+	uint8_t badPixels[NUM_PIXELS];       // defect map (DEFECT_* cause bits)
+	uint16_t crc;                        // CRC-16 of everything above
+};
+
+// Calibration export for compensating raw frames away from the sensor (see importCalibration()): the packed
+// calibration plus the EEPROM header and the control register, which the per-frame math reads from the device.
+struct MLX90641_CalibrationExport {
+	MLX90641_Calibration cal;            // packed calibration (serializeCalibration())
+	uint16_t eepromHeader[EEPROM_HEADER_WORDS];  // EEPROM 0x2400..0x243F
+	uint16_t controlReg;                 // control register 0x800D (ADC resolution, refresh rate)
+	uint16_t crc;                        // CRC-16 of eepromHeader and controlReg
+};
+
+// Pipeline settings for compensating raw frames the way the sensor did (see exportSettings(), importSettings()):
+// the subpage merge, the refresh policy, the defect statistics, the post-hoc calibration and the temporal filter.
+#define SETTINGS_MAGIC 0x5350                // "PS"
+#define SETTINGS_VERSION 1
+struct MLX90641_PipelineSettings {
+	uint16_t magic;                      // SETTINGS_MAGIC
+	uint16_t version;                    // SETTINGS_VERSION
+	uint16_t size;                       // sizeof(MLX90641_PipelineSettings)
+	uint16_t subpageMode;                // SUBPAGE_* (setSubpageMode())
+	uint16_t refreshPolicy;              // REFRESH_* (setRefreshPolicy())
+	uint16_t refreshEveryN;
+	uint16_t defectWindow;               // setDefectWindow() (0: no statistics)
+	uint16_t filterMode;                 // FILTER_* of the filter set by setFilter() (FILTER_NONE: no filter)
+	uint16_t filterWindow;               // FILTER_MEDIAN window
+	uint16_t reserved;
+	float refreshDriftTa;                // REFRESH_ON_DRIFT thresholds
+	float refreshDriftVdd;
+	float refreshDriftKgain;
+	float defectOutlier;                 // outlier threshold (°C)
+	float calSlope;                      // post-hoc calibration
+	float calIntercept;
+	float filterAlpha;                   // FILTER_IIR weight
+	float filterQ;                       // FILTER_KALMAN parameters
+	float filterR;
+	float filterGate;
+	uint16_t crc;                        // CRC-16 of everything above
+	uint16_t reserved2;
+};
+
+// One raw frame: the RAM snapshot exactly as read from the sensor, before any compensation (see readRaw(), compensateRaw()).
+// A recorded session is one MLX90641_CalibrationExport and one MLX90641_PipelineSettings followed by
+// MLX90641_RawFrame records, back to back.
+struct MLX90641_RawFrame {
+	uint32_t seq;                        // counts up from 1 for each raw frame read
+	uint32_t timestamp;                  // millis() when the frame was read
+	uint16_t status;                     // status register 0x8000 (bit 0: subpage)
+	uint16_t words[FRAME_WORDS];         // RAM 0x0400..0x05BF: pixels, VBE, CP, gain, PTAT, Vdd
+};
+
+#ifdef FIXED_POINT_MATH
+// Scaled-integer copies of the calibration constants, used by the FIXED_POINT_MATH kernel (Qn = value * 2^n)
+struct MLX90641_FixedCal {
+	int16_t offset[2][NUM_PIXELS];       // offset reference per subpage (pix_OS_ref_SP0, pix_OS_ref_SP1)
+	int32_t Kta[NUM_PIXELS];             // Kta[i,j], Q20
+	int32_t Kv[NUM_PIXELS];              // Kv[i,j], Q16
+	int32_t invAlpha[NUM_PIXELS];        // 1 / (alpha - TGC * alpha_CP), at most 1e9
+	int32_t Kgain;                       // per frame: Kgain, Q20
+	int32_t dTa;                         // per frame: Ta - 25, Q8
+	int32_t dVdd;                        // per frame: Vdd - 3.3, Q14
+	int64_t V_CP;                        // per frame: TGC * compensated CP offset, Q20
+	int32_t invEm;                       // per frame: 1 / Emissivity, Q16
+	int32_t invAlpha_Ta;                 // per frame: 1 / (1 + KsTa * (Ta - 25)), Q20
+	int64_t Ta_r;                        // per frame: T_a-r in units of 2^12 K^4
+	int32_t CT[8];                       // corner temperatures, Q8
+	int32_t KsTo[8];                     // KsTo coefficients, Q24
+	int32_t Alpha_cr[8];                 // Alpha correction coefficients, Q20
+};
+#endif
+
+#ifdef PROFILE_PIPELINE
+// Stages of a frame timed by the profiler (see MLX90641_Profiler)
+enum MLX90641_Stage : uint8_t {
+	MLX90641_STAGE_BUS,                  // frame RAM burst reads (readFrame(), READ_FRAME steps)
+	MLX90641_STAGE_PREPARE,              // clearing the new data bit, Kgain/Vdd/Ta/CP refresh (prepareFrame())
+	MLX90641_STAGE_COMPENSATE,           // per-pixel compensation and To math (compensatePixels())
+	MLX90641_STAGE_FIX_PIXELS,           // bad pixel fill-in (fixBadPixels())
+	MLX90641_STAGE_FILTER,               // temporal filter (setFilter())
+	MLX90641_STAGE_PUBLISH,              // frame hand-over (publishFrame())
+	MLX90641_STAGE_FRAME,                // sum of the stages above, per frame
+	MLX90641_STAGE_REGISTER,             // single-word register reads (readAddr_*), already counted in the stage that issues them
+	MLX90641_STAGES
+};
+
+// Per-stage timing statistics over the last PROFILE_SAMPLES frames.
+// Ticks are CPU cycles on the ESP32, nanoseconds (steady_clock) on the host build and micros() elsewhere.
+class MLX90641_Profiler {
+	public:
+	MLX90641_Profiler();
+	uint32_t frames;                     // frames recorded since reset()
+	void reset(); // Forget all samples
+	void beginFrame(); // Start the per-frame sums
+	void accumulate(uint8_t stage, uint32_t ticks); // Add time to a stage of the current frame
+	void endFrame(); // Record the per-frame sums as one sample per stage
+	uint32_t count(uint8_t stage); // Samples kept for a stage (at most PROFILE_SAMPLES)
+	float minUs(uint8_t stage); // Shortest sample (microseconds)
+	float meanUs(uint8_t stage); // Mean of the kept samples (microseconds)
+	float p99Us(uint8_t stage); // 99th percentile of the kept samples (microseconds)
+	float maxUs(uint8_t stage); // Longest sample (microseconds)
+	void printReport(Print &out); // One JSON object with min/mean/p99/max per stage
+	static uint32_t ticks(); // Current tick count
+	static float ticksPerUs(); // Ticks per microsecond
+	static const char *stageName(uint8_t stage); // Short name of a stage (for reports)
+
+	private:
+	uint32_t frameTicks[MLX90641_STAGES];  // sums for the frame in progress
+	uint32_t samples[MLX90641_STAGES][PROFILE_SAMPLES];  // ring of per-frame sums
+	uint16_t next;                       // ring position of the next sample
+};
+#endif
+
+// Per-pixel temporal filter for T_o[] (see MLX90641::setFilter()). All state is preallocated: one object per
+// sensor, about 3.8 KB. Runs after the bad pixel fill-in, so it never sees NaN.
+class MLX90641_Filter {
+	public:
+	MLX90641_Filter(uint8_t mode = FILTER_IIR);
+	bool setIIR(float alpha = FILTER_ALPHA); // Switch to the exponential moving average: out += alpha * (in - out)
+	bool setMedian(uint8_t window = 3); // Switch to the running median of the last window frames (3 or 5)
+	bool setKalman(float q = FILTER_Q, float r = FILTER_R, float gate = FILTER_GATE); // Switch to the 1-D Kalman filter
+	void reset(); // Forget the history: the next frame passes through unchanged
+	void apply(float *T); // Filter one frame (NUM_PIXELS values) in place
+	uint8_t mode(); // FILTER_NONE, FILTER_IIR, FILTER_MEDIAN or FILTER_KALMAN
+	float alpha(); // FILTER_IIR: weight of the new frame
+	uint8_t window(); // FILTER_MEDIAN: frames in the running median
+	float q(); // FILTER_KALMAN: process noise, °C^2 per frame
+	float r(); // FILTER_KALMAN: measurement noise, °C^2
+	float gate(); // FILTER_KALMAN: jump gate in standard deviations (0: never)
+
+	private:
+	uint8_t filterMode;                  // FILTER_NONE, FILTER_IIR, FILTER_MEDIAN or FILTER_KALMAN (set only through the constructor and set*(), which reset the state)
+	float iirAlpha;                      // FILTER_IIR: weight of the new frame (0 < alpha <= 1)
+	uint8_t medianWindow;                // FILTER_MEDIAN: frames in the running median (3 or 5)
+	float kalmanQ;                       // FILTER_KALMAN: process noise, °C^2 per frame
+	float kalmanR;                       // FILTER_KALMAN: measurement noise, °C^2
+	float kalmanGate;                    // FILTER_KALMAN: a pixel further than gate standard deviations from its estimate restarts there (0: never)
+	float state[FILTER_MEDIAN_MAX][NUM_PIXELS];  // IIR: [0] output; median: ring of the last frames; Kalman: [0] estimate, [1] variance
+	uint8_t pos;                         // FILTER_MEDIAN: ring slot of the next frame
+	bool primed;                         // state holds at least one frame
+};
+
+// One frame of an event, stored compactly: temperatures in 1/EVENT_SCALE °C (NaN: -32768, clamped to ±655.34 °C)
+struct MLX90641_EventFrame {
+	uint32_t seq;                        // sequence number of the published frame
+	uint32_t timestamp;                  // millis() of the published frame
+	int16_t Ta;                          // ambient temperature (1/EVENT_SCALE °C)
+	int16_t T[NUM_PIXELS];               // pixel temperatures (1/EVENT_SCALE °C)
+};
+
+// Pre-trigger ring buffer (see MLX90641::setRecorder()). Keeps the last frames in a ring of EVENT_FRAMES slots.
+// When a trigger fires, it keeps preFrames frames before the trigger frame, records postFrames more, then
+// freezes until rearm(). All memory is preallocated (about 25 KB with EVENT_FRAMES 64). add() costs the same
+// on every frame: one pass over the pixels to convert them, plus a few comparisons for the triggers.
+class MLX90641_EventRecorder {
+	public:
+	MLX90641_EventRecorder();
+	uint16_t preFrames;                  // frames kept before the trigger frame (setWindow())
+	uint16_t postFrames;                 // frames recorded after the trigger frame (setWindow())
+	uint8_t triggers;                    // armed TRIGGER_* causes
+	uint8_t cause;                       // TRIGGER_* causes that fired (0 while armed)
+	bool setWindow(uint16_t pre, uint16_t post); // Frames to keep around the trigger frame (pre + 1 + post <= EVENT_FRAMES), rearms
+	void triggerOnMax(float threshold, uint8_t roi = EVENT_WHOLE_FRAME); // Fire when the hottest pixel of a region (or of the frame) exceeds threshold (°C)
+	void triggerOnRise(float degPerSecond, uint8_t roi = EVENT_WHOLE_FRAME); // Fire when the hottest pixel of a region rises faster than degPerSecond between two frames
+	bool triggerOnCount(float threshold, uint16_t pixels); // Fire when at least pixels pixels exceed threshold (°C). Returns false for a threshold outside ±655.34 °C
+	void trigger(); // Fire now (e.g. from an external alarm); the current frame becomes the trigger frame at the next add()
+	void add(const MLX90641_Frame *frame); // Record one published frame and check the triggers (ignored once frozen)
+	uint8_t state(); // EVENT_ARMED, EVENT_TRIGGERED or EVENT_FROZEN
+	uint16_t eventFrames(); // Frames of the event (0 until frozen)
+	uint16_t triggerIndex(); // Index of the trigger frame among them (the number of pre-trigger frames kept)
+	const MLX90641_EventFrame *eventFrame(uint16_t k); // Frame k of the event, oldest first (NULL if k is out of range)
+	void rearm(); // Forget the event and the ring, watch the triggers again
+
+	private:
+	MLX90641_EventFrame ring[EVENT_FRAMES];
+	uint16_t head;                       // slot of the next frame
+	uint16_t count;                      // frames in the ring since the last rearm() (at most EVENT_FRAMES)
+	uint16_t triggerSlot;                // slot of the trigger frame
+	uint16_t preKept;                    // pre-trigger frames available when the trigger fired
+	uint16_t postSeen;                   // post-trigger frames recorded so far
+	uint8_t status;                      // EVENT_* state
+	bool manual;                         // trigger() called, fires at the next add()
+	float maxThreshold;                  // TRIGGER_MAX
+	uint8_t maxRoi;
+	float riseThreshold;                 // TRIGGER_RISE (°C per second)
+	uint8_t riseRoi;
+	float riseLast;                      // hottest pixel of the previous frame (NaN: none yet)
+	uint32_t riseTime;                   // timestamp of the previous frame
+	int16_t countThreshold;              // TRIGGER_COUNT threshold (1/EVENT_SCALE °C)
+	uint16_t countPixels;
+};
+
+// One connected group of pixels above the threshold (see MLX90641_BlobDetector)
+struct MLX90641_Blob {
+	uint16_t area;                       // pixels
+	float x;                             // centroid: mean column of the pixels (0..15)
+	float y;                             // centroid: mean row of the pixels (0..11)
+	uint8_t left, top, right, bottom;    // bounding box: first and last column and row, inclusive
+	float peak;                          // hottest pixel (°C)
+	uint8_t peakPixel;                   // index of the hottest pixel (row = index / 16, column = index % 16)
+};
+
+// Hot spot detection. Thresholds a frame and labels the connected groups of pixels in one pass: union-find over
+// provisional labels, with each label's area, sums, bounding box and peak merged into the root as labels are
+// joined. Only the previous row of labels is kept. Fixed buffers (about 1.6 KB), no allocation; the cost is one
+// pass over the 192 pixels plus one over the labels, whatever the scene.
+class MLX90641_BlobDetector {
+	public:
+	MLX90641_BlobDetector();
+	uint8_t mode;                        // BLOB_ABSOLUTE, BLOB_ABOVE_MEAN or BLOB_ABOVE_TA (setThreshold())
+	float threshold;                     // °C (BLOB_ABSOLUTE), or margin in °C above the frame mean or Ta
+	uint16_t minArea;                    // smaller blobs are ignored (pixels, default 1)
+	bool diagonal;                       // pixels touching at a corner are connected (8-connectivity, default true)
+	MLX90641_Blob blobs[MAX_BLOBS];      // blobs of the last frame, largest first (the hotter one first on equal areas)
+	uint8_t count;                       // blobs in blobs[]
+	uint8_t found;                       // blobs of at least minArea pixels in the last frame (those beyond MAX_BLOBS are dropped)
+	void setThreshold(float threshold, uint8_t mode = BLOB_ABSOLUTE); // Pixels above threshold °C, or more than threshold °C above the frame mean or Ta
+	uint8_t detect(const MLX90641_Frame *frame); // Find the blobs of a frame (e.g. latestFrame(), using its mean), returns count
+	uint8_t detect(const float *T, float Ta); // Same for any 192 temperatures (an extra pass for the mean with BLOB_ABOVE_MEAN)
+
+	private:
+	struct Label {
+		uint16_t area;
+		uint16_t sumX, sumY;                 // sums of the columns and rows of the pixels
+		uint8_t left, top, right, bottom;
+		uint8_t peakPixel;
+		float peak;
+	};
+	uint8_t label(const float *T, float level); // Label the pixels above level, fill blobs[]
+	uint8_t join(uint8_t a, uint8_t b); // Union of the sets of labels a and b (roots), returns the root kept
+	uint8_t parent[BLOB_LABELS + 1];     // union-find forest over labels 1..BLOB_LABELS (0: background)
+	Label labels[BLOB_LABELS + 1];       // statistics, valid at the roots
+};
+
+class MLX90641;
+typedef void (*MLX90641_FrameCallback)(MLX90641 *sensor);  // called by poll() when a new frame is ready
+
+// States of the non-blocking acquisition engine (start() / poll())
+enum MLX90641_State : uint8_t {
+	MLX90641_IDLE,                       // stopped
+	MLX90641_WAIT_DATA,                  // checking the status register for a new frame
+	MLX90641_READ_FRAME,                 // burst-reading the frame RAM, one chunk per poll()
+	MLX90641_CLEAR_BIT,                  // clearing the new data bit
+	MLX90641_COMPENSATE,                 // compensating COMPENSATE_STEP pixels per poll()
+	MLX90641_FIX_PIXELS                  // bad pixel fill-in, then the onFrame callback
+};
 
 class MLX90641 {
 	public:
-	MLX90641();
+	MLX90641(TwoWire &wire = Wire, uint8_t addr = MLX90641_ADDR);  // bus and I2C address of this sensor
 	// Non-Static Variables: (not common across all sensors)
-	uint16_t eeData[EEPROM_WORDS];              // to hold the EEPROM contents
+	TwoWire *bus;                               // I2C bus of this sensor (set by the constructor)
+	uint8_t i2cAddr;                            // I2C address of this sensor (set by the constructor)
+	uint16_t eeData[EEPROM_HEADER_WORDS];       // EEPROM header (0x2400..0x243F); the per-pixel words are parsed into pixCal by calibrate()
+	uint16_t deviceID[3];                // device ID (EEPROM 0x2407..0x2409), set by calibrate() or deserializeCalibration()
+	uint16_t eepromCRC;                  // CRC-16 of the EEPROM dump, set by calibrate() (kept in the stored calibration)
 	float Vdd;                                  // to hold calculated Vdd (measured sensor operating voltage)
 	int16_t Vdd_25;                      // to store Vdd at 25°C
 	int16_t K_Vdd;                       // to store K_Vdd
 	float Ta;                            // calculated Ta (ambient temperature)
 	float Kgain;                         // Kgain coefficient
-	int16_t pix_OS_ref_SP0[NUM_PIXELS];  // pixel offset reference sp0
-	int16_t pix_OS_ref_SP1[NUM_PIXELS];  // pixel offset reference sp1
-	float pix_OS_SP0[NUM_PIXELS];        // pixel offset sp0
-	float pix_OS_SP1[NUM_PIXELS];        // pixel offset sp1
-	float alpha_pixel[NUM_PIXELS];       // pixel sensitivity
-	float Kta[NUM_PIXELS];               // Kta[i,j] coefficients
-	float Kv[NUM_PIXELS];                // Kv[i,j] coefficients
 	float KsTa;                          // KsTa coefficient
-	int16_t CT1;                         // Corner temperatures
-	int16_t CT2;                         // Corner temperatures
-	int16_t CT3;                         // Corner temperatures
-	int16_t CT4;                         // Corner temperatures
-	int16_t CT5;                         // Corner temperatures
-	int16_t CT6;                         // Corner temperatures
-	int16_t CT7;                         // Corner temperatures
-	int16_t CT8;                         // Corner temperatures
-	float KsTo1;                         // KsTo coefficients
-	float KsTo2;                         // KsTo coefficients
-	float KsTo3;                         // KsTo coefficients
-	float KsTo4;                         // KsTo coefficients
-	float KsTo5;                         // KsTo coefficients
-	float KsTo6;                         // KsTo coefficients
-	float KsTo7;                         // KsTo coefficients
-	float KsTo8;                         // KsTo coefficients
-	float Alpha_cr1;                     // Alpha correction coefficients for each range
-	float Alpha_cr2;                     // Alpha correction coefficients for each range
-	float Alpha_cr3;                     // Alpha correction coefficients for each range
-	float Alpha_cr4;                     // Alpha correction coefficients for each range
-	float Alpha_cr5;                     // Alpha correction coefficients for each range
-	float Alpha_cr6;                     // Alpha correction coefficients for each range
-	float Alpha_cr7;                     // Alpha correction coefficients for each range
-	float Alpha_cr8;                     // Alpha correction coefficients for each range
+	int16_t CT[8];                       // Corner temperatures CT1..CT8 of the 8 temperature ranges
+	float KsTo[8];                       // KsTo coefficients KsTo1..KsTo8, one per temperature range
+	float Alpha_cr[8];                   // Alpha correction coefficients Alpha_cr1..Alpha_cr8, one per temperature range
 	float alpha_reference_row1;          // Alpha references for sensitivity adjustment
 	float alpha_reference_row2;          // Alpha references for sensitivity adjustment
 	float alpha_reference_row3;          // Alpha references for sensitivity adjustment
@@ -72,6 +499,8 @@ class MLX90641 {
 	float alpha_reference_row5;          // Alpha references for sensitivity adjustment
 	float alpha_reference_row6;          // Alpha references for sensitivity adjustment
 	float Emissivity;                    // Emissivity coefficient (default: 1)
+	float calSlope;                      // post-hoc calibration slope, T_o = T * calSlope + calIntercept + OFFSET (default CAL_SLOPE)
+	float calIntercept;                  // post-hoc calibration intercept (default CAL_INT)
 	float alpha_CP;                      // Sensitivity alpha_CP coefficient
 	int16_t pix_OS_ref_CP;               // Offset CP (known in datasheet as Off_CP or pix_OS_ref_CP)
 	float Kv_CP;                         // Kv CP coefficient, because there should be one of those for sure.
@@ -79,23 +508,49 @@ class MLX90641 {
 	float TGC;                           // TGC Coefficient
 	float V_IR_compensated[NUM_PIXELS];  // V_IR_compensated values
 	float T_o[NUM_PIXELS];               // Matrix to hold final T_o[i] values
-	bool badPixels[NUM_PIXELS];          // Matrix to hold bad pixels
+	uint8_t badPixels[NUM_PIXELS];       // defect map: DEFECT_* cause bits per pixel (0: good). badPixels[i] = true flags a pixel by hand
+	uint16_t defectWindow;               // frames per defect statistics window (setDefectWindow())
+	float defectOutlier;                 // outlier threshold (°C, setDefectWindow())
+	MLX90641_PixelCal pixCal;            // per-pixel calibration table used by readTempC(), filled by the read*() parsers
+	bool pixCalValid;                    // true once pixCal has been built
+	uint16_t frameData[FRAME_WORDS] __attribute__((aligned(16)));  // raw RAM snapshot of the last frame (0x0400..0x05BF)
+	bool frameValid;                     // true once frameData[] holds a complete snapshot
+	uint8_t subpage;                     // subpage of the last frame (status register bit 0)
+	float Ta_r;                          // reflected temperature term T_a-r of the last frame (11.2.2.9)
+	uint8_t refreshPolicy;               // when prepareFrame() recomputes Kgain, Vdd and Ta (REFRESH_EVERY_FRAME, REFRESH_EVERY_N, REFRESH_ON_DRIFT)
+	uint32_t refreshCount;               // frames on which Kgain, Vdd, Ta and the factors derived from them were recomputed
+	MLX90641_State state;                // state of the non-blocking acquisition engine
+	uint32_t frameCount;                 // frames completed by poll()
+	uint32_t frameErrors;                // frames abandoned by poll() because of a bus error
+	uint8_t subpageMode;                 // how the two subpages are combined into T_o[] (SUBPAGE_LATEST..SUBPAGE_AVERAGE)
+	float T_o_SP[2][NUM_PIXELS] __attribute__((aligned(16)));  // last compensated result of each subpage
+	unsigned long frameReadTime;         // time spent on the I2C bus reading the last frame (microseconds)
+	unsigned long eepromReadTime;        // time taken by the last readEEPROMBlock() (microseconds)
+	uint16_t eepromRetries;              // number of blocks re-read during the last readEEPROMBlock()
+	unsigned long streamEncodeTime;      // time the last streamFrame() spent encoding, before the write (microseconds)
+#ifdef PROFILE_PIPELINE
+	MLX90641_Profiler profile;           // per-stage frame timing (readTempC() and poll())
+#endif
 	
 	// Functions:
-	bool readEEPROMBlock(uint16_t startAddr, uint16_t numWords, uint16_t *dest); // Read the device EEPROM
+	bool readEEPROMBlock(uint16_t startAddr, uint16_t numWords, uint16_t *dest); // Read the device EEPROM in blocks of BLOCK_SIZE words
 	bool isNewDataAvailable(); // Check if new data is available
 	bool clearNewDataBit(); // Clear the new data available bit (must be done after each read)
 	uint16_t readAddr_unsigned(const uint16_t readByte); // Read a 16-bit unsigned integer from RAM or EEPROM at the address readByte
 	int16_t readAddr_signed(const uint16_t readByte); // Read a 16-bit signed integer from RAM or EEPROM at the address readByte
-	uint16_t readEEPROM_unsigned(uint16_t addr); // Read a 16-bit unsigned integer from eeData at the address addr
-	int16_t readEEPROM_signed(uint16_t addr); // Read a 16-bit signed integer from eeData at the address addr
+	uint16_t readEEPROM_unsigned(uint16_t addr); // Read a 16-bit unsigned integer from the EEPROM dump at the address addr (header only outside calibrate())
+	int16_t readEEPROM_signed(uint16_t addr); // Read a 16-bit signed integer from the EEPROM dump at the address addr
+	bool readWords(uint16_t startAddr, uint16_t numWords, uint16_t *dest); // Read sequential words in bursts sized to the Wire buffer
+	bool readFrame(); // Burst-read the frame RAM (0x0400..0x05BF) into frameData[]
+	uint16_t readFrame_unsigned(uint16_t addr); // Read a 16-bit unsigned integer from frameData at the address addr
+	int16_t readFrame_signed(uint16_t addr); // Read a 16-bit signed integer from frameData at the address addr
 	float readVdd(); // read Vdd (From 11.1.1, worked example in 11.2.2.2) 
 	float readTa(); // Read ambient temperature, datasheet, 11.1.2
 	float readKgain(); // calculate the Kgain coefficient, datasheet 11.1.7. This needs to be calculated once per frame, because it might change in RAM.
-	void readPixelOffset(); // this function fills up the pixel offset variables: pix_OS_ref_SP0 and pix_OS_ref_SP1. datasheet 11.1.3
-	void readAlpha(); // this function restores the sensitivity from EEPROM data (11.1.4), and fills alpha_pixel[].
-	void readKta(); // To restore the Kta coefficients, 11.1.5 (fills Kta[]). In EEPROM, Kta values range from 0x25C0 to 0x267F.
-	void readKv(); // To restore the Kv coefficients, 11.1.6 (fills Kv[]). In EEPROM, Kv values range from 0x25C0 to 0x267F.
+	void readPixelOffset(); // this function fills up the pixel offset references pix_OS_ref_SP0 and pix_OS_ref_SP1 (pixCal.offset[]). datasheet 11.1.3
+	void readAlpha(); // this function restores the sensitivity from EEPROM data (11.1.4), and fills pixCal.alpha[].
+	void readKta(); // To restore the Kta coefficients, 11.1.5 (fills pixCal.Kta[]). In EEPROM, Kta values range from 0x25C0 to 0x267F.
+	void readKv(); // To restore the Kv coefficients, 11.1.6 (fills pixCal.Kv[]). In EEPROM, Kv values range from 0x25C0 to 0x267F.
 	float readKsTa(); // To restore the KsTa coefficient, 11.1.8
 	void readCT(); // To restore the corner temperatures (CT1..CT8), 11.1.9
 	void readKsTo(); // To restore the KsTo coefficients, 11.1.10
@@ -106,17 +561,149 @@ class MLX90641 {
 	float readKv_CP(); // To restore Kv_CP coefficient, 11.1.15, example 11.2.2.6.2
 	float readKTa_CP(); // To restore KTa_CP coefficient, 11.1.16, example 11.2.2.6.2
 	float readTGC(); // To restore TGC coefficient, 11.1.17, example 11.2.2.7
-	void readTempC(); // After importing and calculating all constants, we are ready to take a temperature reading.
+	void readPixelDefects(); // Flag the pixels the EEPROM marks as defective (DEFECT_EEPROM)
+	void calcPixelTable(); // Finish the per-pixel calibration table (pixCal) once, after the read*() EEPROM parsers
+	bool calibrate(); // Read the whole EEPROM (on the stack) and run every parser above, then calcPixelTable() (cold boot)
+	void serializeCalibration(MLX90641_Calibration *cal); // Pack the parsed calibration (store the sizeof(MLX90641_Calibration) bytes anywhere: NVS, flash, SD)
+	bool deserializeCalibration(const MLX90641_Calibration *cal); // Restore a packed calibration. Reads only the EEPROM header, and returns false if the blob is damaged or belongs to another sensor
+#if defined(ARDUINO_ARCH_ESP32)
+	bool saveCalibration(const char *ns = CALIBRATION_NAMESPACE); // Store the parsed calibration in NVS (one entry per I2C address)
+	bool loadCalibration(const char *ns = CALIBRATION_NAMESPACE); // Restore it from NVS: false if there is none or the key does not match (then call calibrate())
+#endif
+	bool exportCalibration(MLX90641_CalibrationExport *exp); // Pack everything compensateRaw() needs, for use without the sensor (e.g. on a PC)
+	bool importCalibration(const MLX90641_CalibrationExport *exp); // Restore an exported calibration without touching the bus. Returns false if the blob is damaged
+	void exportSettings(MLX90641_PipelineSettings *settings); // Pack the pipeline settings (the sensor state is not touched)
+	void beginRecording(); // Restart the state carried from frame to frame: call it just before recording the first raw frame
+	bool importSettings(const MLX90641_PipelineSettings *settings, MLX90641_Filter *filter = NULL); // Apply recorded settings and restart the same state. Returns false if the blob is damaged, or if it needs a filter and filter is NULL
+	bool readRaw(MLX90641_RawFrame *raw); // Read the frame RAM and the status register without compensating anything
+	void compensateRaw(const MLX90641_RawFrame *raw, float *scratch = NULL); // Run the readTempC() math on a raw frame: T_o[], the defect map, the filter and the frame store are updated as usual
+	void setRawMode(MLX90641_RawFrame *raw); // poll() stops after the frame read and fills *raw instead of T_o[] (the onFrame callback still runs). NULL: compensate as usual
+	void readTempC(float *scratch = NULL); // After importing and calculating all constants, we are ready to take a temperature reading (no per-pixel arrays on the stack: 264 bytes worst case on the host, Wire and libm calls excluded).
+	void prepareFrame(); // Calculate the per-frame constants (Kgain, Vdd, Ta, CP, Ta_r) from the frameData[] snapshot
+	void compensatePixels(uint16_t first, uint16_t count, float *scratch = NULL); // Compensate pixels first..first+count-1 from raw word to T_o
+	void compensateSoA_scalar(uint16_t first, uint16_t count, const int16_t *raw, float *T); // Branch-free SoA kernel, reference version: count raw words of pixels first.. (one row) to T (°C, before post-hoc calibration)
+	void compensateSoA_vector(uint16_t first, uint16_t count, const int16_t *raw, float *T); // Same as compensateSoA_scalar(), 4 pixels at a time with SSE2 or NEON (scalar elsewhere)
+	bool setSubpageMode(uint8_t mode); // Choose how the two subpages are combined into T_o[] (SUBPAGE_LATEST, SUBPAGE_CHESS, SUBPAGE_INTERLEAVED, SUBPAGE_AVERAGE)
+	void fixBadPixels(); // Update the defect statistics, then replace flagged pixels with the average of their good neighbours (one branch-free pass)
+	bool setDefectWindow(uint16_t frames, float outlier = DEFECT_OUTLIER_C); // Frames per statistics window for dead/stuck/outlier detection (0: off), and the outlier threshold in °C
+	uint16_t countDefects(uint8_t causes = DEFECT_ANY); // Number of pixels flagged for any of the given DEFECT_* causes
+	void clearDefects(uint8_t causes = DEFECT_ANY); // Clear the given DEFECT_* causes from every pixel (and restart the statistics window)
+	void start(); // Start the non-blocking acquisition engine (drive it with poll())
+	void stop(); // Stop the non-blocking acquisition engine
+	bool poll(); // Advance the acquisition engine by one short step. Returns true when a new frame is in T_o[]
+	void onFrame(MLX90641_FrameCallback callback); // Set the function poll() calls when a new frame is ready
+	void setFilter(MLX90641_Filter *filter); // Run a temporal filter on T_o[] after the bad pixel fill-in (NULL: none)
+	void setRecorder(MLX90641_EventRecorder *recorder); // Add every published frame to a pre-trigger event recorder (NULL: none). Needs a frame store
+	void setFrameStore(MLX90641_FrameStore *store); // Publish every frame to this triple buffer, for latestFrame() (NULL: none)
+	void publishFrame(); // Copy T_o[] into the frame store, with its statistics, and hand it to the consumer (lock-free)
+	void computeStats(const float *T, MLX90641_Stats *stats, float *copy = NULL); // Statistics of 192 temperatures in one pass (and copy them to copy[] on the way, if not NULL)
+	bool setHistogram(float lo, float hi); // Range of the frame histogram in °C (STATS_BINS bins from lo to hi)
+	bool setRoi(uint8_t n, uint8_t col, uint8_t row, uint8_t width, uint8_t height); // Set region of interest n (0..MAX_ROIS-1) to a rectangle of pixels
+	bool setRoiMask(uint8_t n, const uint8_t *mask); // Set region of interest n to the pixels i with mask[i] != 0 (192 bytes)
+	void clearRoi(uint8_t n); // Stop aggregating region of interest n
+	bool newFrameAvailable(); // True if a frame has been published since the last latestFrame() call
+	const MLX90641_Frame *latestFrame(); // Newest published frame. It stays unchanged until the next latestFrame() call (NULL without a frame store)
 	String float2exp(float num, byte sigDigits); // To print a number to the Serial Monitor in exponential format (for debugging)
 	float two_to_the(uint32_t n); // safer way to 2^ (won't overflow for big numbers)
 	float fourth_root(float n); // fourth root done with two square roots
 	uint16_t pix_addr_S0(uint16_t pxl); // to retrieve pixel address, subpage 0
 	uint16_t pix_addr_S1(uint16_t pxl); // to retrieve pixel address, subpage 1
 	bool setRefreshRate(uint8_t rate); // To set the refresh rate - 10.4, 12.2.1, and Figure 11
+	bool setRefreshPolicy(uint8_t policy, uint16_t everyN = REFRESH_N, float driftTa = REFRESH_DRIFT_TA, float driftVdd = REFRESH_DRIFT_VDD, float driftKgain = REFRESH_DRIFT_KGAIN); // Choose when prepareFrame() recomputes Kgain, Vdd and Ta
     void printFrame(float *Tdat); // To print temperature pixel frame to serial monitor
+	size_t streamFrame(const MLX90641_Frame *frame, MLX90641_StreamEncoder &encoder, Print &out = Serial, uint8_t encoding = STREAM_DELTA); // Write a frame in the binary stream format (MLX90641_Stream.h), returns the bytes written
+
+	private:
+    static char frameBuffer[FRAME_BUFFER_SIZE] __attribute__((aligned(16)));  // shared by all sensors, used by printFrame(), streamFrame() and the NVS calibration functions
+	float dTa;                           // Ta - 25, for the current frame
+	float dVdd;                          // Vdd - 3.3, for the current frame
+	float alpha_Ta;                      // 1 + KsTa * (Ta - 25), for the current frame
+	float V_CP;                          // TGC * compensated CP offset, for the current frame
+	float KsTo_abs;                      // 1 - KsTo3 * 273.15, for the current frame
+	float CT_f[8];                       // corner temperatures as floats, for the range lookup
+	float invEm;                         // 1 / Emissivity, for the current frame
+	float CP_OS_ref;                     // pix_OS_ref_CP * (1 + KTa_CP * (Ta - 25)) * (1 + Kv_CP * (Vdd - 3.3)), at the last refresh
+	bool refreshDue;                     // recompute Kgain, Vdd and Ta on the next frame whatever the policy
+	uint16_t refreshEveryN;              // REFRESH_EVERY_N: frames between refreshes
+	uint16_t framesSinceRefresh;         // frames prepared since the last refresh
+	float refreshDriftTa;                // REFRESH_ON_DRIFT thresholds
+	float refreshDriftVdd;
+	float refreshDriftKgain;
+	const uint16_t *eeImage;             // full EEPROM dump while calibrate() runs the parsers (NULL otherwise)
+	float alphaShift;                    // TGC * alpha_CP already taken off pixCal.alpha[] by calcPixelTable()
+	// EEPROM-derived constants of readVdd(), readTa() and readKgain() (11.1.1, 11.1.2, 11.1.7), cached by calcFrameConstants()
+	bool frameConstValid;                // false after an EEPROM read or a control register change
+	uint16_t controlReg;                 // copy of the control register 0x800D (read once, kept up to date by setRefreshRate())
+	bool controlRegValid;                // controlReg has been read
+	uint8_t Resolution_EE;               // calibration ADC resolution (EEPROM 0x2433 bits 10:9)
+	uint8_t Resolution_REG;              // current ADC resolution (0x800D bits 11:10)
+	float Resolution_corr;               // 2^Resolution_EE / 2^Resolution_REG
+	float Kv_PTAT_f;                     // Kv_PTAT / 2^12
+	float Kt_PTAT_f;                     // Kt_PTAT / 2^3
+	float V_PTAT25_f;                    // V_PTAT25
+	float Alpha_PTAT;                    // Alpha_PTAT / 2^7
+	float GAIN_f;                        // GAIN
+	void calcFrameConstants();           // parse the constants above from eeData (and 0x800D, once)
+#ifdef FIXED_POINT_MATH
+	MLX90641_FixedCal fx;                // scaled-integer constants for the FIXED_POINT_MATH kernel
+	void prepareFixed();                 // fill the per-frame part of fx
+	float pixelTo_fixed(uint16_t i, int16_t raw);  // scaled-integer kernel for one pixel
+#endif
+	float pixelTo_float(uint16_t i, int16_t raw, float *scratch);  // float kernel for one pixel
+	static uint8_t neighbours[NUM_PIXELS][4];  // up, left, right, down neighbour of each pixel (the pixel itself at the edges), shared by all sensors
+	static void buildNeighbours();       // fill neighbours[] once
+	void updateDefectMap();              // add the current frame to the defect statistics, re-flag at the end of a window
+	uint32_t goodMask[NUM_PIXELS / 32];  // fixBadPixels(): bit i set if pixel i is good in this frame
+	int16_t defectRaw[2][NUM_PIXELS];    // last raw word of each pixel, per subpage (stuck detection)
+	uint8_t defectDead[NUM_PIXELS];      // frames of the window with no valid output
+	uint8_t defectStill[NUM_PIXELS];     // frames of the window with the raw word unchanged
+	uint8_t defectFar[NUM_PIXELS];       // frames of the window far from the neighbours
+	uint16_t defectFrames;               // frames in the current window
+	uint16_t defectCompared;             // frames of the window with a previous raw word to compare with
+	uint8_t defectRawValid;              // bit n set once defectRaw[n] holds a frame
+	void resetDefectWindow();            // start a new statistics window
+	void restartFrameState();            // forget everything carried from frame to frame (beginRecording(), importSettings())
+	void finishFrame(float *scratch);    // frameData[] snapshot to published frame: prepareFrame() to publishFrame()
+	void copyRaw(MLX90641_RawFrame *raw, uint16_t status);  // frameData[] snapshot to a raw frame
+	bool writeStatus(uint16_t status);   // write the status register (one transaction)
+	void applyCalibration(const MLX90641_Calibration &c);  // unpack a checked calibration blob
+	MLX90641_RawFrame *rawFrame;         // set by setRawMode()
+	uint16_t statusWord;                 // status register of the frame poll() is reading
+	uint32_t rawSeq;                     // sequence number of the last raw frame
+	MLX90641_FrameCallback frameCallback; // set by onFrame()
+	MLX90641_Filter *filter;             // set by setFilter()
+	MLX90641_EventRecorder *recorder;    // set by setRecorder()
+	unsigned long lastPoll;              // millis() of the last status check
+	unsigned long busTime;               // bus time accumulated while reading the current frame (us)
+	uint16_t stepPos;                    // next word (READ_FRAME) or pixel (COMPENSATE) to process
+	uint8_t subpagesSeen;                // bit n set once subpage n has been compensated
+	uint32_t publishSeq;                 // sequence number of the last published frame
+	MLX90641_FrameStore *frameStore;     // set by setFrameStore()
+	uint8_t backSlot;                    // frameStore->slot[] owned by the producer
+	uint8_t frontSlot;                   // frameStore->slot[] owned by the consumer
+	uint8_t sharedSlot;                  // slot being handed over (bits 0-1) + FRESH bit, swapped atomically
+	float histMin;                       // histogram range (setHistogram())
+	float histMax;
+	float histScale;                     // STATS_BINS / (histMax - histMin)
+	uint32_t roiMask[MAX_ROIS][NUM_PIXELS / 32];  // bit i set if pixel i belongs to the region (setRoi(), setRoiMask())
+};
+
+// Drives several sensors on one or more I2C buses from a single loop (see MLX90641_Scheduler::poll())
+class MLX90641_Scheduler {
+	public:
+	MLX90641_Scheduler();
+	MLX90641 *sensors[MAX_SENSORS];      // sensors added with add()
+	uint8_t numSensors;                  // number of sensors added
+	bool add(MLX90641 *sensor); // Add a sensor (returns false if MAX_SENSORS are already scheduled)
+	void start(); // Start the acquisition engine of every sensor
+	void stop(); // Stop the acquisition engine of every sensor
+	uint8_t poll(); // One scheduling round: at most one burst read per bus, plus the math steps. Returns the number of frames completed
 
 	private:
-    char frameBuffer[FRAME_BUFFER_SIZE];  // member variable
+	TwoWire *buses[MAX_SENSORS];         // distinct buses of the sensors
+	uint8_t numBuses;                    // number of distinct buses
+	int8_t reading[MAX_SENSORS];         // per bus: sensor whose frame read is in progress (-1 = none)
+	uint8_t nextCheck[MAX_SENSORS];      // per bus: sensor the round-robin status check starts from
 };
 
 #endif
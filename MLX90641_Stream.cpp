@@ -0,0 +1,378 @@
+// MLX90641_Stream.cpp file for the MLX90641.h library, version 1.0.6
+// Binary frame stream: encoder (sensor side) and decoder (host side). See MLX90641_Stream.h for the layout.
+
+#include <string.h>
+#include <math.h>
+#include "MLX90641_Stream.h"
+
+static void put16(uint8_t *p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+  put16(p, v & 0xFFFF);
+  put16(p + 2, v >> 16);
+}
+
+static uint16_t get16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+// CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, no reflection (check value for "123456789": 0x29B1)
+uint16_t MLX90641_crc16(const uint8_t *data, size_t n, uint16_t crc) {
+  while (n--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (int k = 0; k < 8; k++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+// Prediction of d[i] (difference to the reference frame) from the pixels before it. STREAM_PREDICT_MED is the
+// median edge detector of LOCO-I, STREAM_PREDICT_AVERAGE the mean of the left and upper neighbours (better on
+// noisy frames), STREAM_PREDICT_NONE uses the reference pixel alone. Left neighbour on the first row, upper
+// neighbour in the first column.
+static int32_t ricePredict(const int32_t *d, int i, uint8_t mode) {
+  int x = i % STREAM_WIDTH;
+  if (mode == STREAM_PREDICT_NONE) return 0;
+  if (i < STREAM_WIDTH) return x ? d[i - 1] : 0;
+  if (x == 0) return d[i - STREAM_WIDTH];
+  int32_t a = d[i - 1], b = d[i - STREAM_WIDTH], c = d[i - STREAM_WIDTH - 1];
+  if (mode == STREAM_PREDICT_AVERAGE) return (a + b) / 2;
+  int32_t hi = (a > b) ? a : b, lo = (a > b) ? b : a;
+  if (c >= hi) return lo;
+  if (c <= lo) return hi;
+  return a + b - c;
+}
+
+// Adaptive Rice parameter: the smallest k with n * 2^k >= the sum of the last (about 32) mapped residuals
+struct RiceState {
+  uint32_t sum, n;
+  RiceState() : sum(4), n(1) {}
+  uint8_t k() const {
+    uint8_t k = 0;
+    while ((n << k) < sum && k < 17) k++;
+    return k;
+  }
+  void update(uint32_t u) {
+    sum += u;
+    if (++n == 32) {
+      sum >>= 1;
+      n >>= 1;
+    }
+  }
+};
+
+// MSB-first bit packing into out[0..capacity); full is set when the bits do not fit
+struct BitWriter {
+  uint8_t *p, *end;
+  uint32_t acc;
+  uint8_t bits;
+  bool full;
+  BitWriter(uint8_t *out, size_t capacity) : p(out), end(out + capacity), acc(0), bits(0), full(false) {}
+  void put(uint32_t v, uint8_t n) {  // n <= 24
+    acc = (acc << n) | v;
+    bits += n;
+    while (bits >= 8) {
+      bits -= 8;
+      if (p == end) full = true;
+      else *p++ = (uint8_t)(acc >> bits);
+    }
+  }
+};
+
+struct BitReader {
+  const uint8_t *p, *end;
+  uint32_t acc;
+  uint8_t bits;
+  bool error;
+  BitReader(const uint8_t *in, const uint8_t *end) : p(in), end(end), acc(0), bits(0), error(false) {}
+  uint32_t get(uint8_t n) {  // n <= 24
+    while (bits < n) {
+      if (p == end) {
+        error = true;
+        return 0;
+      }
+      acc = (acc << 8) | *p++;
+      bits += 8;
+    }
+    bits -= n;
+    return (acc >> bits) & ((1UL << n) - 1);
+  }
+};
+
+// Rice-code a frame against ref (NULL: intra frame), with the predictor that leaves the smallest residuals.
+// Returns the payload size, or 0 if it would exceed 2 x STREAM_PIXELS bytes (the size of an absolute frame).
+static uint16_t riceEncode(const int16_t *v, const int16_t *ref, uint8_t *out) {
+  int32_t d[STREAM_PIXELS];
+  for (int i = 0; i < STREAM_PIXELS; i++) d[i] = (int32_t)v[i] - (ref ? ref[i] : 0);
+  uint8_t mode = STREAM_PREDICT_MED;
+  uint32_t best = 0xFFFFFFFF;
+  for (uint8_t m = STREAM_PREDICT_MED; m <= STREAM_PREDICT_NONE; m++) {
+    uint32_t cost = 0;
+    for (int i = 0; i < STREAM_PIXELS; i++) {
+      int32_t e = d[i] - ricePredict(d, i, m);
+      cost += (e >= 0) ? e : -e;
+    }
+    if (cost < best) {
+      best = cost;
+      mode = m;
+    }
+  }
+  RiceState state;
+  BitWriter w(out, 2 * STREAM_PIXELS);
+  w.put(mode, 2);
+  for (int i = 0; i < STREAM_PIXELS && !w.full; i++) {
+    int32_t e = d[i] - ricePredict(d, i, mode);
+    uint32_t u = (e >= 0) ? (uint32_t)e << 1 : ((uint32_t)(-e) << 1) - 1;  // zigzag: 0, -1, 1, -2, ...
+    uint8_t k = state.k();
+    uint32_t q = u >> k;
+    if (q < STREAM_RICE_LIMIT) {
+      w.put(((1UL << q) - 1) << 1, (uint8_t)(q + 1));
+      w.put(u & ((1UL << k) - 1), k);
+    } else {
+      w.put((1UL << STREAM_RICE_LIMIT) - 1, STREAM_RICE_LIMIT);
+      w.put(u, 18);
+    }
+    state.update(u);
+  }
+  if (w.bits) w.put(0, 8 - w.bits);  // pad the last byte
+  return w.full ? 0 : (uint16_t)(w.p - out);
+}
+
+// Unpack a Rice payload against ref (NULL: intra frame) into v. False if it does not hold exactly 192 pixels.
+static bool riceDecode(const uint8_t *p, const uint8_t *end, const int16_t *ref, int16_t *v) {
+  int32_t d[STREAM_PIXELS];
+  RiceState state;
+  BitReader r(p, end);
+  uint8_t mode = (uint8_t)r.get(2);
+  if (mode > STREAM_PREDICT_NONE) return false;
+  for (int i = 0; i < STREAM_PIXELS; i++) {
+    uint8_t k = state.k();
+    uint32_t q = 0;
+    while (q < STREAM_RICE_LIMIT && r.get(1)) q++;
+    uint32_t u = (q < STREAM_RICE_LIMIT) ? (q << k) | r.get(k) : r.get(18);
+    if (r.error) return false;
+    state.update(u);
+    int32_t e = (u & 1) ? -(int32_t)((u + 1) >> 1) : (int32_t)(u >> 1);
+    d[i] = e + ricePredict(d, i, mode);
+    int32_t value = d[i] + (ref ? ref[i] : 0);
+    if (value < -32768 || value > 32767) return false;
+    v[i] = (int16_t)value;
+  }
+  return r.p == end && (r.acc & ((1UL << r.bits) - 1)) == 0;  // nothing left but the zero padding
+}
+
+MLX90641_StreamEncoder::MLX90641_StreamEncoder(uint16_t scale) {
+  this->scale = scale;
+  keyframeInterval = STREAM_KEYFRAME;
+  framesEncoded = 0;
+  bytesEncoded = 0;
+  reset();
+}
+
+void MLX90641_StreamEncoder::reset() {
+  havePrev = false;
+  prevSeq = 0;
+  sinceKey = 0;
+  for (int i = 0; i < STREAM_PIXELS; i++) prev[i] = 0;
+}
+
+int16_t MLX90641_StreamEncoder::toUnits(float T) {
+  if (isnan(T)) return -32768;
+  float v = roundf(T * (float)scale);
+  if (v > 32767.0f) return 32767;
+  if (v < -32767.0f) return -32767;
+  return (int16_t)v;
+}
+
+// Pack one frame. Delta frames fall back to absolute when there is no reference yet, a keyframe is due or
+// the frame has the seq of the last one sent (sent again: its ref would be 0, the mark of a frame without one);
+// Rice frames are then coded without a reference, and fall back to absolute when they do not compress.
+size_t MLX90641_StreamEncoder::encode(const float *T, float Ta, uint32_t seq, uint32_t timestamp, uint8_t subpage, uint8_t encoding, uint8_t *out) {
+  bool reference = havePrev && seq != prevSeq && sinceKey + 1 < keyframeInterval && seq - prevSeq <= 0xFFFF;
+  if (encoding == STREAM_DELTA && !reference) encoding = STREAM_ABSOLUTE;
+  int16_t v[STREAM_PIXELS];
+  for (int i = 0; i < STREAM_PIXELS; i++) v[i] = toUnits(T[i]);
+  uint8_t *p = out + STREAM_HEADER_BYTES;
+  if (encoding == STREAM_RICE) {
+    uint16_t n = riceEncode(v, reference ? prev : NULL, p);
+    if (n == 0) encoding = STREAM_ABSOLUTE;
+    p += n;
+  }
+  for (int i = 0; i < STREAM_PIXELS; i++) {
+    if (encoding == STREAM_ABSOLUTE) {
+      put16(p, (uint16_t)v[i]);
+      p += 2;
+    } else if (encoding == STREAM_DELTA) {
+      int32_t d = (int32_t)v[i] - prev[i];
+      if (d >= -127 && d <= 127) {
+        *p++ = (uint8_t)(int8_t)d;
+      } else {
+        *p++ = STREAM_ESCAPE;  // step too large for one byte: send the value itself
+        put16(p, (uint16_t)v[i]);
+        p += 2;
+      }
+    }
+    prev[i] = v[i];
+  }
+  uint16_t length = (uint16_t)(p - out - STREAM_HEADER_BYTES);
+  uint16_t ref = (encoding == STREAM_DELTA || (encoding == STREAM_RICE && reference)) ? (uint16_t)(seq - prevSeq) : 0;
+  out[0] = STREAM_MAGIC0;
+  out[1] = STREAM_MAGIC1;
+  out[2] = (STREAM_VERSION << 4) | encoding;
+  out[3] = subpage;
+  put32(out + 4, seq);
+  put32(out + 8, timestamp);
+  put16(out + 12, (uint16_t)toUnits(Ta));
+  put16(out + 14, scale);
+  put16(out + 16, length);
+  put16(out + 18, ref);
+  uint16_t crc = MLX90641_crc16(out, 20);
+  put16(out + 20, MLX90641_crc16(out + STREAM_HEADER_BYTES, length, crc));
+  prevSeq = seq;
+  havePrev = true;
+  sinceKey = (ref == 0) ? 0 : sinceKey + 1;
+  framesEncoded++;
+  bytesEncoded += STREAM_HEADER_BYTES + length;
+  return STREAM_HEADER_BYTES + length;
+}
+
+float MLX90641_StreamEncoder::compressionRatio() const {
+  if (bytesEncoded == 0) return 0.0f;
+  return (float)framesEncoded * (STREAM_PIXELS * sizeof(float)) / (float)bytesEncoded;
+}
+
+MLX90641_StreamDecoder::MLX90641_StreamDecoder() {
+  frames = 0;
+  crcErrors = 0;
+  missingReference = 0;
+  skippedBytes = 0;
+  memset(&header, 0, sizeof(header));
+  for (int i = 0; i < STREAM_PIXELS; i++) pixels[i] = 0;
+  reset();
+}
+
+void MLX90641_StreamDecoder::reset() {
+  pos = 0;
+  need = 0;
+  havePrev = false;
+}
+
+// Add one byte. On a bad header or CRC, the bytes after the false frame start are scanned again,
+// so a corrupted length field cannot swallow the frame that follows it.
+bool MLX90641_StreamDecoder::push(uint8_t b) {
+  if (pos == 0 && b != STREAM_MAGIC0) {
+    skippedBytes++;
+    return false;
+  }
+  if (pos == 1 && b != STREAM_MAGIC1) {
+    skippedBytes++;
+    pos = 0;
+    return push(b);  // b may start the next frame
+  }
+  buf[pos++] = b;
+  bool ok = true;
+  if (pos == STREAM_HEADER_BYTES) {  // header complete: check it and size the frame
+    uint8_t encoding = buf[2] & 0x0F;
+    uint16_t length = get16(buf + 16);
+    ok = (buf[2] >> 4) == STREAM_VERSION && length <= STREAM_MAX_BYTES - STREAM_HEADER_BYTES &&
+         ((encoding == STREAM_ABSOLUTE && length == 2 * STREAM_PIXELS) || (encoding == STREAM_DELTA && length >= STREAM_PIXELS) ||
+          (encoding == STREAM_RICE && length >= STREAM_PIXELS / 8 && length <= 2 * STREAM_PIXELS));
+    need = STREAM_HEADER_BYTES + length;
+  }
+  bool decoded = false;
+  if (ok && need != 0 && pos == need) {
+    int8_t r = decode();
+    decoded = (r == 1);
+    ok = (r >= 0);
+    if (ok) {
+      pos = 0;
+      need = 0;
+    }
+  }
+  if (!ok) {  // false start: rescan the bytes after the first one
+    crcErrors++;
+    havePrev = false;
+    uint16_t n = pos;
+    pos = 0;
+    need = 0;
+    skippedBytes++;
+    for (uint16_t k = 1; k < n; k++) decoded |= push(buf[k]);  // push() writes behind the read position
+  }
+  return decoded;
+}
+
+// Check the CRC and unpack the frame in buf
+int8_t MLX90641_StreamDecoder::decode() {
+  uint16_t length = need - STREAM_HEADER_BYTES;
+  uint16_t crc = MLX90641_crc16(buf, 20);
+  if (MLX90641_crc16(buf + STREAM_HEADER_BYTES, length, crc) != get16(buf + 20)) return -1;
+  uint8_t encoding = buf[2] & 0x0F;
+  uint32_t seq = get32(buf + 4);
+  uint16_t ref = get16(buf + 18);
+  const uint8_t *p = buf + STREAM_HEADER_BYTES;
+  const uint8_t *end = p + length;
+  if (encoding == STREAM_ABSOLUTE) {
+    for (int i = 0; i < STREAM_PIXELS; i++, p += 2) pixels[i] = (int16_t)get16(p);
+  } else if (encoding == STREAM_RICE) {
+    bool inter = (ref != 0);  // a Rice frame without reference is an intra frame
+    if (inter && (!havePrev || seq - ref != header.seq)) {
+      missingReference++;
+      havePrev = false;
+      return 0;
+    }
+    int16_t v[STREAM_PIXELS];
+    if (!riceDecode(p, end, inter ? pixels : NULL, v)) {
+      havePrev = false;
+      return -1;
+    }
+    memcpy(pixels, v, sizeof(pixels));
+  } else {
+    if (!havePrev || ref == 0 || seq - ref != header.seq) {  // the reference frame was lost: wait for the next absolute frame
+      missingReference++;
+      havePrev = false;
+      return 0;  // the frame itself is intact, so do not rescan it
+    }
+    int i = 0;
+    for (; i < STREAM_PIXELS && p < end; i++) {
+      if (*p == STREAM_ESCAPE) {
+        if (end - p < 3) break;
+        pixels[i] = (int16_t)get16(p + 1);
+        p += 3;
+      } else {
+        pixels[i] = (int16_t)(pixels[i] + (int8_t)*p);
+        p++;
+      }
+    }
+    if (i != STREAM_PIXELS || p != end) {  // payload does not hold exactly 192 pixels
+      havePrev = false;
+      return -1;
+    }
+  }
+  header.encoding = encoding;
+  header.subpage = buf[3];
+  header.seq = seq;
+  header.timestamp = get32(buf + 8);
+  header.Ta = (int16_t)get16(buf + 12);
+  header.scale = get16(buf + 14);
+  header.length = length;
+  header.ref = ref;
+  havePrev = true;
+  frames++;
+  return 1;
+}
+
+float MLX90641_StreamDecoder::temperature(uint16_t i) const {
+  if (i >= STREAM_PIXELS || header.scale == 0) return NAN;
+  return (float)pixels[i] / (float)header.scale;
+}
+
+float MLX90641_StreamDecoder::ambient() const {
+  if (header.scale == 0) return NAN;
+  return (float)header.Ta / (float)header.scale;
+}
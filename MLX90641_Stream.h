@@ -0,0 +1,117 @@
+#ifndef MLX90641_Stream_h
+#define MLX90641_Stream_h
+
+// Binary frame stream for the MLX90641 (replaces the ASCII printFrame() output on fast links).
+// No Arduino dependencies, so the same encoder/decoder builds on the host (extras/host).
+//
+// Frame layout (little-endian):
+//   offset size
+//   0      2    magic 0x90 0x41
+//   2      1    version (high nibble) | encoding (low nibble): STREAM_ABSOLUTE, STREAM_DELTA or STREAM_RICE
+//   3      1    subpage
+//   4      4    sequence number
+//   8      4    timestamp (ms)
+//   12     2    Ta (int16, in 1/scale °C)
+//   14     2    scale (units per °C, 100 = centi-degrees)
+//   16     2    payload length (bytes)
+//   18     2    delta reference: seq minus the seq of the frame the deltas apply to (0 for absolute and intra frames)
+//   20     2    CRC-16/CCITT-FALSE of bytes 0..19 and the payload
+//   22     ...  payload:
+//                 STREAM_ABSOLUTE: 192 x int16 pixel values (row by row)
+//                 STREAM_DELTA:    192 x int8 difference to the previous frame; the escape byte 0x80
+//                                  is followed by the int16 absolute value (for steps beyond +/-127)
+//                 STREAM_RICE:     lossless bit stream, MSB first, zero-padded to a whole byte. Each pixel's
+//                                  difference d to the reference frame (the value itself when ref is 0) is
+//                                  predicted from the d of the pixels before it; the first 2 bits name the
+//                                  predictor (STREAM_PREDICT_MED, _AVERAGE or _NONE), the encoder picks the
+//                                  one with the smallest residuals. The residual, zigzag-mapped to u, is Rice
+//                                  coded: u >> k in unary (ones, then a zero), then the k low bits. k adapts
+//                                  per pixel to the running mean of u (reset every frame). A prefix of
+//                                  STREAM_RICE_LIMIT ones is followed by u in 18 bits instead. A frame that
+//                                  would take more than 2 x 192 bytes is sent as an absolute frame.
+// A delta frame (or a Rice frame with a reference) needs the previous frame: the encoder sends an absolute
+// (or intra Rice) frame every STREAM_KEYFRAME frames, so a decoder that starts late or loses a frame recovers
+// at the next one.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef STREAM_KEYFRAME
+#define STREAM_KEYFRAME 32                  // absolute frame at least every this many frames (delta streams)
+#endif
+#define STREAM_PIXELS 192                   // pixels per frame (16x12)
+#define STREAM_WIDTH 16                     // pixels per row
+#define STREAM_MAGIC0 0x90
+#define STREAM_MAGIC1 0x41
+#define STREAM_VERSION 1
+#define STREAM_HEADER_BYTES 22
+#define STREAM_MAX_BYTES (STREAM_HEADER_BYTES + 3 * STREAM_PIXELS)  // worst case: every delta escaped
+#define STREAM_ESCAPE 0x80                  // delta escape: an int16 absolute value follows
+#define STREAM_ABSOLUTE 0                   // encoding: int16 per pixel
+#define STREAM_DELTA 1                      // encoding: int8 difference per pixel, with escapes
+#define STREAM_RICE 2                       // encoding: Rice-coded prediction residuals (lossless)
+#define STREAM_RICE_LIMIT 24                // Rice prefix length that escapes to an 18-bit residual
+#define STREAM_PREDICT_MED 0                // Rice predictor: median of left, upper, left + upper - upper-left
+#define STREAM_PREDICT_AVERAGE 1            // Rice predictor: mean of left and upper
+#define STREAM_PREDICT_NONE 2               // Rice predictor: the reference frame alone (plain temporal difference)
+
+// Fields of a frame header
+struct MLX90641_StreamHeader {
+	uint8_t encoding;                    // STREAM_ABSOLUTE, STREAM_DELTA or STREAM_RICE
+	uint8_t subpage;                     // subpage the frame was measured on
+	uint32_t seq;                        // sequence number
+	uint32_t timestamp;                  // milliseconds
+	int16_t Ta;                          // ambient temperature, in 1/scale °C
+	uint16_t scale;                      // units per °C
+	uint16_t length;                     // payload bytes
+	uint16_t ref;                        // seq distance to the delta reference frame (0: absolute frame)
+};
+
+uint16_t MLX90641_crc16(const uint8_t *data, size_t n, uint16_t crc = 0xFFFF); // CRC-16/CCITT-FALSE (poly 0x1021), continue with a previous value
+
+// Packs frames into the binary format. Keeps the previous frame for delta and Rice encoding.
+// encode() runs in bounded time and stack: at most six passes over the frame, about 1.2 KB of stack.
+class MLX90641_StreamEncoder {
+	public:
+	MLX90641_StreamEncoder(uint16_t scale = 100);
+	uint16_t scale;                      // units per °C (100: 0.01°C resolution, range +/-327°C)
+	uint16_t keyframeInterval;           // absolute frame at least every this many frames (default STREAM_KEYFRAME)
+	uint32_t framesEncoded;              // frames packed so far
+	uint32_t bytesEncoded;               // bytes produced so far, headers included
+	void reset(); // Make the next frame an absolute one
+	size_t encode(const float *T, float Ta, uint32_t seq, uint32_t timestamp, uint8_t subpage, uint8_t encoding, uint8_t *out); // Pack one frame into out (STREAM_MAX_BYTES), returns its size
+	int16_t toUnits(float T); // °C to rounded int16 units, clamped to +/-32767 (NaN: -32768)
+	float compressionRatio() const; // 768-byte float frames per byte sent (framesEncoded x 768 / bytesEncoded), 0 before the first frame
+
+	private:
+	int16_t prev[STREAM_PIXELS];         // last frame sent, as the decoder sees it
+	uint32_t prevSeq;                    // seq of that frame
+	bool havePrev;                       // prev[] holds a frame
+	uint16_t sinceKey;                   // frames since the last absolute frame
+};
+
+// Unpacks frames from a byte stream. Feed it bytes as they arrive: it finds the magic, checks the CRC
+// and skips to the next frame on errors.
+class MLX90641_StreamDecoder {
+	public:
+	MLX90641_StreamDecoder();
+	MLX90641_StreamHeader header;        // header of the last decoded frame
+	int16_t pixels[STREAM_PIXELS];       // pixels of the last decoded frame, in 1/scale °C
+	uint32_t frames;                     // frames decoded
+	uint32_t crcErrors;                  // false frame starts (bad header, CRC or payload), each followed by a rescan
+	uint32_t missingReference;           // delta (and inter-frame Rice) frames dropped because their previous frame was not decoded
+	uint32_t skippedBytes;               // bytes skipped while looking for a frame start
+	void reset(); // Forget the partial frame and the delta reference
+	bool push(uint8_t b); // Add one byte, returns true when a frame has been decoded
+	float temperature(uint16_t i) const; // pixel i in °C
+	float ambient() const; // Ta in °C
+
+	private:
+	int8_t decode(); // Check and unpack the frame in buf: 1 decoded, 0 intact but no delta reference, -1 CRC or format error
+	uint8_t buf[STREAM_MAX_BYTES];       // frame being received
+	uint16_t pos;                        // bytes in buf
+	uint16_t need;                       // total bytes of the frame being received (0: header not complete yet)
+	bool havePrev;                       // pixels[] holds the previous frame (delta reference)
+};
+
+#endif
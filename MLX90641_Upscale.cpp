@@ -0,0 +1,91 @@
+// MLX90641_Upscale.cpp file for the MLX90641.h library, version 1.0.6
+// Frame upscaling: separable bilinear/bicubic interpolation with fixed-point weights. See MLX90641_Upscale.h.
+
+#include <math.h>
+#include "MLX90641_Upscale.h"
+
+static inline int16_t saturate16(int32_t v) {
+  return (v > 32767) ? 32767 : (v < -32768) ? -32768 : (int16_t)v;
+}
+
+MLX90641_Upscaler::MLX90641_Upscaler() {
+  width = 0;
+  height = 0;
+  kernel = UPSCALE_BILINEAR;
+  scale = 100;
+  taps = 2;
+}
+
+// Interpolation weight of a tap at distance d from the sample point
+static float kernelWeight(uint8_t kernel, float d) {
+  d = fabsf(d);
+  if (kernel == UPSCALE_BILINEAR) return (d < 1.0f) ? 1.0f - d : 0.0f;
+  if (d < 1.0f) return (1.5f * d - 2.5f) * d * d + 1.0f;         // Keys cubic, a = -0.5 (Catmull-Rom)
+  if (d < 2.0f) return ((-0.5f * d + 2.5f) * d - 4.0f) * d + 2.0f;
+  return 0.0f;
+}
+
+// Weights for n outputs from inSize inputs. The Q14 weights of each output are rounded, then the largest
+// absorbs the rounding error, so a flat frame stays exactly flat.
+void MLX90641_Upscaler::setTaps(Taps *t, uint16_t n, uint8_t inSize) {
+  for (uint16_t x = 0; x < n; x++) {
+    float src = ((float)x + 0.5f) * (float)inSize / (float)n - 0.5f;  // centre-aligned input position
+    int first = (int)floorf(src) - (taps / 2 - 1);
+    int32_t sum = 0;
+    uint8_t largest = 0;
+    for (uint8_t k = 0; k < 4; k++) {
+      int i = first + k;
+      float w = (k < taps) ? kernelWeight(kernel, src - (float)i) : 0.0f;
+      t[x].idx[k] = (uint8_t)((i < 0) ? 0 : (i >= inSize) ? inSize - 1 : i);  // repeat the edge pixels
+      t[x].w[k] = (int16_t)lroundf(w * (float)(1 << UPSCALE_WEIGHT_BITS));
+      sum += t[x].w[k];
+      if (t[x].w[k] > t[x].w[largest]) largest = k;
+    }
+    t[x].w[largest] += (int16_t)((1 << UPSCALE_WEIGHT_BITS) - sum);
+  }
+}
+
+// Compute the weights for an output size. Returns false (and keeps the previous size) if the size is out of range.
+bool MLX90641_Upscaler::begin(uint16_t width, uint16_t height, uint8_t kernel) {
+  if (width < UPSCALE_IN_WIDTH || width > UPSCALE_MAX_WIDTH || height < UPSCALE_IN_HEIGHT || height > UPSCALE_MAX_HEIGHT) return false;
+  if (kernel > UPSCALE_BICUBIC) return false;
+  this->width = width;
+  this->height = height;
+  this->kernel = kernel;
+  taps = (kernel == UPSCALE_BICUBIC) ? 4 : 2;
+  setTaps(colTaps, width, UPSCALE_IN_WIDTH);
+  setTaps(rowTaps, height, UPSCALE_IN_HEIGHT);
+  return true;
+}
+
+// Two passes: every input row is stretched to the output width, then every output column is stretched to the
+// output height. Integer multiply-adds only; the rounding bias is added before the shift.
+void MLX90641_Upscaler::upscale(const int16_t *in, int16_t *out) {
+  const int32_t half = 1 << (UPSCALE_WEIGHT_BITS - 1);
+  for (uint8_t r = 0; r < UPSCALE_IN_HEIGHT; r++) {
+    const int16_t *src = &in[r * UPSCALE_IN_WIDTH];
+    for (uint16_t x = 0; x < width; x++) {
+      const Taps &t = colTaps[x];
+      int32_t acc = half;
+      for (uint8_t k = 0; k < taps; k++) acc += (int32_t)t.w[k] * src[t.idx[k]];
+      rows[r][x] = saturate16(acc >> UPSCALE_WEIGHT_BITS);
+    }
+  }
+  for (uint16_t y = 0; y < height; y++) {
+    const Taps &t = rowTaps[y];
+    int16_t *dst = &out[y * width];
+    for (uint16_t x = 0; x < width; x++) {
+      int32_t acc = half;
+      for (uint8_t k = 0; k < taps; k++) acc += (int32_t)t.w[k] * rows[t.idx[k]][x];
+      dst[x] = saturate16(acc >> UPSCALE_WEIGHT_BITS);
+    }
+  }
+}
+
+void MLX90641_Upscaler::upscale(const float *T, int16_t *out) {
+  for (int i = 0; i < UPSCALE_IN_WIDTH * UPSCALE_IN_HEIGHT; i++) {
+    float v = isnan(T[i]) ? 0.0f : roundf(T[i] * (float)scale);
+    units[i] = saturate16((v > 32767.0f) ? 32767 : (v < -32768.0f) ? -32768 : (int32_t)v);
+  }
+  upscale(units, out);
+}
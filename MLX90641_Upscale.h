@@ -0,0 +1,53 @@
+#ifndef MLX90641_Upscale_h
+#define MLX90641_Upscale_h
+
+// Frame upscaling for the MLX90641: 16x12 pixels to a display resolution (e.g. 64x48 or 128x96).
+// Bilinear or bicubic (Catmull-Rom) interpolation in two separable passes (rows, then columns), with
+// fixed-point weights computed once per output size by begin(). Works on int16 values in 1/scale °C
+// and writes into a buffer supplied by the caller, so a frame needs no allocation and no float math.
+// No Arduino dependencies, so the same code builds on the host (extras/host).
+//
+// Pixel centres are aligned: output pixel x samples the input at (x + 0.5) * 16 / width - 0.5.
+// The edge pixels are repeated beyond the border. Bicubic output may overshoot next to sharp edges
+// (by up to about 7% of the step); values are clamped to the int16 range.
+
+#include <stdint.h>
+
+#define UPSCALE_IN_WIDTH 16                 // sensor columns
+#define UPSCALE_IN_HEIGHT 12                // sensor rows
+#ifndef UPSCALE_MAX_WIDTH
+#define UPSCALE_MAX_WIDTH 128               // widest output begin() accepts
+#endif
+#ifndef UPSCALE_MAX_HEIGHT
+#define UPSCALE_MAX_HEIGHT 96               // tallest output begin() accepts
+#endif
+#define UPSCALE_BILINEAR 0                  // kernel: 2 taps per axis
+#define UPSCALE_BICUBIC 1                   // kernel: 4 taps per axis (Catmull-Rom, a = -0.5)
+#define UPSCALE_WEIGHT_BITS 14              // weights are Q14: each set of taps sums to exactly 1 << 14
+
+// Upscales 16x12 frames to width x height. One object per output size and kernel (about 6 KB with the default maximums).
+class MLX90641_Upscaler {
+	public:
+	MLX90641_Upscaler();
+	uint16_t width;                      // output columns (0 until begin() succeeds)
+	uint16_t height;                     // output rows
+	uint8_t kernel;                      // UPSCALE_BILINEAR or UPSCALE_BICUBIC
+	uint16_t scale;                      // units per °C of the output of upscale(const float *, ...) (default 100: centi-degrees)
+	bool begin(uint16_t width, uint16_t height, uint8_t kernel = UPSCALE_BILINEAR); // Compute the weights for an output size (at least 16x12, at most UPSCALE_MAX_WIDTH x UPSCALE_MAX_HEIGHT)
+	void upscale(const int16_t *in, int16_t *out); // 192 values (row by row) to width x height values (row by row), same units
+	void upscale(const float *T, int16_t *out); // 192 temperatures (°C) to width x height values in 1/scale °C (NaN counts as 0)
+
+	private:
+	struct Taps {
+		uint8_t idx[4];                      // input column (or row) of each tap, clamped to the frame
+		int16_t w[4];                        // Q14 weight of each tap
+	};
+	Taps colTaps[UPSCALE_MAX_WIDTH];     // per output column
+	Taps rowTaps[UPSCALE_MAX_HEIGHT];    // per output row
+	uint8_t taps;                        // 2 (bilinear) or 4 (bicubic)
+	int16_t rows[UPSCALE_IN_HEIGHT][UPSCALE_MAX_WIDTH];  // first pass: each input row at the output width
+	int16_t units[UPSCALE_IN_WIDTH * UPSCALE_IN_HEIGHT];  // float input converted to units
+	void setTaps(Taps *t, uint16_t n, uint8_t inSize); // weights for n outputs from inSize inputs
+};
+
+#endif
@@ -50,8 +50,8 @@
 #define REFRESH_RATE 0x03                   // 0x00 (0.5 Hz) to 0x07 (64 Hz). Default: 0x03 (4 Hz)
 #define SAMPLE_DELAY 300                    // delay between reading samples (see refresh rate table).
 #define POR_DELAY SAMPLE_DELAY * 2.0 * 1.2  // delay required after power on reset (see refresh rate table)
-#define CAL_INT -45.4209807273067           // Intercept of T_meas vs. T_o calibration curve (post-hoc calibration). My value: -45.4209807273067
-#define CAL_SLOPE 2.64896693658985          // Slope of T_meas vs. T_o calibration curve (post-hoc calibration). My value: 2.64896693658985
+#define CAL_INT 0.0                         // Intercept of T_meas vs. T_o calibration curve (post-hoc calibration). Fit made under the old 1e-6 alpha_comp limit: -45.4209807273067
+#define CAL_SLOPE 1.0                       // Slope of T_meas vs. T_o calibration curve (post-hoc calibration). Fit made under the old 1e-6 alpha_comp limit: 2.64896693658985
 
 MLX90641 myIRcam;  // declare an instance of class MLX90641
 
@@ -108,8 +108,8 @@ void setup() {
   }
   delay(POR_DELAY);  // Power on reset delay (POR), see table above
   Serial.println("MLX90641 ESP32 Calibrated Read");
-  // Read full EEPROM (0x2400..0x272F)
-  if (!myIRcam.readEEPROMBlock(0x2400, EEPROM_WORDS, myIRcam.eeData)) {
+  // Read the full EEPROM (0x2400..0x272F) and parse the calibration constants (only needs to be done once)
+  if (!myIRcam.calibrate()) {
     Serial.println("EEPROM read failed!");
     while (1) delay(1000);
   }
@@ -122,34 +122,17 @@ void setup() {
 #ifdef DEBUG
   Serial.println("setup() First 16 words of EEPROM:");
   for (int i = 0; i < 16; i++) {
-    Serial.println("EEPROM value at address: 0x" + String(0x2400 + i, HEX) + ", value: 0x" + String(eeData[i], HEX));
+    Serial.println("EEPROM value at address: 0x" + String(0x2400 + i, HEX) + ", value: 0x" + String(myIRcam.eeData[i], HEX));
   }
-  Serial.println("setup() Suspicious EEPROM value check:");
-  for (int i = 0; i < EEPROM_WORDS; i++) {
+  Serial.println("setup() Suspicious EEPROM header value check:");
+  for (int i = 0; i < EEPROM_HEADER_WORDS; i++) {  // only the header is kept after calibrate()
     if (myIRcam.eeData[i] == 0x0000 || myIRcam.eeData[i] == 0xFFFF) {
-      Serial.println("EEPROM value suspicious at address: 0x" + String(0x2400 + i, HEX) + ", value: 0x" + String(eeData[i], HEX));
+      Serial.println("EEPROM value suspicious at address: 0x" + String(0x2400 + i, HEX) + ", value: 0x" + String(myIRcam.eeData[i], HEX));
     }
   }
 #endif
-  myIRcam.Vdd = myIRcam.readVdd();  // This should be close to 3.3V. Can read once in setup.
-  myIRcam.Ta = myIRcam.readTa();    // should happen inside the loop
   Serial.print("Ambient temperature on start: ");
-  Serial.println(myIRcam.Ta, 1);      // This should be close to ambient temperature (21°C?)
-  myIRcam.readPixelOffset();          // only needs to be read once
-  myIRcam.readAlpha();                // read sensitivities (fills alpha_pixel[])
-  myIRcam.readKta();                  // read Kta coefficients (fills Kta[])
-  myIRcam.readKv();                   // read Kv coefficients (fills Kv[])
-  myIRcam.KsTa = myIRcam.readKsTa();  // read KsTa coefficient
-  Serial.println("Finished: read KsTA.");
-  myIRcam.readCT();                               // read 8 corner temperatures
-  myIRcam.readKsTo();                             // read 8 KsTo coefficients
-  myIRcam.readAlphaCorrRange();                   // read sensitivity correction coefficients
-  myIRcam.Emissivity = myIRcam.readEmissivity();  // read Emissivity coefficient
-  myIRcam.alpha_CP = myIRcam.readAlpha_CP();      // read Sensitivity alpha_CP coefficient
-  myIRcam.pix_OS_ref_CP = myIRcam.readOff_CP();   // read offset CP (also called pix_OS_ref_CP)
-  myIRcam.Kv_CP = myIRcam.readKv_CP();            // read Kv CP
-  myIRcam.KTa_CP = myIRcam.readKTa_CP();          // read KTa_CP
-  myIRcam.TGC = myIRcam.readTGC();                // read TGC - do this last (leaves setup function for some odd reason)
+  Serial.println(myIRcam.Ta, 1);  // This should be close to ambient temperature (21°C?)
   /*#ifdef DEBUG                  // uncomment this if you need a pixel map (or consult the datasheet)
   Serial.println("Printing pixel address memory map: ");
   for (int i = 0; i < 192; i++) {
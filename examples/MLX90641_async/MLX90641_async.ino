@@ -0,0 +1,120 @@
+// MLX90641_async.ino file for the MLX90641.h library, version 1.0.6
+// Description: Non-blocking frame acquisition with start(), poll() and an onFrame() callback.
+// loop() stays free for other work: each poll() call does one short step of the frame.
+// Author: D. Dubins
+// Lots of help from: ChatGPT 3.0, Perplexity.AI
+// Date: 17-Dec-25
+// Notes: the MLX90641 operating voltage is 3-3.6V (typical: 3.3V).
+// Use a logic shifter, or connect to an MCU that operates at 3.3V (e.g. NodeMCU).
+// After the device powers up and sends data, a thermal stabilization time is required
+// before the device can reach the specified accuracy (up to 3 min) - 12.2.2
+// Wiring: ("/\" is notch in device case, pins facing you)
+//
+//       _____/\______
+//     /              \
+//    /  4:SCL  1:SDA  \
+//   |                  |
+//   |                  |
+//    \  3:GND  2:3.3V /
+//     \______________/
+//
+// ESP32 - MLX90641:
+// --------------------------------------
+// SDA - D21 (GPIO21) - SDA
+// SCL - D22 (GPIO22) - SCL
+// GND -  GND
+// 3.3V - VDD
+//
+// MLX90641 refresh rates (Control register 0x800D bits 10:7):
+// -----------------------------------------------------------
+// Bit    Freq      Sec/frame          POR Delay (ms)  Sample Every (ms)
+// 0x00 = 0.5 Hz    2 sec              4080 ms         2400 ms
+// 0x01 = 1 Hz      1 sec/frame        2080 ms         1200 ms
+// 0x02 = 2 Hz      0.5 sec/frame      1080 ms         600 ms (default)
+// 0x03 = 4 Hz      0.25 sec/frame     580 ms          300 ms
+// 0x04 = 8 Hz      0.125 sec/frame    330 ms          150 ms
+// 0x05 = 16 Hz     0.0625 sec/frame   205 ms           75 ms
+// 0x06 = 32 Hz     0.03125 sec/frame  143 ms           38 ms
+// 0x07 = 64 Hz     0.015625 sec/frame 112 ms           19 ms
+
+#include <Wire.h>
+#include "MLX90641.h"
+
+//#define DEBUG                             // Show calculated and example values for calibration constants
+#define OFFSET 0.0                          // Post-hoc cheap temperature adjustment (shift)
+#define I2C_SPEED 100000                    // Set I2C clock speed (safe speed is 100 kHz, up to 400 kHz possible)
+#define REFRESH_RATE 0x03                   // 0x00 (0.5 Hz) to 0x07 (64 Hz). Default: 0x03 (4 Hz)
+#define SAMPLE_DELAY 300                    // delay between reading samples (see refresh rate table)
+#define POR_DELAY SAMPLE_DELAY * 2.0 * 1.2  // delay required after power on reset (see refresh rate table)
+#define CAL_INT 0.0                         // Intercept of T_meas vs. T_o calibration curve (post-hoc calibration). Fit made under the old 1e-6 alpha_comp limit: -45.4209807273067
+#define CAL_SLOPE 1.0                       // Slope of T_meas vs. T_o calibration curve (post-hoc calibration). Fit made under the old 1e-6 alpha_comp limit: 2.64896693658985
+
+MLX90641 myIRcam;            // declare an instance of class MLX90641
+MLX90641_FrameStore frames;  // published frames, for latestFrame()
+
+// Called by poll() each time a complete frame is in T_o[]
+void frameReady(MLX90641 *cam) {
+  const MLX90641_Stats &stats = cam->latestFrame()->stats;  // gathered while the frame was published, no rescan needed
+  Serial.print("Frame ");
+  Serial.print(cam->frameCount);
+  Serial.print(" Ta: ");
+  Serial.print(cam->Ta, 1);
+  Serial.print(" Average: ");
+  Serial.print(stats.mean, 1);
+  Serial.print(" Max: ");
+  Serial.print(stats.max, 1);
+  Serial.print(" at ");
+  Serial.print(stats.maxPixel % 16);
+  Serial.print(",");
+  Serial.print(stats.maxPixel / 16);
+  Serial.print(" Bus time (us): ");
+  Serial.println(cam->frameReadTime);
+}
+
+void setup() {
+  Serial.begin(115200);                        // Start the Serial Monitor at 115200 bps
+  Wire.begin(21, 22);                          // SDA, SCL for the ESP32 (SDA: GPIO 21, SDL: GPIO22). Change these to your I2C pins if using a different bus.
+  Wire.setClock(I2C_SPEED);                    // set I2C clock speed (slower=more stable)
+  if (myIRcam.setRefreshRate(REFRESH_RATE)) {  // set the page refresh rate (sampling frequency)
+    Serial.println("Refresh rate adjusted.");
+  } else {
+    Serial.println("Error on adjusting refresh rate.");
+  }
+  delay(POR_DELAY);  // Power on reset delay (POR), see table above
+  Serial.println("MLX90641 ESP32 Calibrated Read");
+  // Warm boot (e.g. after a watchdog reset): restore the parsed calibration from NVS in a few ms.
+  // First boot, or another sensor on this address: read the full EEPROM (0x2400..0x272F), parse it, and store the result.
+  if (myIRcam.loadCalibration()) {
+    Serial.println("Calibration restored from NVS.");
+  } else {
+    if (!myIRcam.calibrate()) {
+      Serial.println("EEPROM read failed!");
+      while (1) delay(1000);
+    }
+    Serial.print("EEPROM read in (us): ");
+    Serial.println(myIRcam.eepromReadTime);  // time taken by the block-mode EEPROM dump
+    if (!myIRcam.saveCalibration()) Serial.println("Could not store the calibration in NVS.");
+  }
+  //myIRcam.Emissivity = 0.95;  // un-comment to over-write Emissivity with hard-coded value here (e.g. 0.95)
+
+  // Mark bad pixels separately here (row indexes 0...11, col indexes 0..15)
+  //myIRcam.badPixels[pixelAddr(9,14)]=true;    // mark pixel bad at row 9, column 14
+  //myIRcam.badPixels[pixelAddr(11,0)]=true;    // mark pixel bad at row 11, column 0
+
+  myIRcam.setFrameStore(&frames);  // publish every frame with its statistics
+  myIRcam.onFrame(frameReady);     // function to call when a new frame is ready
+  myIRcam.start();                 // start the non-blocking acquisition engine
+}
+
+void loop() {
+  myIRcam.poll();  // one short step of the frame (status check, one burst read, or a slice of the math)
+  // ... other work goes here, no delay() needed ...
+}
+
+// To run the camera in its own FreeRTOS task instead (ESP32), call poll() from the task:
+// void cameraTask(void *arg) {
+//   for (;;) {
+//     myIRcam.poll();
+//     vTaskDelay(1);
+//   }
+// }
@@ -0,0 +1,107 @@
+// MLX90641_benchmark.ino file for the MLX90641.h library, version 1.0.6
+// Description: Times each stage of the frame pipeline (bus reads, frame constants, compensation, bad pixels,
+// publishing) for every refresh rate and I2C clock, and prints one JSON line per run to the Serial Monitor.
+// Uncomment #define PROFILE_PIPELINE in MLX90641.h first (the library must be built with it).
+// Author: D. Dubins
+// Lots of help from: ChatGPT 3.0, Perplexity.AI
+// Date: 17-Dec-25
+// Notes: the MLX90641 operating voltage is 3-3.6V (typical: 3.3V).
+// Use a logic shifter, or connect to an MCU that operates at 3.3V (e.g. NodeMCU).
+// After the device powers up and sends data, a thermal stabilization time is required
+// before the device can reach the specified accuracy (up to 3 min) - 12.2.2
+//
+//       _____/\______
+//     /              \
+//    /  4:SCL  1:SDA  \
+//   |                  |
+//   |                  |
+//    \  3:GND  2:3.3V /
+//     \______________/
+//
+// ESP32 - MLX90641:
+// --------------------------------------
+// SDA - D21 (GPIO21) - SDA
+// SCL - D22 (GPIO22) - SCL
+// GND -  GND
+// 3.3V - VDD
+//
+// MLX90641 refresh rates (Control register 0x800D bits 10:7):
+// -----------------------------------------------------------
+// Bit    Freq      Sec/frame          POR Delay (ms)  Sample Every (ms)
+// 0x00 = 0.5 Hz    2 sec              4080 ms         2400 ms
+// 0x01 = 1 Hz      1 sec/frame        2080 ms         1200 ms
+// 0x02 = 2 Hz      0.5 sec/frame      1080 ms         600 ms (default)
+// 0x03 = 4 Hz      0.25 sec/frame     580 ms          300 ms
+// 0x04 = 8 Hz      0.125 sec/frame    330 ms          150 ms
+// 0x05 = 16 Hz     0.0625 sec/frame   205 ms           75 ms
+// 0x06 = 32 Hz     0.03125 sec/frame  143 ms           38 ms
+// 0x07 = 64 Hz     0.015625 sec/frame 112 ms           19 ms
+
+#include <Wire.h>
+#include "MLX90641.h"
+
+#ifndef PROFILE_PIPELINE
+#error "Uncomment #define PROFILE_PIPELINE in MLX90641.h to build this sketch"
+#endif
+
+#define FRAMES 32  // frames timed per run
+
+const float rateHz[8] = { 0.5, 1.0, 2.0, 4.0, 8.0, 16.0, 32.0, 64.0 };
+const uint32_t clocks[3] = { 100000, 400000, 1000000 };  // 1 MHz needs short wires and strong pull-ups
+
+MLX90641 myIRcam;  // declare an instance of class MLX90641
+
+// One run: FRAMES frames through poll() at the given refresh rate and I2C clock
+void run(uint8_t rate, uint32_t clock) {
+  Wire.setClock(clock);
+  bool ok = myIRcam.setRefreshRate(rate);
+  delay((unsigned long)(2400.0 / rateHz[rate]));  // let the new rate settle (two subpages)
+  unsigned long errors0 = myIRcam.frameErrors;
+  uint32_t count0 = myIRcam.frameCount;
+  unsigned long limit = (unsigned long)(FRAMES * (3000.0 / rateHz[rate] + 200.0)) + 1000;  // ms (slow clocks drop frames)
+  unsigned long t0 = millis();
+  myIRcam.profile.reset();
+  myIRcam.start();
+  while (ok && myIRcam.frameCount - count0 < FRAMES && millis() - t0 < limit) {
+    myIRcam.poll();
+  }
+  myIRcam.stop();
+  unsigned long elapsed = millis() - t0;
+  Serial.print("{\"rate\":");
+  Serial.print(rate);
+  Serial.print(",\"rate_hz\":");
+  Serial.print(rateHz[rate], 1);
+  Serial.print(",\"i2c_hz\":");
+  Serial.print(clock);
+  Serial.print(",\"ok\":");
+  Serial.print(ok ? "true" : "false");
+  Serial.print(",\"frames\":");
+  Serial.print(myIRcam.frameCount - count0);
+  Serial.print(",\"elapsed_ms\":");
+  Serial.print(elapsed);
+  Serial.print(",\"errors\":");
+  Serial.print(myIRcam.frameErrors - errors0);
+  Serial.print(",\"bus_us\":");
+  Serial.print(myIRcam.frameReadTime);
+  Serial.print(",\"profile\":");
+  myIRcam.profile.printReport(Serial);
+  Serial.println("}");
+}
+
+void setup() {
+  Serial.begin(115200);  // Start the Serial Monitor at 115200 bps
+  Wire.begin(21, 22);    // SDA, SCL for the ESP32 (SDA: GPIO 21, SDL: GPIO22). Change these to your I2C pins if using a different bus.
+  Wire.setClock(I2C_SPEED);
+  delay(POR_DELAY);  // Power on reset delay (POR), see table above
+  if (!myIRcam.calibrate()) {
+    Serial.println("EEPROM read failed!");
+    while (1) delay(1000);
+  }
+  for (uint8_t rate = 0; rate < 8; rate++) {
+    for (int c = 0; c < 3; c++) run(rate, clocks[c]);
+  }
+  Serial.println("Benchmark done.");
+}
+
+void loop() {
+}
@@ -0,0 +1,115 @@
+// MLX90641_multi.ino file for the MLX90641.h library, version 1.0.6
+// Description: Four sensors on two I2C buses, driven by one MLX90641_Scheduler.
+// Each sensor has its own bus, I2C address, refresh rate and calibration.
+// Give each sensor on a bus its own address first (EEPROM word 0x240F, see the datasheet).
+// Author: D. Dubins
+// Lots of help from: ChatGPT 3.0, Perplexity.AI
+// Date: 17-Dec-25
+// Notes: the MLX90641 operating voltage is 3-3.6V (typical: 3.3V).
+// Use a logic shifter, or connect to an MCU that operates at 3.3V (e.g. NodeMCU).
+// After the device powers up and sends data, a thermal stabilization time is required
+// before the device can reach the specified accuracy (up to 3 min) - 12.2.2
+// Wiring: ("/\" is notch in device case, pins facing you)
+//
+//       _____/\______
+//     /              \
+//    /  4:SCL  1:SDA  \
+//   |                  |
+//   |                  |
+//    \  3:GND  2:3.3V /
+//     \______________/
+//
+// ESP32 - MLX90641 (bus 0: Wire, sensors at 0x33 and 0x34; bus 1: Wire1, sensors at 0x33 and 0x34):
+// --------------------------------------
+// SDA - D21 (GPIO21) - SDA (bus 0)
+// SCL - D22 (GPIO22) - SCL (bus 0)
+// SDA - D25 (GPIO25) - SDA (bus 1)
+// SCL - D26 (GPIO26) - SCL (bus 1)
+// GND -  GND
+// 3.3V - VDD
+//
+// MLX90641 refresh rates (Control register 0x800D bits 10:7):
+// -----------------------------------------------------------
+// Bit    Freq      Sec/frame          POR Delay (ms)  Sample Every (ms)
+// 0x00 = 0.5 Hz    2 sec              4080 ms         2400 ms
+// 0x01 = 1 Hz      1 sec/frame        2080 ms         1200 ms
+// 0x02 = 2 Hz      0.5 sec/frame      1080 ms         600 ms (default)
+// 0x03 = 4 Hz      0.25 sec/frame     580 ms          300 ms
+// 0x04 = 8 Hz      0.125 sec/frame    330 ms          150 ms
+// 0x05 = 16 Hz     0.0625 sec/frame   205 ms           75 ms
+// 0x06 = 32 Hz     0.03125 sec/frame  143 ms           38 ms
+// 0x07 = 64 Hz     0.015625 sec/frame 112 ms           19 ms
+
+#include <Wire.h>
+#include "MLX90641.h"
+
+//#define DEBUG                             // Show calculated and example values for calibration constants
+#define OFFSET 0.0                          // Post-hoc cheap temperature adjustment (shift)
+#define I2C_SPEED 400000                    // Set I2C clock speed (two sensors per bus need the faster clock at higher refresh rates)
+#define REFRESH_RATE 0x03                   // 0x00 (0.5 Hz) to 0x07 (64 Hz). Default: 0x03 (4 Hz)
+#define SAMPLE_DELAY 300                    // delay between reading samples (see refresh rate table)
+#define POR_DELAY SAMPLE_DELAY * 2.0 * 1.2  // delay required after power on reset (see refresh rate table)
+#define CAL_INT 0.0                         // Intercept of T_meas vs. T_o calibration curve (post-hoc calibration). Fit made under the old 1e-6 alpha_comp limit: -45.4209807273067
+#define CAL_SLOPE 1.0                       // Slope of T_meas vs. T_o calibration curve (post-hoc calibration). Fit made under the old 1e-6 alpha_comp limit: 2.64896693658985
+#define NUM_CAMS 4                          // number of sensors
+
+MLX90641 cam0(Wire, 0x33);   // bus 0
+MLX90641 cam1(Wire, 0x34);   // bus 0
+MLX90641 cam2(Wire1, 0x33);  // bus 1
+MLX90641 cam3(Wire1, 0x34);  // bus 1
+MLX90641 *cams[NUM_CAMS] = { &cam0, &cam1, &cam2, &cam3 };
+MLX90641_Scheduler scheduler;  // interleaves the frame reads of all sensors
+
+// Called by the scheduler each time a sensor has a complete frame in T_o[]
+void frameReady(MLX90641 *cam) {
+  float avg = 0.0;
+  for (int i = 0; i < NUM_PIXELS; i++) {
+    avg += cam->T_o[i];
+  }
+  avg /= (float)NUM_PIXELS;
+  Serial.print("Sensor 0x");
+  Serial.print(cam->i2cAddr, HEX);
+  Serial.print(cam->bus == &Wire ? " (bus 0)" : " (bus 1)");
+  Serial.print(" frame ");
+  Serial.print(cam->frameCount);
+  Serial.print(" Ta: ");
+  Serial.print(cam->Ta, 1);
+  Serial.print(" Average: ");
+  Serial.print(avg, 1);
+  Serial.print(" Errors: ");
+  Serial.println(cam->frameErrors);
+}
+
+// Read the EEPROM of one sensor and calculate its calibration constants
+bool setupCam(MLX90641 &cam) {
+  if (!cam.setRefreshRate(REFRESH_RATE)) return false;  // set the page refresh rate (sampling frequency)
+  if (!cam.calibrate()) return false;  // read the full EEPROM (0x2400..0x272F) and parse the calibration constants
+  cam.onFrame(frameReady);
+  return true;
+}
+
+void setup() {
+  Serial.begin(115200);      // Start the Serial Monitor at 115200 bps
+  Wire.begin(21, 22);        // bus 0: SDA, SCL
+  Wire.setClock(I2C_SPEED);
+  Wire1.begin(25, 26);       // bus 1: SDA, SCL. Change these to your I2C pins.
+  Wire1.setClock(I2C_SPEED);
+  delay(POR_DELAY);          // Power on reset delay (POR), see table above
+  Serial.println("MLX90641 ESP32 Multi-sensor Read");
+  for (int i = 0; i < NUM_CAMS; i++) {
+    if (setupCam(*cams[i])) {
+      scheduler.add(cams[i]);
+      Serial.print("Sensor ready at 0x");
+      Serial.println(cams[i]->i2cAddr, HEX);
+    } else {
+      Serial.print("Sensor not found at 0x");
+      Serial.println(cams[i]->i2cAddr, HEX);
+    }
+  }
+  scheduler.start();  // start the acquisition engine of every sensor
+}
+
+void loop() {
+  scheduler.poll();  // one round: at most one burst read per bus, plus a slice of the math for each sensor
+  // ... other work goes here, no delay() needed ...
+}
@@ -4,7 +4,8 @@
 // Date: 25-Feb-26
 // Last Updated: 18-Mar-26
 // Simple 16x12 heat map for MLX90641 serial output
-// Expects lines: Tamb, p0, p1, ... p191 (comma-separated)
+// Expects lines: Tamb, p0, p1, ... p191 (comma-separated), or binary frames from streamFrame()
+// (see MLX90641_Stream.h in the library). Both are detected automatically.
 // Match port + baud (115200) to your serial port settings
 // Libraries: ControlP5 v 2.2.6, by Andreas Schlegal
 // (tutorial here: https://www.kasperkamperman.com/blog/processing-code/controlp5-library-example1/)
@@ -28,6 +29,8 @@ ControlP5 cp5; // controlP5 object called cp5
 
 float[] pixels = new float[PIXELS];
 boolean haveFrame = false;
+StreamDecoder decoder = new StreamDecoder();  // binary frames
+StringBuilder lineBuf = new StringBuilder();  // text lines
 
 // grid / window settings
 int COLS = 16;
@@ -80,9 +83,6 @@ void setup() {
   String portName = Serial.list()[portNum];   // change to correct index of COM port as needed
   myPort = new Serial(this, portName, portSpeed);
 
-  // Read one line at a time
-  myPort.bufferUntil('\n');
-
   textAlign(CENTER, CENTER);
   textSize(14);
   win = new SecondWindow();
@@ -185,10 +185,31 @@ void draw() {
   Tmin=Tlocmin; // calculate Tmin
 }
 
-// Called automatically when a '\n' is received
+// Called automatically when bytes are received
 void serialEvent(Serial s) {
-  String line = trim(s.readStringUntil('\n'));
-  if (line == null || line.length() == 0) {
+  while (s.available() > 0) {
+    int b = s.read();
+    if (decoder.push(b)) {  // binary frame complete
+      if (!pause) {
+        Tamb = decoder.Ta / (float)decoder.scale + offsetval;
+        for (int i = 0; i < PIXELS; i++) {
+          pixels[i] = decoder.values[i] / (float)decoder.scale + offsetval;
+        }
+      }
+      haveFrame = true;
+    }
+    if (b == '\n') {  // text line complete
+      readLine(trim(lineBuf.toString()));
+      lineBuf.setLength(0);
+    } else if (lineBuf.length() < 4000) {
+      lineBuf.append((char)b);
+    }
+  }
+}
+
+// One text line: Tamb, p0, p1, ... p191
+void readLine(String line) {
+  if (line.length() == 0) {
     return;
   }
 
@@ -198,7 +219,7 @@ void serialEvent(Serial s) {
   // Expect 1 + 192 = 193 values (thermistor + 192 pixels)
   if (parts.length < PIXELS+1) {
     // Not a full frame; ignore
-    println("Short line, len = " + parts.length + ": " + line);
+    if (decoder.frames == 0) println("Short line, len = " + parts.length + ": " + line);  // binary frames also contain line breaks
     return;
   }
 
@@ -212,6 +233,115 @@ void serialEvent(Serial s) {
   haveFrame = true;
 }
 
+// Decoder for the binary frames written by streamFrame() (layout in MLX90641_Stream.h):
+// 22-byte header (magic 0x90 0x41, encoding, subpage, seq, timestamp, Ta, scale, length, ref, CRC-16),
+// then 192 int16 values, or 192 int8 deltas against the previous frame (0x80 + int16 for large steps).
+class StreamDecoder {
+  final int HEADER = 22;
+  int[] buf = new int[HEADER + 3 * PIXELS];
+  int pos = 0;       // bytes in buf
+  int need = 0;      // total bytes of the frame being received (0: header not complete yet)
+  boolean havePrev = false;  // values[] holds the previous frame (delta reference)
+  int[] values = new int[PIXELS];  // pixels of the last frame, in 1/scale °C
+  long seq = 0;      // sequence number of the last frame
+  int Ta = 0;        // ambient temperature, in 1/scale °C
+  int scale = 100;   // units per °C
+  int frames = 0;    // frames decoded
+  int errors = 0;    // bad headers or CRCs
+
+  int get16(int i) {
+    return buf[i] | (buf[i + 1] << 8);
+  }
+
+  long get32(int i) {
+    return get16(i) | ((long)get16(i + 2) << 16);
+  }
+
+  int crc16(int from, int n, int crc) {  // CRC-16/CCITT-FALSE
+    for (int i = from; i < from + n; i++) {
+      crc ^= buf[i] << 8;
+      for (int k = 0; k < 8; k++) crc = ((crc & 0x8000) != 0) ? ((crc << 1) ^ 0x1021) & 0xFFFF : (crc << 1) & 0xFFFF;
+    }
+    return crc;
+  }
+
+  // Add one byte, returns true when a frame has been decoded
+  boolean push(int b) {
+    if (pos == 0 && b != 0x90) return false;
+    if (pos == 1 && b != 0x41) {
+      pos = 0;
+      return push(b);
+    }
+    buf[pos++] = b;
+    boolean ok = true;
+    if (pos == HEADER) {  // header complete: check it and size the frame
+      int encoding = buf[2] & 0x0F;
+      int length = get16(16);
+      ok = (buf[2] >> 4) == 1 && ((encoding == 0 && length == 2 * PIXELS) || (encoding == 1 && length >= PIXELS && length <= 3 * PIXELS));
+      need = HEADER + length;
+    }
+    boolean decoded = false;
+    if (ok && need != 0 && pos == need) {
+      int r = decode();
+      decoded = (r == 1);
+      ok = (r >= 0);
+      if (ok) {
+        pos = 0;
+        need = 0;
+      }
+    }
+    if (!ok) {  // false start: rescan the bytes after the first one
+      errors++;
+      havePrev = false;
+      int n = pos;
+      pos = 0;
+      need = 0;
+      for (int k = 1; k < n; k++) decoded |= push(buf[k]);
+    }
+    return decoded;
+  }
+
+  // 1: frame decoded, 0: delta frame without its reference (skipped), -1: CRC or format error
+  int decode() {
+    int length = need - HEADER;
+    if (crc16(HEADER, length, crc16(0, 20, 0xFFFF)) != get16(20)) return -1;
+    int encoding = buf[2] & 0x0F;
+    long newSeq = get32(4);
+    int ref = get16(18);
+    int p = HEADER;
+    if (encoding == 0) {
+      for (int i = 0; i < PIXELS; i++, p += 2) values[i] = (short)get16(p);
+    } else {
+      if (!havePrev || ref == 0 || ((newSeq - ref) & 0xFFFFFFFFL) != seq) {
+        havePrev = false;  // wait for the next absolute frame
+        return 0;
+      }
+      int end = HEADER + length;
+      int i = 0;
+      for (; i < PIXELS && p < end; i++) {
+        if (buf[p] == 0x80) {
+          if (end - p < 3) break;
+          values[i] = (short)get16(p + 1);
+          p += 3;
+        } else {
+          values[i] = (short)(values[i] + (byte)buf[p]);
+          p++;
+        }
+      }
+      if (i != PIXELS || p != end) {
+        havePrev = false;
+        return -1;
+      }
+    }
+    seq = newSeq;
+    Ta = (short)get16(12);
+    scale = max(1, get16(14));
+    havePrev = true;
+    frames++;
+    return 1;
+  }
+}
+
 public class SecondWindow extends PApplet {
 
   public SecondWindow() {
@@ -0,0 +1,35 @@
+// Arduino.cpp - host implementation of the Arduino core stand-in
+#include "Arduino.h"
+
+HostSerial Serial;
+
+static unsigned long long hostMicros = 0;  // simulated clock: only moves when delay() or the simulated bus advance it
+
+unsigned long millis() { return (unsigned long)(hostMicros / 1000ULL); }
+unsigned long micros() { return (unsigned long)hostMicros; }
+void delay(unsigned long ms) { hostMicros += 1000ULL * ms; }
+void delayMicroseconds(unsigned int us) { hostMicros += us; }
+void hostAdvanceMicros(unsigned long us) { hostMicros += us; }
+
+static std::string fmtInt(long long v, int base) {
+	char buf[40];
+	if (base == HEX) snprintf(buf, sizeof(buf), "%llx", (unsigned long long)v);
+	else snprintf(buf, sizeof(buf), "%lld", v);
+	return buf;
+}
+static std::string fmtFloat(double v, int decimals) {
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+	return buf;
+}
+
+String::String(int v, int base) : std::string(fmtInt(base == HEX ? (long long)(unsigned int)v : v, base)) {}
+String::String(unsigned int v, int base) : std::string(fmtInt(v, base)) {}
+String::String(long v, int base) : std::string(fmtInt(base == HEX ? (long long)(unsigned long)v : v, base)) {}
+String::String(unsigned long v, int base) : std::string(fmtInt((long long)v, base)) {}
+String::String(float v, int decimals) : std::string(fmtFloat(v, decimals)) {}
+String::String(double v, int decimals) : std::string(fmtFloat(v, decimals)) {}
+
+String operator+(const String &a, const String &b) { return String(std::string(a) + std::string(b)); }
+String operator+(const char *a, const String &b) { return String(std::string(a) + std::string(b)); }
+String operator+(const String &a, const char *b) { return String(std::string(a) + std::string(b)); }
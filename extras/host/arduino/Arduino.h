@@ -0,0 +1,77 @@
+// Arduino.h - minimal Arduino core stand-in for the host build of the MLX90641 library
+// Only what the library and its host tools use: timing, String, Print/Stream and Serial (stdout).
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+#define HEX 16
+#define DEC 10
+
+unsigned long millis();                 // simulated time, see hostAdvanceMicros()
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void hostAdvanceMicros(unsigned long us);  // advance the simulated clock (used by the simulated bus)
+
+class String : public std::string {
+	public:
+	String(const char *s = "") : std::string(s) {}
+	String(const std::string &s) : std::string(s) {}
+	String(char c) : std::string(1, c) {}
+	String(int v, int base = DEC);
+	String(unsigned int v, int base = DEC);
+	String(long v, int base = DEC);
+	String(unsigned long v, int base = DEC);
+	String(float v, int decimals = 2);
+	String(double v, int decimals = 2);
+	String &operator+=(const String &s) { append(s); return *this; }
+	String &operator+=(const char *s) { append(s); return *this; }
+};
+String operator+(const String &a, const String &b);
+String operator+(const char *a, const String &b);
+String operator+(const String &a, const char *b);
+
+class Print {
+	public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t *buf, size_t n) { size_t k = 0; while (n--) k += write(*buf++); return k; }
+	size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+	size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(int v, int base = DEC) { return print(String(v, base)); }
+	size_t print(unsigned int v, int base = DEC) { return print(String(v, base)); }
+	size_t print(long v, int base = DEC) { return print(String(v, base)); }
+	size_t print(unsigned long v, int base = DEC) { return print(String(v, base)); }
+	size_t print(double v, int decimals = 2) { return print(String(v, decimals)); }
+	template <typename T> size_t println(T v) { size_t n = print(v); return n + print("\n"); }
+	template <typename T> size_t println(T v, int f) { size_t n = print(v, f); return n + print("\n"); }
+	size_t println() { return print("\n"); }
+};
+
+class Stream : public Print {
+	public:
+	virtual int available() { return 0; }
+	virtual int read() { return -1; }
+	virtual int peek() { return -1; }
+};
+
+// Serial writes to stdout on the host
+class HostSerial : public Stream {
+	public:
+	void begin(unsigned long) {}
+	size_t write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+	size_t write(const uint8_t *buf, size_t n) { return fwrite(buf, 1, n, stdout); }
+	operator bool() { return true; }
+};
+extern HostSerial Serial;
+
+#endif
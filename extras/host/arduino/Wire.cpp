@@ -0,0 +1,91 @@
+// Wire.cpp - host implementation of the I2C stand-in
+#include "Wire.h"
+
+TwoWire Wire;
+TwoWire Wire1;
+
+TwoWire::TwoWire() {
+	for (int i = 0; i < 8; i++) devices[i] = NULL;
+	txAddr = 0;
+	txLen = 0;
+	rxLen = 0;
+	rxPos = 0;
+	clockHz = 100000;
+	transactions = 0;
+	busMicros = 0;
+}
+
+bool TwoWire::begin() { return true; }
+bool TwoWire::begin(int sda, int scl) { (void)sda; (void)scl; return true; }
+void TwoWire::setClock(uint32_t hz) { clockHz = hz; }
+
+void TwoWire::attach(HostI2CDevice *dev) {
+	for (int i = 0; i < 8; i++) {
+		if (devices[i] == NULL) {
+			devices[i] = dev;
+			return;
+		}
+	}
+}
+
+void TwoWire::detach(HostI2CDevice *dev) {
+	for (int i = 0; i < 8; i++) {
+		if (devices[i] == dev) devices[i] = NULL;
+	}
+}
+
+HostI2CDevice *TwoWire::find(uint8_t addr) {
+	for (int i = 0; i < 8; i++) {
+		if (devices[i] != NULL && devices[i]->address() == addr) return devices[i];
+	}
+	return NULL;
+}
+
+// 9 clocks per byte (8 data + ACK), plus the address byte and ~2 clocks for start/stop
+void TwoWire::busTime(size_t bytes) {
+	unsigned long long us = ((unsigned long long)(bytes + 1) * 9 + 2) * 1000000ULL / clockHz;
+	busMicros += us;
+	transactions++;
+	hostAdvanceMicros((unsigned long)us);
+}
+
+void TwoWire::beginTransmission(uint8_t addr) {
+	txAddr = addr;
+	txLen = 0;
+}
+
+size_t TwoWire::write(uint8_t c) {
+	if (txLen >= sizeof(txBuf)) return 0;
+	txBuf[txLen++] = c;
+	return 1;
+}
+
+size_t TwoWire::write(const uint8_t *buf, size_t n) {
+	size_t k = 0;
+	while (k < n && write(buf[k])) k++;
+	return k;
+}
+
+// Returns 0 on success, 2 on address NACK, 3 on data NACK (same codes as the Arduino core)
+uint8_t TwoWire::endTransmission(bool sendStop) {
+	(void)sendStop;
+	busTime(txLen);
+	HostI2CDevice *dev = find(txAddr);
+	if (dev == NULL) return 2;
+	return dev->write(txBuf, txLen) ? 0 : 3;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t quantity) {
+	rxLen = 0;
+	rxPos = 0;
+	if (quantity > sizeof(rxBuf)) quantity = sizeof(rxBuf);
+	busTime(quantity);
+	HostI2CDevice *dev = find(addr);
+	if (dev == NULL) return 0;
+	rxLen = dev->read(rxBuf, quantity);
+	return (uint8_t)rxLen;
+}
+
+int TwoWire::available() { return (int)(rxLen - rxPos); }
+int TwoWire::read() { return (rxPos < rxLen) ? rxBuf[rxPos++] : -1; }
+int TwoWire::peek() { return (rxPos < rxLen) ? rxBuf[rxPos] : -1; }
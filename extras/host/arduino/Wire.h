@@ -0,0 +1,59 @@
+// Wire.h - I2C stand-in for the host build of the MLX90641 library
+// Transactions are routed to simulated devices (see HostI2CDevice) and advance the simulated clock
+// by the time the same bytes would take on a real bus at the setClock() speed.
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include "Arduino.h"
+
+#define I2C_BUFFER_LENGTH 128  // same receive buffer as the ESP32 core
+
+// A device on the simulated bus
+class HostI2CDevice {
+	public:
+	virtual ~HostI2CDevice() {}
+	virtual uint8_t address() const = 0;
+	virtual bool write(const uint8_t *data, size_t n) = 0;  // bytes sent by the controller (false = NACK)
+	virtual size_t read(uint8_t *data, size_t n) = 0;        // bytes requested by the controller (returns bytes delivered)
+};
+
+class TwoWire : public Stream {
+	public:
+	TwoWire();
+	bool begin();
+	bool begin(int sda, int scl);
+	void setClock(uint32_t hz);
+	uint32_t getClock() const { return clockHz; }
+	void attach(HostI2CDevice *dev);    // connect a simulated device to this bus
+	void detach(HostI2CDevice *dev);
+	void beginTransmission(uint8_t addr);
+	void beginTransmission(int addr) { beginTransmission((uint8_t)addr); }
+	uint8_t endTransmission(bool sendStop = true);
+	uint8_t requestFrom(uint8_t addr, uint8_t quantity);
+	uint8_t requestFrom(int addr, int quantity) { return requestFrom((uint8_t)addr, (uint8_t)quantity); }
+	uint8_t requestFrom(uint8_t addr, size_t quantity, bool /*sendStop*/) { return requestFrom(addr, (uint8_t)quantity); }
+	size_t write(uint8_t c);
+	size_t write(const uint8_t *buf, size_t n);
+	int available();
+	int read();
+	int peek();
+	unsigned long transactions;         // bus transactions since begin() (address phases)
+	unsigned long long busMicros;       // simulated time spent on the bus
+
+	private:
+	HostI2CDevice *find(uint8_t addr);
+	void busTime(size_t bytes);          // advance the clock for bytes on the wire (plus start/address/stop)
+	HostI2CDevice *devices[8];
+	uint8_t txAddr;
+	uint8_t txBuf[I2C_BUFFER_LENGTH];
+	size_t txLen;
+	uint8_t rxBuf[I2C_BUFFER_LENGTH];
+	size_t rxLen;
+	size_t rxPos;
+	uint32_t clockHz;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif
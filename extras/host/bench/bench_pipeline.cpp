@@ -0,0 +1,59 @@
+// bench_pipeline.cpp - per-stage timing of the poll() pipeline for every refresh rate and I2C clock
+// Prints one JSON object per line (one per run), e.g. for plotting or comparing two builds:
+//   bench_pipeline [--frames N]
+// Stage times are real CPU time on this machine (steady_clock); bus_us is the simulated I2C time of one
+// frame read at the given clock, which is what dominates on the target.
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdlib.h>
+#include <string.h>
+#include "MLX90641.h"
+#include "SimMLX90641.h"
+
+static const float rateHz[8] = {0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 16.0f, 32.0f, 64.0f};
+static const uint32_t clocks[3] = {100000, 400000, 1000000};
+
+// One run: N frames through poll() at the given refresh rate and I2C clock
+static bool run(uint8_t rate, uint32_t clock, uint32_t frames) {
+	SimMLX90641 sim(MLX90641_ADDR);
+	MLX90641 cam(Wire, MLX90641_ADDR);
+	sim.loadDatasheetExample();
+	sim.setScene(-169.0f, 8.0f);
+	Wire.attach(&sim);
+	Wire.setClock(clock);
+	bool ok = cam.setRefreshRate(rate) && cam.calibrate();
+	if (ok) {
+		sim.frameNumber = 0;
+		cam.profile.reset();
+		unsigned long limit = (unsigned long)(frames * (3000.0f / rateHz[rate] + 200.0f)) + 1000;  // ms of simulated time (slow clocks drop frames)
+		unsigned long t0 = millis();
+		cam.start();
+		while (cam.frameCount < frames && millis() - t0 < limit) {
+			cam.poll();
+			delayMicroseconds(50);  // other work in loop()
+		}
+		cam.stop();
+	}
+	Wire.detach(&sim);
+	printf("{\"rate\":%u,\"rate_hz\":%.1f,\"i2c_hz\":%u,\"ok\":%s,\"frames\":%u,\"produced\":%u,\"errors\":%u,\"bus_us\":%lu,\"profile\":",
+	       (unsigned)rate, rateHz[rate], (unsigned)clock, ok ? "true" : "false", (unsigned)cam.frameCount,
+	       (unsigned)sim.frameNumber, (unsigned)cam.frameErrors, cam.frameReadTime);
+	fflush(stdout);
+	cam.profile.printReport(Serial);
+	Serial.println();
+	fflush(stdout);
+	return ok && cam.frameErrors == 0;
+}
+
+int main(int argc, char **argv) {
+	uint32_t frames = 32;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = (uint32_t)atoi(argv[++i]);
+	}
+	if (frames == 0) frames = 1;
+	bool ok = true;
+	for (uint8_t rate = 0; rate < 8; rate++) {
+		for (int c = 0; c < 3; c++) ok &= run(rate, clocks[c], frames);
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+// SimMLX90641.cpp - simulated MLX90641 on the host I2C bus
+#include "SimMLX90641.h"
+
+SimMLX90641::SimMLX90641(uint8_t addr) : addr(addr) {
+	frameNumber = 0;
+	pointer = 0;
+	lowByteNext = false;
+	memset(eeprom, 0, sizeof(eeprom));
+	memset(ram, 0, sizeof(ram));
+	statusReg = 0;
+	controlReg = 0x0981;  // resolution 2, refresh rate 0x03 (4 Hz), subpage mode on
+	autoFrames = true;
+	lastFrameMicros = micros();
+	replayPos = 0;
+	nackCount = 0;
+	shortCount = 0;
+	corruptCount = 0;
+}
+
+// Signed value into the 11-bit EEPROM field (Hamming bits 15..11 left at 0)
+static uint16_t s11(int v) {
+	return (uint16_t)(v & 0x07FF);
+}
+
+// EEPROM with the calibration parameters of the datasheet worked example (11.2.1, 11.2.2).
+// Each value below is the example value the library's DEBUG output compares against.
+void SimMLX90641::loadDatasheetExample() {
+	memset(eeprom, 0, sizeof(eeprom));
+	uint16_t *e = eeprom - SIM_EEPROM_ADDR;        // index by EEPROM address
+	e[0x2407] = 0x0A1B;                            // device ID 1..3
+	e[0x2408] = 0x0C2D;
+	e[0x2409] = 0x0E3F;
+	e[0x2410] = 0;                                 // Offset_scale = 0
+	e[0x2411] = 2047;                              // Offset_average = -3
+	e[0x2412] = 29;
+	e[0x2415] = s11(765);                          // Kta_average = 765
+	e[0x2416] = (18 << 5) | 3;                     // Kta_scale1 = 18, Kta_scale2 = 3
+	e[0x2417] = s11(666);                          // Kv_average = 666
+	e[0x2418] = (11 << 5) | 4;                     // Kv_scale1 = 11, Kv_scale2 = 4
+	e[0x2419] = (12 << 5) | 12;                    // alpha_scale rows 1..6 = 32
+	e[0x241A] = (12 << 5) | 12;
+	e[0x241B] = (12 << 5) | 12;
+	for (uint16_t a = 0x241C; a <= 0x2421; a++) e[a] = 1484;  // alpha_reference_row = 3.4552e-7
+	e[0x2422] = s11(-72);                          // KsTa = -0.002197265625
+	e[0x2423] = s11(486);                          // Emissivity = 0.949218
+	e[0x2424] = 311;                               // GAIN = 9972
+	e[0x2425] = 20;
+	e[0x2426] = s11(-424);                         // Vdd_25 = -13568
+	e[0x2427] = s11(-98);                          // K_Vdd = -3136
+	e[0x2428] = 383;                               // V_PTAT25 = 12273
+	e[0x2429] = 17;
+	e[0x242A] = s11(342);                          // Kt_PTAT = 42.75
+	e[0x242B] = s11(23);                           // Kv_PTAT = 0.005615234
+	e[0x242C] = 1152;                              // Alpha_PTAT = 9
+	e[0x242D] = 830;                               // alpha_CP = 830 / 2^38
+	e[0x242E] = 38;
+	e[0x242F] = 2044;                              // Off_CP = -119
+	e[0x2430] = 9;
+	e[0x2431] = (13 << 6) | 19;                    // KTa_CP = 0.0023193359
+	e[0x2432] = (4 << 6) | 5;                      // Kv_CP = 0.3125
+	e[0x2433] = 0x0400;                            // Resolution_EE = 2, TGC = 0
+	e[0x2434] = 20;                                // KsTo_scale = 20
+	const uint16_t KsTo_addr[8] = { 0x2435, 0x2436, 0x2437, 0x2438, 0x2439, 0x243B, 0x243D, 0x243F };
+	for (int r = 0; r < 8; r++) e[KsTo_addr[r]] = s11(-734);  // KsTo = -0.000699997
+	e[0x243A] = 200;                               // CT6
+	e[0x243C] = 400;                               // CT7
+	e[0x243E] = 600;                               // CT8
+	for (int i = 0; i < 192; i++) {
+		int d = (i % 7) - 3;                        // small pixel-to-pixel spread
+		e[0x2440 + i] = s11(-670 + d);             // offset SP0
+		e[0x2680 + i] = s11(-668 + d);             // offset SP1
+		e[0x2500 + i] = (uint16_t)(1500 + (i % 50)); // sensitivity
+		e[0x25C0 + i] = (6 << 5) | (uint16_t)(((i % 5) - 2) & 0x1F);  // Kta_EE = 6, Kv_EE = -2..2
+	}
+	e[0x2440 + 95] = s11(-670);                    // pixel 95: pix_OS_ref_SP0 = -673
+	e[0x2680 + 95] = s11(-668);                    // pixel 95: pix_OS_ref_SP1 = -671
+	e[0x25C0 + 95] = (6 << 5);                     // pixel 95: Kta = 0.003101349, Kv = 0.3251953
+	e[0x2500 + 95] = 2047;                         // pixel 95: alpha = 3.45520675182343e-7
+
+	memset(ram, 0, sizeof(ram));
+	setRamWord(0x0580, 18574);                     // V_BE (with V_PTAT: Ta = 42.02, Ta_K4 = 9866871831.8)
+	setRamWord(0x0588, (uint16_t)-105);            // CP
+	setRamWord(0x058A, 9734);                      // gain, Kgain = 1.02445038
+	setRamWord(0x05A0, 1663);                      // V_PTAT
+	setRamWord(0x05AA, (uint16_t)-13430);          // Vdd = 3.25599 V
+	setScene(-169.0f, 4.0f);
+	setPixel(0, 95, 0x03CB);                       // pixel 95 on subpage 0: T_o = 80.12
+	controlReg = 0x0981;
+	statusReg = 0;
+}
+
+void SimMLX90641::setPixel(uint8_t subpage, uint16_t pixel, int16_t raw) {
+	ram[pixel + 32 * (pixel / 32) + 32 * (subpage & 1)] = (uint16_t)raw;  // same map as pix_addr_S0/pix_addr_S1
+}
+
+void SimMLX90641::setScene(float base, float gradient) {
+	for (int i = 0; i < 192; i++) {
+		int16_t raw = (int16_t)lroundf(base + gradient * (float)(i % 16));
+		setPixel(0, i, raw);
+		setPixel(1, i, raw);
+	}
+}
+
+unsigned long SimMLX90641::framePeriodMicros() const {
+	return 2000000UL >> ((controlReg >> 7) & 0x07);  // 0x00 = 0.5 Hz ... 0x07 = 64 Hz
+}
+
+void SimMLX90641::nextFrame() {
+	uint16_t subpage = (statusReg & 0x0007) ^ 1;
+	if (replayPos < replay.size()) {
+		memcpy(ram, replay[replayPos].ram, sizeof(ram));
+		subpage = replay[replayPos].status & 0x0007;
+		replayPos++;
+	}
+	statusReg = (statusReg & ~0x0007) | subpage | 0x0008;  // last measured subpage + new data available
+	frameNumber++;
+}
+
+void SimMLX90641::tick() {
+	if (!autoFrames) return;
+	unsigned long period = framePeriodMicros();
+	while (micros() - lastFrameMicros >= period) {
+		lastFrameMicros += period;
+		nextFrame();
+	}
+}
+
+SimFrame SimMLX90641::capture() const {
+	SimFrame f;
+	f.status = statusReg;
+	memcpy(f.ram, ram, sizeof(ram));
+	return f;
+}
+
+bool SimMLX90641::loadRecording(const char *path) {
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL) return false;
+	SimFrame f;
+	replay.clear();
+	while (fread(&f, sizeof(f), 1, fp) == 1) replay.push_back(f);
+	fclose(fp);
+	replayPos = 0;
+	return !replay.empty();
+}
+
+bool SimMLX90641::saveRecording(const char *path, const std::vector<SimFrame> &frames) {
+	FILE *fp = fopen(path, "wb");
+	if (fp == NULL) return false;
+	bool ok = frames.empty() || fwrite(frames.data(), sizeof(SimFrame), frames.size(), fp) == frames.size();
+	fclose(fp);
+	return ok;
+}
+
+uint16_t SimMLX90641::readWord(uint16_t a) const {
+	if (a >= SIM_EEPROM_ADDR && a < SIM_EEPROM_ADDR + SIM_EEPROM_WORDS) return eeprom[a - SIM_EEPROM_ADDR];
+	if (a >= SIM_RAM_ADDR && a < SIM_RAM_ADDR + SIM_RAM_WORDS) return ram[a - SIM_RAM_ADDR];
+	if (a == 0x8000) return statusReg;
+	if (a == 0x800D) return controlReg;
+	return 0;
+}
+
+void SimMLX90641::writeWord(uint16_t a, uint16_t v) {
+	if (a == 0x8000) statusReg = (v & ~0x0007) | (statusReg & 0x0007);  // bits 2..0 are read-only
+	if (a == 0x800D) controlReg = v;
+	if (a >= SIM_RAM_ADDR && a < SIM_RAM_ADDR + SIM_RAM_WORDS) ram[a - SIM_RAM_ADDR] = v;
+}
+
+bool SimMLX90641::write(const uint8_t *data, size_t n) {
+	tick();
+	if (nackCount > 0) {
+		nackCount--;
+		return false;
+	}
+	if (n < 2) return true;
+	pointer = (uint16_t)((data[0] << 8) | data[1]);
+	lowByteNext = false;
+	for (size_t k = 2; k + 1 < n; k += 2) {
+		writeWord(pointer, (uint16_t)((data[k] << 8) | data[k + 1]));
+		pointer++;
+	}
+	return true;
+}
+
+size_t SimMLX90641::read(uint8_t *data, size_t n) {
+	tick();
+	if (shortCount > 0) {
+		shortCount--;
+		n /= 2;
+	}
+	bool corrupt = false;
+	if (corruptCount > 0) {
+		corruptCount--;
+		corrupt = true;
+	}
+	for (size_t k = 0; k < n; k++) {
+		uint16_t w = readWord(pointer);
+		data[k] = corrupt ? 0xFF : (lowByteNext ? (w & 0xFF) : (w >> 8));
+		if (lowByteNext) pointer++;
+		lowByteNext = !lowByteNext;
+	}
+	return n;
+}
@@ -0,0 +1,74 @@
+// SimMLX90641.h - simulated MLX90641 on the host I2C bus
+// Serves an EEPROM image and the frame RAM (0x0400..0x05BF), the status register (0x8000) and the
+// control register (0x800D). New frames appear at the refresh rate set in the control register,
+// alternating subpages. Frames can be replayed from a recording, and bus faults can be injected.
+#ifndef SimMLX90641_h
+#define SimMLX90641_h
+
+#include <Wire.h>
+#include <vector>
+
+#define SIM_EEPROM_ADDR 0x2400
+#define SIM_EEPROM_WORDS 832
+#define SIM_RAM_ADDR 0x0400
+#define SIM_RAM_WORDS 448
+
+// One recorded frame: status word + frame RAM
+struct SimFrame {
+	uint16_t status;
+	uint16_t ram[SIM_RAM_WORDS];
+};
+
+class SimMLX90641 : public HostI2CDevice {
+	public:
+	SimMLX90641(uint8_t addr = 0x33);
+	uint8_t address() const { return addr; }
+	bool write(const uint8_t *data, size_t n);
+	size_t read(uint8_t *data, size_t n);
+
+	void loadDatasheetExample();                  // EEPROM and RAM with the parameters of the datasheet worked example (11.2)
+	void setScene(float base, float gradient);    // raw pixel words: base + gradient * column, same on both subpages
+	void setPixel(uint8_t subpage, uint16_t pixel, int16_t raw);
+	uint16_t ramWord(uint16_t addr) const { return ram[addr - SIM_RAM_ADDR]; }
+	void setRamWord(uint16_t addr, uint16_t value) { ram[addr - SIM_RAM_ADDR] = value; }
+	uint16_t eepromWord(uint16_t addr) const { return eeprom[addr - SIM_EEPROM_ADDR]; }
+	void setEepromWord(uint16_t addr, uint16_t value) { eeprom[addr - SIM_EEPROM_ADDR] = value; }
+	uint16_t status() const { return statusReg; }
+	uint16_t control() const { return controlReg; }
+
+	void nextFrame();                              // measurement done: next replay frame (if any), toggle subpage, set new data bit
+	void setAutoFrames(bool on) { autoFrames = on; }  // produce frames from the simulated clock (default on)
+	unsigned long framePeriodMicros() const;       // from the refresh rate in the control register
+	bool loadRecording(const char *path);          // replay frames from a file of SimFrame records
+	bool saveRecording(const char *path, const std::vector<SimFrame> &frames);
+	SimFrame capture() const;                      // current status + RAM as a SimFrame
+	size_t replayFrames() const { return replay.size(); }
+
+	// Fault injection: the next count transactions of the given kind fail
+	void nackWrites(uint32_t count) { nackCount = count; }        // address/data NACK on the write phase
+	void shortReads(uint32_t count) { shortCount = count; }       // reads deliver half the requested bytes
+	void corruptReads(uint32_t count) { corruptCount = count; }   // reads deliver 0xFF bytes (bus stuck high)
+
+	uint32_t frameNumber;                          // frames produced so far
+
+	private:
+	void tick();                                   // produce frames that are due on the simulated clock
+	uint16_t readWord(uint16_t a) const;
+	void writeWord(uint16_t a, uint16_t v);
+	uint8_t addr;
+	uint16_t pointer;                              // address of the next word to read
+	bool lowByteNext;                              // reads are byte-wise: high byte first
+	uint16_t eeprom[SIM_EEPROM_WORDS];
+	uint16_t ram[SIM_RAM_WORDS];
+	uint16_t statusReg;
+	uint16_t controlReg;
+	bool autoFrames;
+	unsigned long lastFrameMicros;
+	std::vector<SimFrame> replay;
+	size_t replayPos;
+	uint32_t nackCount;
+	uint32_t shortCount;
+	uint32_t corruptCount;
+};
+
+#endif
@@ -0,0 +1,166 @@
+// test_blobs.cpp - blob detector: shapes that merge late, connectivity, thresholds, limits and a flood-fill reference
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "test_util.h"
+
+static float T[NUM_PIXELS];
+
+static void fill(float v) {
+	for (int i = 0; i < NUM_PIXELS; i++) T[i] = v;
+}
+
+static void rect(int col, int row, int w, int h, float v) {
+	for (int y = row; y < row + h; y++)
+		for (int x = col; x < col + w; x++) T[y * 16 + x] = v;
+}
+
+// Reference: flood fill from every unvisited pixel above level, sorted like the detector
+static std::vector<MLX90641_Blob> floodFill(float level, bool diagonal, uint16_t minArea) {
+	std::vector<MLX90641_Blob> out;
+	std::vector<bool> seen(NUM_PIXELS, false);
+	for (int s = 0; s < NUM_PIXELS; s++) {
+		if (seen[s] || !(T[s] > level)) continue;
+		MLX90641_Blob b = { 0, 0.0f, 0.0f, 15, 11, 0, 0, T[s], (uint8_t)s };
+		float sx = 0, sy = 0;
+		std::vector<int> todo(1, s);
+		seen[s] = true;
+		while (!todo.empty()) {
+			int i = todo.back();
+			todo.pop_back();
+			int x = i % 16, y = i / 16;
+			b.area++;
+			sx += x;
+			sy += y;
+			b.left = std::min<int>(b.left, x);
+			b.right = std::max<int>(b.right, x);
+			b.top = std::min<int>(b.top, y);
+			b.bottom = std::max<int>(b.bottom, y);
+			if (T[i] > b.peak) {
+				b.peak = T[i];
+				b.peakPixel = i;
+			}
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					int nx = x + dx, ny = y + dy;
+					if ((dx == 0 && dy == 0) || (!diagonal && dx != 0 && dy != 0)) continue;
+					if (nx < 0 || nx >= 16 || ny < 0 || ny >= 12) continue;
+					int j = ny * 16 + nx;
+					if (!seen[j] && T[j] > level) {
+						seen[j] = true;
+						todo.push_back(j);
+					}
+				}
+			}
+		}
+		b.x = sx / b.area;
+		b.y = sy / b.area;
+		if (b.area >= minArea) out.push_back(b);
+	}
+	std::stable_sort(out.begin(), out.end(), [](const MLX90641_Blob &a, const MLX90641_Blob &b) {
+		return a.area > b.area || (a.area == b.area && a.peak > b.peak);
+	});
+	return out;
+}
+
+static uint32_t lcg = 99;
+static float noise() {  // uniform in [0, 1)
+	lcg = lcg * 1664525u + 1013904223u;
+	return (float)(lcg >> 8) / 16777216.0f;
+}
+
+int main() {
+	MLX90641_BlobDetector blobs;
+
+	// Two rectangles and a single pixel: sizes, centroids, boxes and peaks, largest first
+	fill(20.0f);
+	rect(1, 1, 4, 3, 40.0f);
+	T[2 * 16 + 3] = 45.0f;
+	rect(10, 6, 3, 5, 35.0f);
+	T[0 * 16 + 15] = 60.0f;
+	blobs.setThreshold(30.0f);
+	CHECK(blobs.detect(T, 25.0f) == 3 && blobs.found == 3);
+	CHECK(blobs.blobs[0].area == 15 && blobs.blobs[0].left == 10 && blobs.blobs[0].right == 12 && blobs.blobs[0].top == 6 && blobs.blobs[0].bottom == 10);
+	CHECK_NEAR(blobs.blobs[0].x, 11.0, 1e-6);
+	CHECK_NEAR(blobs.blobs[0].y, 8.0, 1e-6);
+	CHECK(blobs.blobs[1].area == 12 && blobs.blobs[1].peak == 45.0f && blobs.blobs[1].peakPixel == 35);
+	CHECK_NEAR(blobs.blobs[1].x, 2.5, 1e-6);
+	CHECK_NEAR(blobs.blobs[1].y, 2.0, 1e-6);
+	CHECK(blobs.blobs[2].area == 1 && blobs.blobs[2].peakPixel == 15 && blobs.blobs[2].left == 15 && blobs.blobs[2].bottom == 0);
+	blobs.minArea = 2;
+	CHECK(blobs.detect(T, 25.0f) == 2 && blobs.found == 2);
+	blobs.minArea = 1;
+
+	// A comb whose teeth only meet on the last row, and a U: one blob each, the labels merge late
+	fill(20.0f);
+	for (int x = 0; x < 9; x += 2) rect(x, 0, 1, 11, 50.0f);
+	rect(0, 11, 9, 1, 50.0f);
+	rect(11, 2, 1, 8, 50.0f);
+	rect(15, 2, 1, 8, 51.0f);
+	rect(11, 9, 5, 1, 50.0f);
+	CHECK(blobs.detect(T, 25.0f) == 2);
+	CHECK(blobs.blobs[0].area == 5 * 11 + 9 && blobs.blobs[0].left == 0 && blobs.blobs[0].right == 8 && blobs.blobs[0].top == 0 && blobs.blobs[0].bottom == 11);
+	CHECK(blobs.blobs[1].area == 8 + 8 + 3 && blobs.blobs[1].peak == 51.0f && blobs.blobs[1].top == 2 && blobs.blobs[1].bottom == 9);
+
+	// Pixels touching at a corner (both diagonals): connected with 8-connectivity only
+	fill(20.0f);
+	T[3 * 16 + 3] = T[4 * 16 + 4] = 40.0f;
+	T[3 * 16 + 10] = T[4 * 16 + 9] = 40.0f;
+	CHECK(blobs.detect(T, 25.0f) == 2);
+	blobs.diagonal = false;
+	CHECK(blobs.detect(T, 25.0f) == 4);
+
+	// A checkerboard: the most labels one pass can make (BLOB_LABELS), or a single blob with 8-connectivity
+	for (int i = 0; i < NUM_PIXELS; i++) T[i] = (((i % 16) + (i / 16)) & 1) ? 40.0f : 20.0f;
+	CHECK(blobs.detect(T, 25.0f) == MAX_BLOBS && blobs.found == BLOB_LABELS);
+	blobs.diagonal = true;
+	CHECK(blobs.detect(T, 25.0f) == 1 && blobs.blobs[0].area == NUM_PIXELS / 2);
+
+	// Thresholds relative to the frame mean (from the published statistics) and to Ta; NaN pixels are background
+	MLX90641 cam;
+	MLX90641_Frame frame;
+	fill(20.0f);
+	rect(5, 5, 2, 2, 30.0f);
+	T[0] = NAN;
+	T[1] = 26.0f;
+	frame.Ta = 24.0f;
+	cam.computeStats(T, &frame.stats, frame.T_o);
+	blobs.setThreshold(5.0f, BLOB_ABOVE_MEAN);
+	CHECK(blobs.detect(&frame) == 2 && blobs.blobs[0].area == 4);
+	CHECK(blobs.detect(T, 24.0f) == 2);
+	blobs.setThreshold(5.0f, BLOB_ABOVE_TA);
+	CHECK(blobs.detect(&frame) == 1 && blobs.blobs[0].peak == 30.0f);
+	blobs.setThreshold(0.0f, BLOB_ABSOLUTE);
+	fill(NAN);
+	CHECK(blobs.detect(T, 24.0f) == 0 && blobs.found == 0);
+	blobs.setThreshold(0.0f, BLOB_ABOVE_MEAN);
+	CHECK(blobs.detect(T, 24.0f) == 0);
+
+	// Random scenes against the flood fill, both connectivities, several thresholds
+	double seconds = 0.0;
+	int runs = 0;
+	for (int scene = 0; scene < 200; scene++) {
+		for (int i = 0; i < NUM_PIXELS; i++) T[i] = 20.0f + 20.0f * noise();
+		bool diagonal = scene & 1;
+		float level = 20.0f + 2.0f * (scene % 10);
+		blobs.diagonal = diagonal;
+		blobs.minArea = 1 + (scene % 3);
+		blobs.setThreshold(level);
+		auto t0 = std::chrono::steady_clock::now();
+		blobs.detect(T, 25.0f);
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		runs++;
+		std::vector<MLX90641_Blob> ref = floodFill(level, diagonal, blobs.minArea);
+		CHECK(blobs.found == ref.size());
+		CHECK(blobs.count == std::min<size_t>(ref.size(), MAX_BLOBS));
+		for (int k = 0; k < blobs.count && k < (int)ref.size(); k++) {
+			const MLX90641_Blob &a = blobs.blobs[k], &b = ref[k];
+			CHECK(a.area == b.area && a.peak == b.peak && a.peakPixel == b.peakPixel);
+			CHECK(a.left == b.left && a.right == b.right && a.top == b.top && a.bottom == b.bottom);
+			CHECK_NEAR(a.x, b.x, 1e-5);
+			CHECK_NEAR(a.y, b.y, 1e-5);
+		}
+	}
+	printf("blob detection: %.2f us per frame on this machine\n", 1e6 * seconds / runs);
+	return checkResult("test_blobs");
+}
@@ -0,0 +1,111 @@
+// test_bus_faults.cpp - I2C error handling (NACKs, short reads), status/control registers and frame replay
+#include "test_util.h"
+
+int main() {
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	Wire.setClock(400000);
+	MLX90641 cam;
+	uint16_t image[EEPROM_WORDS];
+
+	// EEPROM dump: failed blocks are retried, a persistent failure is reported
+	sim.shortReads(2);
+	CHECK(cam.readEEPROMBlock(0x2400, EEPROM_WORDS, image));
+	CHECK(cam.eepromRetries == 2);
+	for (int i = 0; i < EEPROM_WORDS; i++) CHECK(image[i] == sim.eepromWord(0x2400 + i));
+	sim.nackWrites(EEPROM_RETRIES);
+	CHECK(!cam.readEEPROMBlock(0x2400, EEPROM_WORDS, image));
+	MLX90641 absent(Wire, 0x35);  // nothing at this address
+	CHECK(!absent.readEEPROMBlock(0x2400, EEPROM_WORDS, image));
+	CHECK(!absent.isNewDataAvailable());
+	CHECK(cam.calibrate());
+
+	// Status register: the new data bit is cleared, the other writable bits are kept
+	sim.nextFrame();
+	CHECK(cam.isNewDataAvailable());
+	uint16_t before = sim.status();
+	CHECK(cam.clearNewDataBit());
+	CHECK(sim.status() == (before & ~0x0008));
+	CHECK(!cam.isNewDataAvailable());
+	sim.nackWrites(1);
+	CHECK(!cam.clearNewDataBit());
+
+	// Control register: refresh rate bits only
+	CHECK(cam.setRefreshRate(0x05));
+	CHECK(((sim.control() >> 7) & 0x07) == 0x05);
+	CHECK((sim.control() & ~(0x07 << 7)) == (0x0981 & ~(0x07 << 7)));
+	CHECK(!cam.setRefreshRate(0x08));
+
+	// poll(): a failed burst drops the frame, the next one is read normally
+	cam.start();
+	sim.nextFrame();
+	for (int k = 0; k < 3; k++) {
+		cam.poll();
+		delay(POLL_INTERVAL);
+	}
+	sim.shortReads(1);
+	for (int k = 0; k < 20 && cam.frameErrors == 0; k++) cam.poll();
+	CHECK(cam.frameErrors == 1);
+	CHECK(cam.frameCount == 0);
+	sim.nextFrame();
+	for (int k = 0; k < 50 && cam.frameCount == 0; k++) {
+		cam.poll();
+		delay(1);
+	}
+	CHECK(cam.frameCount == 1);
+
+	// poll(): the new data bit is cleared with one write. A failed clear counts as a frame error, and the
+	// frame is read again
+	sim.nextFrame();
+	for (int k = 0; k < 50 && cam.state != MLX90641_CLEAR_BIT; k++) {
+		cam.poll();
+		delay(1);
+	}
+	CHECK(cam.state == MLX90641_CLEAR_BIT);
+	sim.nackWrites(1);
+	unsigned long transactions = Wire.transactions;
+	CHECK(!cam.poll());
+	CHECK(Wire.transactions == transactions + 1);
+	CHECK(cam.frameErrors == 2 && cam.frameCount == 1);
+	CHECK((sim.status() & 0x0008) != 0);  // still flagged
+	for (int k = 0; k < 50 && cam.state != MLX90641_CLEAR_BIT; k++) {
+		cam.poll();
+		delay(1);
+	}
+	transactions = Wire.transactions;
+	cam.poll();
+	CHECK(Wire.transactions == transactions + 1);
+	CHECK((sim.status() & 0x0008) == 0);
+	for (int k = 0; k < 50 && cam.frameCount == 1; k++) cam.poll();
+	CHECK(cam.frameCount == 2 && cam.frameErrors == 2);
+	cam.stop();
+
+	// Replay: recorded frames come back in order, with their subpage
+	std::vector<SimFrame> rec;
+	for (int f = 0; f < 3; f++) {
+		sim.setScene(-169.0f + 2000.0f * f, 0.0f);
+		sim.nextFrame();
+		rec.push_back(sim.capture());
+	}
+	CHECK(sim.saveRecording("test_bus_faults.rec", rec));
+	SimMLX90641 replay;
+	replay.loadDatasheetExample();
+	replay.setAutoFrames(false);
+	CHECK(replay.loadRecording("test_bus_faults.rec"));
+	CHECK(replay.replayFrames() == 3);
+	Wire.detach(&sim);
+	Wire.attach(&replay);
+	float previous = -1000.0f;
+	for (int f = 0; f < 3; f++) {
+		replay.nextFrame();
+		CHECK((replay.status() & 0x0001) == (rec[f].status & 0x0001));
+		cam.readTempC();
+		CHECK(cam.subpage == (rec[f].status & 0x0001));
+		CHECK(cam.T_o[0] > previous + 5.0f);  // scenes get warmer
+		previous = cam.T_o[0];
+	}
+	remove("test_bus_faults.rec");
+	return checkResult("test_bus_faults");
+}
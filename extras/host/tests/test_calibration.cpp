@@ -0,0 +1,71 @@
+// test_calibration.cpp - stored calibration: a warm boot from the packed blob matches a full EEPROM parse
+#include "test_util.h"
+
+int main() {
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	Wire.setClock(400000);
+
+	// Cold boot: whole EEPROM and every parser
+	MLX90641 cold;
+	unsigned long t0 = Wire.busMicros;
+	CHECK(cold.calibrate());
+	unsigned long coldBus = Wire.busMicros - t0;
+	CHECK(cold.deviceID[0] == 0x0A1B && cold.deviceID[1] == 0x0C2D && cold.deviceID[2] == 0x0E3F);
+
+	// Only the EEPROM header stays resident, and the table can be finished again without the pixel words
+	for (int i = 0; i < EEPROM_HEADER_WORDS; i++) CHECK(cold.eeData[i] == sim.eepromWord(0x2400 + i));
+	CHECK(cold.readEEPROM_unsigned(0x2433) == sim.eepromWord(0x2433) && cold.readEEPROM_unsigned(0x2500 + 95) == 0);
+	CHECK(!cold.readEEPROMBlock(0x2400, EEPROM_WORDS, cold.eeData));  // would not fit
+	static MLX90641_PixelCal table;
+	table = cold.pixCal;
+	cold.calcPixelTable();
+	CHECK(memcmp(&table, &cold.pixCal, sizeof(table)) == 0);
+	cold.TGC = 0.5f;  // the example's TGC is 0: the CP sensitivity comes off each pixel's
+	cold.calcPixelTable();
+	CHECK(cold.alpha_CP > 0.0f && cold.pixCal.alpha[95] == table.alpha[95] - 0.5f * cold.alpha_CP);
+	CHECK(cold.pixCal.Kta[95] == table.Kta[95] && cold.pixCal.offset[1][95] == table.offset[1][95]);
+	cold.badPixels[37] = true;    // flagged pixels are kept too
+
+	static MLX90641_Calibration blob;
+	cold.serializeCalibration(&blob);
+	CHECK(blob.size == sizeof(MLX90641_Calibration));
+
+	// Warm boot: only the EEPROM header is read
+	MLX90641 warm;
+	t0 = Wire.busMicros;
+	CHECK(warm.deserializeCalibration(&blob));
+	unsigned long warmBus = Wire.busMicros - t0;
+	printf("bus time: cold %lu us, warm %lu us\n", coldBus, warmBus);
+	CHECK(warmBus * 10 < coldBus);
+	CHECK(memcmp(&warm.pixCal, &cold.pixCal, sizeof(warm.pixCal)) == 0);
+	CHECK(warm.eepromCRC == cold.eepromCRC && warm.badPixels[37] && !warm.badPixels[38]);
+	sim.nextFrame();
+	cold.readTempC();
+	warm.readTempC();
+	CHECK(warm.Ta == cold.Ta && warm.Vdd == cold.Vdd);
+	for (int i = 0; i < NUM_PIXELS; i++) CHECK(warm.T_o[i] == cold.T_o[i]);
+
+	// Damaged or foreign blobs are refused, and leave the sensor's values alone
+	MLX90641 other;
+	static MLX90641_Calibration bad;
+	bad = blob;
+	bad.Kta[5] += 1e-6f;
+	CHECK(!other.deserializeCalibration(&bad));
+	bad = blob;
+	bad.version++;
+	CHECK(!other.deserializeCalibration(&bad));
+	sim.setEepromWord(0x2408, 0x1234);  // another sensor at this address
+	CHECK(!other.deserializeCalibration(&blob));
+	sim.setEepromWord(0x2408, 0x0C2D);
+	sim.setEepromWord(0x2410, sim.eepromWord(0x2410) ^ 0x0001);  // same sensor, changed configuration word
+	CHECK(!other.deserializeCalibration(&blob));
+	CHECK(!other.pixCalValid && other.Emissivity == 1.0f);
+	sim.setEepromWord(0x2410, sim.eepromWord(0x2410) ^ 0x0001);
+	sim.nackWrites(EEPROM_RETRIES);  // no sensor answering
+	CHECK(!other.deserializeCalibration(&blob));
+	CHECK(other.deserializeCalibration(&blob));
+	return checkResult("test_calibration");
+}
@@ -0,0 +1,160 @@
+// test_codec.cpp - lossless Rice stream encoding: round trips on a recorded session, worst cases, keyframes and errors
+#include <chrono>
+#include <vector>
+#include "test_util.h"
+
+// Feed bytes to the decoder, return the number of frames it reports
+static int feed(MLX90641_StreamDecoder &dec, const uint8_t *p, size_t n) {
+	int frames = 0;
+	for (size_t k = 0; k < n; k++) frames += dec.push(p[k]);
+	return frames;
+}
+
+static uint32_t lcg = 12345;
+static float noise(float amplitude) {  // uniform in [-amplitude, amplitude)
+	lcg = lcg * 1664525u + 1013904223u;
+	return amplitude * ((float)(lcg >> 8) / 8388608.0f - 1.0f);
+}
+
+int main() {
+	// Record a raw session on the simulated sensor and compensate it again on the host, as raw_reprocess does.
+	// The simulated scene is noise-free, so about 0.1°C of sensor noise is added to the recorded temperatures.
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	MLX90641 recorder;
+	CHECK(recorder.calibrate());
+	MLX90641_CalibrationExport exp;
+	CHECK(recorder.exportCalibration(&exp));
+	const int frames = 96;
+	std::vector<MLX90641_RawFrame> raw(frames);
+	for (int k = 0; k < frames; k++) {
+		sim.setScene(-169.0f + 0.5f * k, 4.0f);
+		if (k >= 40 && k < 60) {
+			for (int sp = 0; sp < 2; sp++) sim.setPixel(sp, 50 + k, 1500);  // a moving hot spot
+		}
+		sim.nextFrame();
+		CHECK(recorder.readRaw(&raw[k]));
+	}
+	MLX90641 host;
+	CHECK(host.importCalibration(&exp));
+	std::vector<float> T(frames * STREAM_PIXELS), Ta(frames);
+	for (int k = 0; k < frames; k++) {
+		host.compensateRaw(&raw[k]);
+		Ta[k] = host.Ta;
+		for (int i = 0; i < STREAM_PIXELS; i++) T[k * STREAM_PIXELS + i] = host.T_o[i] + noise(0.1f);
+	}
+
+	// Bit-exact round trip, intra Rice keyframes, smaller than the delta encoding of the same frames
+	MLX90641_StreamEncoder rice, delta;
+	MLX90641_StreamDecoder dec;
+	uint8_t buf[STREAM_MAX_BYTES], dbuf[STREAM_MAX_BYTES];
+	std::vector<uint8_t> stream;
+	std::vector<size_t> starts;
+	int intra = 0;
+	double encodeSeconds = 0.0;
+	for (int k = 0; k < frames; k++) {
+		auto t0 = std::chrono::steady_clock::now();
+		size_t n = rice.encode(&T[k * STREAM_PIXELS], Ta[k], 500 + k, 250 * k, k & 1, STREAM_RICE, buf);
+		encodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		delta.encode(&T[k * STREAM_PIXELS], Ta[k], 500 + k, 250 * k, k & 1, STREAM_DELTA, dbuf);
+		CHECK(n <= STREAM_HEADER_BYTES + 2 * STREAM_PIXELS);
+		CHECK((buf[2] & 0x0F) == STREAM_RICE);
+		if (buf[18] == 0 && buf[19] == 0) intra++;
+		starts.push_back(stream.size());
+		stream.insert(stream.end(), buf, buf + n);
+		CHECK(feed(dec, buf, n) == 1);
+		CHECK(dec.header.seq == (uint32_t)(500 + k) && dec.header.timestamp == (uint32_t)(250 * k));
+		CHECK(dec.header.Ta == rice.toUnits(Ta[k]));
+		for (int i = 0; i < STREAM_PIXELS; i++) CHECK(dec.pixels[i] == rice.toUnits(T[k * STREAM_PIXELS + i]));
+	}
+	CHECK(intra == (frames + STREAM_KEYFRAME - 1) / STREAM_KEYFRAME);
+	CHECK(dec.frames == (uint32_t)frames && dec.crcErrors == 0 && dec.missingReference == 0);
+	CHECK(rice.framesEncoded == (uint32_t)frames && rice.bytesEncoded == stream.size());
+	CHECK(rice.compressionRatio() > 3.0f);
+	CHECK(rice.compressionRatio() > 1.3f * delta.compressionRatio());
+	printf("recorded session: %.2f:1 (delta %.2f:1) against 768-byte float frames, %.1f us per frame encode\n",
+	       rice.compressionRatio(), delta.compressionRatio(), 1e6 * encodeSeconds / frames);
+
+	// A corrupted frame is dropped, the inter frames after it wait for the next intra frame
+	std::vector<uint8_t> bad = stream;
+	bad[starts[5] + STREAM_HEADER_BYTES + 3] ^= 0x10;
+	MLX90641_StreamDecoder dec2;
+	CHECK(feed(dec2, bad.data(), bad.size()) == frames - (STREAM_KEYFRAME - 5));
+	CHECK(dec2.crcErrors >= 1 && dec2.missingReference == STREAM_KEYFRAME - 6);
+	for (int i = 0; i < STREAM_PIXELS; i++) CHECK(dec2.pixels[i] == dec.pixels[i]);
+
+	// A payload with a valid CRC that does not unpack to exactly 192 pixels is a format error
+	bad.assign(stream.begin(), stream.begin() + STREAM_HEADER_BYTES);
+	bad.resize(STREAM_HEADER_BYTES + STREAM_PIXELS / 8, 0);  // 192 one-bit codes, but k starts above 0
+	bad[16] = STREAM_PIXELS / 8;
+	bad[17] = 0;
+	uint16_t crc = MLX90641_crc16(bad.data() + STREAM_HEADER_BYTES, STREAM_PIXELS / 8, MLX90641_crc16(bad.data(), 20));
+	bad[20] = crc & 0xFF;
+	bad[21] = crc >> 8;
+	MLX90641_StreamDecoder dec3;
+	CHECK(feed(dec3, bad.data(), bad.size()) == 0 && dec3.crcErrors == 1);
+
+	// Worst cases: extreme values and NaN (escaped residuals), and incompressible noise (sent as absolute frames)
+	MLX90641_StreamEncoder enc;
+	MLX90641_StreamDecoder dec4;
+	float W[STREAM_PIXELS];
+	for (int k = 0; k < 6; k++) {
+		for (int i = 0; i < STREAM_PIXELS; i++) {
+			if (k < 3) W[i] = ((i + k) & 1) ? 330.0f : -330.0f;
+			else W[i] = noise(320.0f);
+		}
+		W[k] = NAN;
+		size_t n = enc.encode(W, 25.0f, k, k, 0, STREAM_RICE, buf);
+		CHECK(n <= STREAM_MAX_BYTES);
+		if (k >= 3) CHECK((buf[2] & 0x0F) == STREAM_ABSOLUTE && n == STREAM_HEADER_BYTES + 2 * STREAM_PIXELS);
+		CHECK(feed(dec4, buf, n) == 1);
+		for (int i = 0; i < STREAM_PIXELS; i++) CHECK(dec4.pixels[i] == enc.toUnits(W[i]));
+	}
+	CHECK(dec4.crcErrors == 0 && dec4.missingReference == 0);
+
+	// A flat frame after a noisy one: the inter frame against an absolute reference is tiny
+	for (int i = 0; i < STREAM_PIXELS; i++) W[i] = 20.0f;
+	size_t n = enc.encode(W, 25.0f, 6, 6, 0, STREAM_RICE, buf);
+	CHECK(feed(dec4, buf, n) == 1);
+	n = enc.encode(W, 25.0f, 7, 7, 0, STREAM_RICE, buf);
+	CHECK(n <= STREAM_HEADER_BYTES + STREAM_PIXELS / 8 + 4 && buf[18] == 1);
+	CHECK(feed(dec4, buf, n) == 1 && dec4.pixels[10] == 2000);
+
+	// The same frame encoded twice: the second one is coded without a reference (ref 0 means intra)
+	for (int i = 0; i < STREAM_PIXELS; i++) W[i] = 20.0f + 0.01f * i;
+	W[100] = 26.0f;
+	n = enc.encode(W, 25.0f, 8, 8, 0, STREAM_RICE, buf);
+	CHECK(buf[18] == 1 && feed(dec4, buf, n) == 1);
+	n = enc.encode(W, 25.0f, 8, 8, 0, STREAM_RICE, buf);
+	CHECK((buf[2] & 0x0F) == STREAM_RICE && buf[18] == 0 && buf[19] == 0);
+	CHECK(feed(dec4, buf, n) == 1 && dec4.pixels[100] == 2600);
+	for (int i = 0; i < STREAM_PIXELS; i++) CHECK(dec4.pixels[i] == enc.toUnits(W[i]));
+	W[100] = 27.0f;
+	n = enc.encode(W, 25.0f, 9, 9, 0, STREAM_RICE, buf);
+	CHECK(buf[18] == 1 && feed(dec4, buf, n) == 1 && dec4.pixels[100] == 2700);
+	CHECK(dec4.crcErrors == 0 && dec4.missingReference == 0);
+
+	// streamFrame() from the library with the Rice encoding
+	MLX90641 cam;
+	CHECK(cam.calibrate());
+	MLX90641_FrameStore published;
+	cam.setFrameStore(&published);
+	MLX90641_StreamEncoder camStream;
+	CapturePrint out;
+	MLX90641_StreamDecoder dec5;
+	for (int k = 0; k < 4; k++) {
+		sim.setScene(-169.0f + 5.0f * k, 1.0f);
+		sim.nextFrame();
+		cam.readTempC();
+		const MLX90641_Frame *f = cam.latestFrame();
+		n = cam.streamFrame(f, camStream, out, STREAM_RICE);
+		CHECK(n == out.bytes.size() && n < STREAM_HEADER_BYTES + (k == 0 ? 2 : 1) * STREAM_PIXELS);  // the keyframe carries the simulated pixel-to-pixel spread
+		CHECK(feed(dec5, out.bytes.data(), n) == 1);
+		out.bytes.clear();
+		for (int i = 0; i < NUM_PIXELS; i++) CHECK(dec5.pixels[i] == camStream.toUnits(f->T_o[i]));
+	}
+	CHECK(dec5.header.encoding == STREAM_RICE && dec5.header.ref == 1);
+	return checkResult("test_codec");
+}
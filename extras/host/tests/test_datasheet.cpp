@@ -0,0 +1,69 @@
+// test_datasheet.cpp - EEPROM parsers and per-frame values against the worked example of datasheet section 11.2
+// The simulated sensor serves the example's EEPROM parameters and RAM words (see SimMLX90641::loadDatasheetExample()).
+#include "test_util.h"
+
+int main() {
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	Wire.attach(&sim);
+	Wire.begin();
+	Wire.setClock(400000);
+	MLX90641 cam;
+	CHECK(cam.calibrate());
+	CHECK(cam.eepromRetries == 0);
+
+	// 11.2.2.1 - 11.2.2.4: supply voltage, ambient temperature, gain
+	CHECK(cam.K_Vdd == -3136);
+	CHECK(cam.Vdd_25 == -13568);
+	CHECK_NEAR(cam.Vdd, 3.25599, 1e-5);
+	CHECK_NEAR(cam.Ta, 42.02, 0.01);
+	CHECK_NEAR(cam.readKgain(), 1.02445038, 1e-7);
+
+	// 11.2.2.5: pixel offsets, Kta, Kv (pixel 95)
+	CHECK(cam.pixCal.offset[0][95] == -673);
+	CHECK(cam.pixCal.offset[1][95] == -671);
+	CHECK_NEAR(cam.pixCal.Kta[95], 0.003101349, 1e-9);
+	CHECK_NEAR(cam.pixCal.Kv[95], 0.3251953, 1e-7);
+	CHECK_NEAR(cam.Emissivity, 0.949218, 1e-6);
+
+	// 11.2.2.6 - 11.2.2.8: compensation pixel, TGC, sensitivity
+	CHECK(cam.pix_OS_ref_CP == -119);
+	CHECK_NEAR(cam.Kv_CP, 0.3125, 1e-7);
+	CHECK_NEAR(cam.KTa_CP, 0.0023193359, 1e-10);
+	CHECK_NEAR(cam.TGC, 0.0, 0.0);
+	CHECK_NEAR(cam.alpha_CP, 3.01952240988612e-9, 1e-15);
+	CHECK_NEAR(cam.KsTa, -0.002197265625, 1e-12);
+	CHECK_NEAR(cam.alpha_reference_row1, 3.45520675182343e-7, 1e-13);
+
+	// 11.2.2.9: temperature ranges
+	const int CT[8] = { -40, -20, 0, 80, 120, 200, 400, 600 };
+	const double Alpha_cr[8] = { 1.028599, 1.014198721, 1.0, 0.94400024, 0.917568347, 0.86618474, 0.744919396, 0.640631128 };
+	for (int r = 0; r < 8; r++) {
+		CHECK(cam.CT[r] == CT[r]);
+		CHECK_NEAR(cam.KsTo[r], -0.000699997, 1e-9);
+		CHECK_NEAR(cam.Alpha_cr[r], Alpha_cr[r], 1e-6);
+	}
+
+	// One frame: T_a-r (11.2.2.9) and T_o against a double-precision reference
+	sim.nextFrame();
+	cam.readTempC();
+	CHECK_NEAR(cam.Ta_r / 1e9, 9.8997, 1e-3);  // example value 9899175739.92
+	for (int i = 0; i < NUM_PIXELS; i++) {
+		CHECK_NEAR(cam.T_o[i], referenceTo(cam, i), 1e-3);  // built with CAL_SLOPE = 1, CAL_INT = 0
+		CHECK(!cam.badPixels[i]);
+	}
+
+	// 11.2.2.9: the example's raw word of pixel 95 (0x03CB on subpage 0). The example stops at the basic range,
+	// S_x = -8.18463664533495e-8 and T_o = 80.12°C. That is above CT4 = 80°C, so the library goes on with
+	// 11.2.2.9.1: range 4 (Alpha_cr = 0.94400024, KsTo = -0.000699997) gives 80.155°C.
+	float scratch[SCRATCH_FLOATS];
+	do {
+		sim.nextFrame();
+		cam.readTempC(scratch);
+	} while (cam.subpage != 0);
+	CHECK(cam.frameData[95 + 64] == 0x03CB);
+	CHECK_NEAR(scratch[NUM_PIXELS + 95], -8.18463664533495e-8, 2e-11);
+	CHECK_NEAR(cam.T_o[95], 80.155, 0.005);
+	CHECK_NEAR(cam.T_o[95], referenceTo(cam, 95), 1e-3);
+	return checkResult("test_datasheet");
+}
@@ -0,0 +1,123 @@
+// test_defects.cpp - defect map: EEPROM markers, dead/stuck/outlier detection over a window, fill-in and persistence
+#include "test_util.h"
+
+// Average of the good 4-neighbours of pixel i in T (the fill-in fixBadPixels() should produce)
+static float neighbourMean(const MLX90641 &cam, const float *T, int i) {
+	const int d[4][2] = { { -1, 0 }, { 0, -1 }, { 0, 1 }, { 1, 0 } };
+	float sum = 0.0f;
+	int n = 0;
+	for (int k = 0; k < 4; k++) {
+		int row = i / 16 + d[k][0], col = i % 16 + d[k][1];
+		if (row < 0 || row > 11 || col < 0 || col > 15) continue;
+		int j = row * 16 + col;
+		if (cam.badPixels[j]) continue;
+		sum += T[j];
+		n++;
+	}
+	return n ? sum / n : 0.0f;
+}
+
+// One frame of a scene that moves a little, with a stuck, a hot and a dead pixel
+static void defectFrame(SimMLX90641 &sim, MLX90641 &cam, int k, bool hot) {
+	sim.setScene(-169.0f + 7.0f * (k % 5), 4.0f);
+	for (int sp = 0; sp < 2; sp++) {
+		sim.setPixel(sp, 100, -150);         // stuck: same raw word whatever the scene does
+		if (hot) sim.setPixel(sp, 120, 3000 + 7 * (k % 5));  // hot spot, far above its neighbours
+		sim.setPixel(sp, 140, -32768);       // dead: railed raw word
+	}
+	sim.nextFrame();
+	cam.readTempC();
+}
+
+int main() {
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	Wire.setClock(400000);
+
+	// EEPROM marker: all four calibration words of pixel 50 are zero
+	const uint16_t pixelWords[4] = { 0x2440, 0x2500, 0x25C0, 0x2680 };
+	uint16_t saved[4];
+	for (int k = 0; k < 4; k++) {
+		saved[k] = sim.eepromWord(pixelWords[k] + 50);
+		sim.setEepromWord(pixelWords[k] + 50, 0);
+	}
+	MLX90641 cam;
+	CHECK(cam.calibrate());
+	for (int k = 0; k < 4; k++) sim.setEepromWord(pixelWords[k] + 50, saved[k]);
+	CHECK(cam.badPixels[50] == DEFECT_EEPROM);
+	CHECK(cam.countDefects() == 1 && cam.countDefects(DEFECT_EEPROM) == 1);
+	CHECK(!cam.setDefectWindow(256));
+
+	// Flagged pixels are replaced by the average of their good neighbours, corners and edges included
+	cam.badPixels[0] = true;
+	cam.badPixels[31] = true;
+	sim.setScene(-169.0f, 4.0f);
+	sim.nextFrame();
+	cam.readTempC();
+	const float *T = cam.T_o_SP[cam.subpage];
+	CHECK_NEAR(cam.T_o[50], neighbourMean(cam, T, 50), 1e-4);
+	CHECK_NEAR(cam.T_o[0], neighbourMean(cam, T, 0), 1e-4);
+	CHECK_NEAR(cam.T_o[31], neighbourMean(cam, T, 31), 1e-4);
+	CHECK(cam.T_o[1] == T[1]);
+	CHECK(cam.badPixels[0] == DEFECT_MANUAL);
+
+	// Statistics over a window: the stuck, hot and dead pixels are flagged, their neighbours are not
+	cam.clearDefects(DEFECT_MANUAL);
+	CHECK(cam.setDefectWindow(16));
+	for (int k = 0; k < 15; k++) defectFrame(sim, cam, k, true);
+	CHECK(cam.countDefects(DEFECT_DETECTED) == 0);  // nothing is flagged before the window ends
+	CHECK(!isnan(cam.T_o[140]));                     // but a pixel without a result is filled in right away
+	defectFrame(sim, cam, 15, true);
+	CHECK(cam.badPixels[100] & DEFECT_STUCK);
+	CHECK(cam.badPixels[120] == DEFECT_OUTLIER);
+	CHECK(cam.badPixels[140] & DEFECT_DEAD);
+	CHECK(cam.badPixels[50] == (DEFECT_EEPROM | DEFECT_DEAD));  // no sensitivity, so no result either
+	CHECK(cam.countDefects(DEFECT_STUCK) == 2 && cam.countDefects(DEFECT_OUTLIER) == 1 && cam.countDefects(DEFECT_DEAD) == 2);  // the railed pixel is stuck too
+	CHECK(!cam.badPixels[119] && !cam.badPixels[121] && !cam.badPixels[104] && !cam.badPixels[136]);
+	defectFrame(sim, cam, 16, true);
+	T = cam.T_o_SP[cam.subpage];
+	CHECK_NEAR(cam.T_o[120], neighbourMean(cam, T, 120), 1e-4);
+	CHECK(cam.T_o[120] < 100.0f);
+
+	// A pixel that behaves again is cleared at the end of the next window; hand-set flags stay
+	cam.badPixels[7] |= DEFECT_MANUAL;
+	for (int k = 17; k < 32; k++) defectFrame(sim, cam, k, false);
+	CHECK(cam.badPixels[120] == 0);
+	CHECK(cam.badPixels[100] & DEFECT_STUCK);
+	CHECK(cam.badPixels[7] == DEFECT_MANUAL);
+
+	// By default there are no statistics: a steady one-pixel hot spot (a small hot object) stays as it is
+	MLX90641 plain;
+	CHECK(plain.calibrate());
+	CHECK(plain.defectWindow == 0);
+	for (int k = 0; k < 80; k++) {
+		sim.setScene(-169.0f + 3.0f * (k % 5), 4.0f);
+		for (int sp = 0; sp < 2; sp++) sim.setPixel(sp, 120, 3000);
+		sim.nextFrame();
+		plain.readTempC();
+	}
+	CHECK(plain.countDefects(DEFECT_DETECTED) == 0);
+	CHECK(plain.T_o[120] > plain.T_o[119] + 20.0f && plain.T_o[120] == plain.T_o_SP[plain.subpage][120]);
+
+	// A scene that does not move at all flags nothing as stuck
+	MLX90641 still;
+	CHECK(still.calibrate());
+	CHECK(still.setDefectWindow(8));
+	sim.setScene(-169.0f, 4.0f);
+	for (int k = 0; k < 8; k++) {
+		sim.nextFrame();
+		still.readTempC();
+	}
+	CHECK(still.countDefects() == 0);
+
+	// The map is stored with the calibration
+	static MLX90641_Calibration blob;
+	cam.serializeCalibration(&blob);
+	MLX90641 warm;
+	CHECK(warm.deserializeCalibration(&blob));
+	CHECK(memcmp(warm.badPixels, cam.badPixels, sizeof(cam.badPixels)) == 0);
+	CHECK(warm.countDefects() == cam.countDefects());
+	return checkResult("test_defects");
+}
@@ -0,0 +1,155 @@
+// test_events.cpp - pre-trigger event recorder: ring contents, max/rise/count/manual triggers and the pipeline hook
+#include "test_util.h"
+
+static MLX90641 cam;  // computes the frame statistics (and holds the regions of interest)
+static MLX90641_Frame frame;
+
+// A frame at about base °C with hotCount pixels from hotPixel on at hot °C (hotPixel -1: none), timestamp t ms
+static void makeFrame(uint32_t seq, uint32_t t, float base, int hotPixel = -1, float hot = 0.0f, int hotCount = 1) {
+	float T[NUM_PIXELS];
+	for (int i = 0; i < NUM_PIXELS; i++) T[i] = base + 0.001f * i;
+	for (int k = 0; k < hotCount && hotPixel >= 0; k++) T[hotPixel + k] = hot;
+	frame.seq = seq;
+	frame.timestamp = t;
+	frame.Ta = 25.0f;
+	cam.computeStats(T, &frame.stats, frame.T_o);
+}
+
+int main() {
+	MLX90641_EventRecorder rec;
+	CHECK(rec.state() == EVENT_ARMED && rec.eventFrames() == 0);
+	CHECK(!rec.setWindow(EVENT_FRAMES, 0) && !rec.setWindow(10, EVENT_FRAMES - 10));
+	CHECK(rec.setWindow(5, 3));
+
+	// Max trigger: 5 frames before, the trigger frame, 3 after; later frames are ignored
+	rec.triggerOnMax(80.0f);
+	for (uint32_t k = 1; k <= 30; k++) {
+		makeFrame(k, 100 * k, 30.0f, (k == 12) ? 40 : -1, 95.0f);
+		rec.add(&frame);
+		CHECK(rec.state() == ((k < 12) ? EVENT_ARMED : (k < 15) ? EVENT_TRIGGERED : EVENT_FROZEN));
+	}
+	CHECK(rec.cause == TRIGGER_MAX);
+	CHECK(rec.eventFrames() == 9 && rec.triggerIndex() == 5);
+	for (uint16_t k = 0; k < 9; k++) CHECK(rec.eventFrame(k)->seq == 7u + k);
+	CHECK(rec.eventFrame(9) == NULL);
+	const MLX90641_EventFrame *e = rec.eventFrame(rec.triggerIndex());
+	CHECK(e->T[40] == 4750 && e->T[41] == 1502 && e->Ta == 1250 && e->timestamp == 1200);
+
+	// A trigger soon after arming keeps only the frames there are; the ring wraps many times without one
+	rec.rearm();
+	for (uint32_t k = 1; k <= 3; k++) {
+		makeFrame(k, 100 * k, 30.0f, (k == 3) ? 0 : -1, 90.0f);
+		rec.add(&frame);
+	}
+	CHECK(rec.triggerIndex() == 2);
+	for (uint32_t k = 4; k <= 6; k++) {
+		makeFrame(k, 100 * k, 30.0f);
+		rec.add(&frame);
+	}
+	CHECK(rec.eventFrames() == 6 && rec.eventFrame(0)->seq == 1);
+	rec.rearm();
+	CHECK(rec.setWindow(40, EVENT_FRAMES - 41));
+	for (uint32_t k = 1; k <= 1000; k++) {
+		makeFrame(k, 100 * k, 30.0f, (k == 777) ? 5 : -1, 90.0f);
+		rec.add(&frame);
+	}
+	CHECK(rec.eventFrames() == EVENT_FRAMES);
+	for (uint16_t k = 0; k < EVENT_FRAMES; k++) CHECK(rec.eventFrame(k)->seq == 737u + k);
+
+	// Region of interest: a hot pixel outside it does not count
+	MLX90641_EventRecorder roiRec;
+	CHECK(cam.setRoi(1, 0, 0, 4, 4));
+	roiRec.triggerOnMax(60.0f, 1);
+	makeFrame(1, 0, 30.0f, 100, 200.0f);
+	roiRec.add(&frame);
+	CHECK(roiRec.state() == EVENT_ARMED);
+	makeFrame(2, 100, 30.0f, 17, 61.0f);
+	roiRec.add(&frame);
+	CHECK(roiRec.state() != EVENT_ARMED && roiRec.cause == TRIGGER_MAX);
+
+	// Rate of rise: a slow drift (1 °C/s) is fine, 6 °C in 200 ms (30 °C/s) fires
+	MLX90641_EventRecorder rise;
+	rise.triggerOnRise(20.0f);
+	float hot = 40.0f;
+	for (uint32_t k = 1; k <= 50; k++) {
+		hot += 0.2f;
+		makeFrame(k, 200 * k, 30.0f, 60, hot);
+		rise.add(&frame);
+	}
+	CHECK(rise.state() == EVENT_ARMED);
+	makeFrame(51, 200 * 51, 30.0f, 60, hot + 6.0f);
+	rise.add(&frame);
+	CHECK(rise.state() != EVENT_ARMED && rise.cause == TRIGGER_RISE);
+
+	// Pixel count: 5 pixels over 50 °C are not enough, 6 are
+	MLX90641_EventRecorder many;
+	many.triggerOnCount(50.0f, 6);
+	makeFrame(1, 0, 30.0f, 80, 55.0f, 5);
+	many.add(&frame);
+	CHECK(many.state() == EVENT_ARMED);
+	makeFrame(2, 100, 30.0f, 80, 55.0f, 6);
+	many.add(&frame);
+	CHECK(many.state() != EVENT_ARMED && many.cause == TRIGGER_COUNT);
+
+	// Thresholds across the sensor's range count; one the stored frames cannot reach is refused
+	MLX90641_EventRecorder furnace;
+	CHECK(!furnace.triggerOnCount(700.0f, 1) && !furnace.triggerOnCount(-700.0f, 1) && !furnace.triggerOnCount(NAN, 1));
+	CHECK(furnace.triggers == 0);
+	CHECK(furnace.setWindow(1, 0) && furnace.triggerOnCount(350.0f, 2));
+	makeFrame(1, 0, 30.0f, 80, 360.0f, 1);
+	furnace.add(&frame);
+	CHECK(furnace.state() == EVENT_ARMED);
+	makeFrame(2, 100, 30.0f, 80, 360.0f, 2);
+	furnace.add(&frame);
+	CHECK(furnace.state() == EVENT_FROZEN && furnace.cause == TRIGGER_COUNT);
+	CHECK(furnace.eventFrame(furnace.triggerIndex())->T[81] == 360 * EVENT_SCALE);
+
+	// Manual trigger, and NaN / out-of-range values in the compact format
+	MLX90641_EventRecorder manual;
+	CHECK(manual.setWindow(0, 0));
+	manual.trigger();
+	float T[NUM_PIXELS];
+	for (int i = 0; i < NUM_PIXELS; i++) T[i] = 20.0f;
+	T[0] = NAN;
+	T[1] = 700.0f;
+	T[2] = -12.345f;
+	T[4] = 400.0f;
+	cam.computeStats(T, &frame.stats, frame.T_o);
+	manual.add(&frame);
+	CHECK(manual.state() == EVENT_FROZEN && manual.cause == TRIGGER_MANUAL && manual.eventFrames() == 1);
+	e = manual.eventFrame(0);
+	CHECK(e->T[0] == -32768 && e->T[1] == 32767 && e->T[2] == -617 && e->T[3] == 1000 && e->T[4] == 20000);
+
+	// On the sensor: every published frame goes in, the event matches the published frames
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	MLX90641 live;
+	CHECK(live.calibrate());
+	MLX90641_FrameStore frames;
+	live.setFrameStore(&frames);
+	MLX90641_EventRecorder liveRec;
+	CHECK(liveRec.setWindow(3, 2));
+	live.setRecorder(&liveRec);
+	float hottest = 0.0f;
+	for (int k = 0; k < 12; k++) {
+		sim.setScene(-169.0f + 5.0f * k, 4.0f);
+		if (k == 6) {
+			for (int sp = 0; sp < 2; sp++) sim.setPixel(sp, 77, 2000);  // one frame with a hotspot
+		}
+		sim.nextFrame();
+		live.readTempC();
+		if (k == 0) {
+			hottest = live.latestFrame()->stats.max;
+			liveRec.triggerOnMax(hottest + 10.0f);
+		}
+	}
+	CHECK(liveRec.state() == EVENT_FROZEN && liveRec.eventFrames() == 6);
+	e = liveRec.eventFrame(liveRec.triggerIndex());
+	float peak = -1000.0f;
+	for (int i = 0; i < NUM_PIXELS; i++) peak = (e->T[i] > peak) ? e->T[i] : peak;
+	CHECK(peak > (hottest + 10.0f) * EVENT_SCALE && e->T[77] == peak);
+	CHECK(liveRec.eventFrame(0)->seq + 3 == e->seq && liveRec.eventFrame(5)->seq == e->seq + 2);
+	return checkResult("test_events");
+}
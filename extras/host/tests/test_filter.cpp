@@ -0,0 +1,135 @@
+// test_filter.cpp - temporal filters: noise reduction, spike rejection, step response and the pipeline hook
+#include "test_util.h"
+
+// Deterministic noise: uniform in [-1, 1)
+static uint32_t seed = 12345;
+static float noise() {
+	seed = seed * 1664525u + 1013904223u;
+	return (float)(seed >> 8) / 8388608.0f - 1.0f;
+}
+
+// Standard deviation of filtered frames around truth, after a settling period
+static float residual(MLX90641_Filter &f, float truth, float amplitude, int frames) {
+	float T[NUM_PIXELS];
+	double sum2 = 0.0;
+	int n = 0;
+	for (int k = 0; k < frames; k++) {
+		for (int i = 0; i < NUM_PIXELS; i++) T[i] = truth + amplitude * noise();
+		f.apply(T);
+		if (k < 20) continue;
+		for (int i = 0; i < NUM_PIXELS; i++) sum2 += (T[i] - truth) * (T[i] - truth);
+		n += NUM_PIXELS;
+	}
+	return (float)sqrt(sum2 / n);
+}
+
+int main() {
+	const float raw = 1.0f / sqrtf(3.0f);  // std of uniform noise with amplitude 1
+
+	// Parameter checks
+	MLX90641_Filter f;
+	CHECK(f.mode() == FILTER_IIR && f.alpha() == FILTER_ALPHA && f.window() == 3);
+	CHECK(!f.setIIR(0.0f) && !f.setIIR(1.5f) && !f.setMedian(4) && !f.setKalman(0.01f, 0.0f));
+
+	// Noise floor: every filter cuts it substantially
+	CHECK(f.setIIR(0.25f));
+	float iir = residual(f, 30.0f, 1.0f, 200);
+	CHECK_NEAR(iir, raw * sqrtf(0.25f / 1.75f), 0.02);  // alpha / (2 - alpha) of the variance
+	CHECK(f.setMedian(5));
+	float med = residual(f, 30.0f, 1.0f, 200);
+	CHECK(med < 0.75f * raw);
+	CHECK(f.setKalman(0.0001f, 1.0f / 3.0f, 4.0f));
+	float kal = residual(f, 30.0f, 1.0f, 200);
+	CHECK(kal < 0.35f * raw);
+	printf("noise std: raw %.3f, IIR %.3f, median %.3f, Kalman %.3f\n", raw, iir, med, kal);
+
+	// The first frame after reset() passes through unchanged, a steady scene stays unchanged
+	float T[NUM_PIXELS], in[NUM_PIXELS];
+	for (int i = 0; i < NUM_PIXELS; i++) in[i] = T[i] = 20.0f + 0.1f * i;
+	const uint8_t modes[3] = { FILTER_IIR, FILTER_MEDIAN, FILTER_KALMAN };
+	for (int m = 0; m < 3; m++) {
+		MLX90641_Filter g(modes[m]);
+		for (int k = 0; k < 5; k++) {
+			g.apply(T);
+			for (int i = 0; i < NUM_PIXELS; i++) CHECK(T[i] == in[i]);
+		}
+	}
+
+	// Median: a one-frame spike vanishes (window 3), two in five frames too (window 5)
+	MLX90641_Filter m3;
+	CHECK(m3.setMedian(3));
+	for (int k = 0; k < 6; k++) {
+		for (int i = 0; i < NUM_PIXELS; i++) T[i] = (k == 3) ? 500.0f : 25.0f;
+		m3.apply(T);
+		CHECK(T[7] == 25.0f);
+	}
+	MLX90641_Filter m5;
+	CHECK(m5.setMedian(5));
+	for (int k = 0; k < 10; k++) {
+		for (int i = 0; i < NUM_PIXELS; i++) T[i] = (k == 4 || k == 6) ? -40.0f : 25.0f;
+		m5.apply(T);
+		CHECK(T[100] == 25.0f);
+	}
+
+	// Kalman: a step far beyond the noise is taken at once, a small one is smoothed
+	MLX90641_Filter kf;
+	CHECK(kf.setKalman(0.001f, 0.25f, 4.0f));
+	for (int k = 0; k < 30; k++) {
+		for (int i = 0; i < NUM_PIXELS; i++) T[i] = 25.0f;
+		kf.apply(T);
+	}
+	for (int i = 0; i < NUM_PIXELS; i++) T[i] = (i == 9) ? 60.0f : 25.5f;
+	kf.apply(T);
+	CHECK(T[9] == 60.0f);
+	CHECK(T[10] > 25.0f && T[10] < 25.2f);
+
+	// IIR: a step settles to within 1% in log(0.01) / log(1 - alpha) frames
+	MLX90641_Filter iirf;
+	CHECK(iirf.setIIR(0.5f));
+	for (int i = 0; i < NUM_PIXELS; i++) T[i] = 0.0f;
+	iirf.apply(T);
+	int frames = 0;
+	do {
+		for (int i = 0; i < NUM_PIXELS; i++) T[i] = 100.0f;
+		iirf.apply(T);
+		frames++;
+	} while (T[0] < 99.0f && frames < 50);
+	CHECK(frames == 7);
+
+	// In the pipeline: setFilter() runs after the fill-in, the published frame is the filtered one
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	Wire.setClock(400000);
+	MLX90641 cam, plain;
+	CHECK(cam.calibrate());
+	CHECK(plain.calibrate());
+	MLX90641_Filter camFilter;
+	CHECK(camFilter.setIIR(0.5f));
+	cam.setFilter(&camFilter);
+	MLX90641_FrameStore published;
+	cam.setFrameStore(&published);
+	cam.badPixels[20] = true;
+	plain.badPixels[20] = true;
+	float prev[NUM_PIXELS];
+	for (int k = 0; k < 4; k++) {
+		sim.setScene(-169.0f + 50.0f * k, 4.0f);
+		sim.nextFrame();
+		cam.readTempC();
+		plain.readTempC();
+		const MLX90641_Frame *fr = cam.latestFrame();
+		for (int i = 0; i < NUM_PIXELS; i++) {
+			float expect = (k == 0) ? plain.T_o[i] : prev[i] + 0.5f * (plain.T_o[i] - prev[i]);
+			CHECK_NEAR(cam.T_o[i], expect, 1e-4);
+			CHECK(fr->T_o[i] == cam.T_o[i]);
+			prev[i] = cam.T_o[i];
+		}
+	}
+	cam.setFilter(NULL);
+	sim.nextFrame();
+	cam.readTempC();
+	plain.readTempC();
+	for (int i = 0; i < NUM_PIXELS; i++) CHECK(cam.T_o[i] == plain.T_o[i]);
+	return checkResult("test_filter");
+}
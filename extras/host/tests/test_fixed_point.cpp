@@ -0,0 +1,28 @@
+// test_fixed_point.cpp - scaled-integer kernel (FIXED_POINT_MATH) against a double-precision reference
+#include "test_util.h"
+
+int main() {
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	Wire.attach(&sim);
+	Wire.setClock(400000);
+	MLX90641 cam;
+	CHECK(cam.calibrate());
+
+	double worst = 0.0;
+	for (int base = -2500; base <= 3700; base += 75) {  // about -60..+155°C
+		sim.setScene((float)base, 20.0f);
+		sim.nextFrame();
+		cam.readTempC();
+		for (int i = 0; i < NUM_PIXELS; i++) {
+			double ref = referenceTo(cam, i), d = fabs(cam.T_o[i] - ref);
+			bool corner = false;  // the datasheet ranges step by up to 0.05°C at a corner temperature: either side is right
+			for (int k = 1; k < 8; k++) corner |= fabs(ref - cam.CT[k]) < 0.05;
+			if (!corner && d > worst) worst = d;
+			CHECK(!cam.badPixels[i]);
+		}
+	}
+	printf("Fixed-point kernel vs double reference: %.4f degC worst case\n", worst);
+	CHECK(worst < 0.01);  // documented tolerance
+	return checkResult("test_fixed_point");
+}
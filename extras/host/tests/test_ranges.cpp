@@ -0,0 +1,66 @@
+// test_ranges.cpp - all eight temperature ranges (11.2.2.9.1): pixel 95 driven from -30 to 700°C, against the datasheet
+// formulas evaluated with the worked example's constants (11.2), not with the values the library parsed.
+// Built once per kernel: float (test_ranges), SIMD_MATH (test_ranges_simd) and FIXED_POINT_MATH (test_ranges_fixed).
+#include "test_util.h"
+
+// Worked example, pixel 95 (TGC = 0, so the CP does not enter)
+static const double Kgain = 1.02445038, Ta = 42.02, Vdd = 3.25599, Emissivity = 0.949218;
+static const double Ta_r = 9899175739.92, alpha_reference = 3.45520675182343e-7, KsTa = -0.002197265625;
+static const double pix_OS_ref[2] = { -673.0, -671.0 }, Kta = 0.003101349, Kv = 0.3251953, KsTo = -0.000699997;
+static const int CT[8] = { -40, -20, 0, 80, 120, 200, 400, 600 };
+static const double Alpha_cr[8] = { 1.028599, 1.014198721, 1.0, 0.94400024, 0.917568347, 0.86618474, 0.744919396, 0.640631128 };
+
+// T_o (°C) of a raw word of pixel 95 on subpage sp, for a sensitivity word w: 11.2.2.5 - 11.2.2.9.1 in double precision
+static double datasheetTo(int16_t raw, int sp, uint16_t w) {
+	double pix_OS = raw * Kgain - pix_OS_ref[sp] * (1.0 + Kta * (Ta - 25.0)) * (1.0 + Kv * (Vdd - 3.3));
+	double V_IR = pix_OS / Emissivity;
+	double alpha_comp = alpha_reference * w / 2047.0 * (1.0 + KsTa * (Ta - 25.0));
+	double S_x = KsTo * pow(pow(alpha_comp, 3.0) * V_IR + pow(alpha_comp, 4.0) * Ta_r, 0.25);
+	double T = pow(V_IR / (alpha_comp * (1.0 - KsTo * 273.15) + S_x) + Ta_r, 0.25) - 273.15;
+	int r = 0;
+	for (int k = 1; k < 8; k++) r += (T >= CT[k]);
+	if (r != 2) T = pow(V_IR / (alpha_comp * Alpha_cr[r] * (1.0 + KsTo * (T - CT[r]))) + Ta_r, 0.25) - 273.15;
+	return T;
+}
+
+// Serve the raw word closest to T on both subpages, check both results against the datasheet value of that word
+static void checkTemperature(SimMLX90641 &sim, MLX90641 &cam, double T, uint16_t w) {
+	for (int k = 0; k < 2; k++) {
+		int sp = (sim.status() & 1) ^ 1;  // subpage of the next frame
+		int32_t lo = -32768, hi = 32767;  // T_o rises with the raw word: bisection
+		while (hi - lo > 1) {
+			int32_t mid = (lo + hi) / 2;
+			if (!(datasheetTo((int16_t)mid, sp, w) >= T)) lo = mid;  // NaN: below absolute zero
+			else hi = mid;
+		}
+		double expected = datasheetTo((int16_t)hi, sp, w);
+		CHECK(hi < 32767 && fabs(expected - T) < 0.05);  // T is within reach of the raw word, at a fine enough step
+		sim.setPixel(sp, 95, (int16_t)hi);
+		sim.nextFrame();
+		cam.readTempC();
+		CHECK(cam.subpage == sp);
+		CHECK_NEAR(cam.T_o[95], expected, 0.01);
+	}
+}
+
+int main() {
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	Wire.setClock(400000);
+
+	// The example's sensitivity: one temperature in each of ranges 1..6 and both sides of each corner
+	MLX90641 cam;
+	CHECK(cam.calibrate());
+	const double T[11] = { -30.0, -10.0, 40.0, 100.0, 150.0, 160.0, 250.0, 300.0, 79.5, 80.5, 199.5 };
+	for (int k = 0; k < 11; k++) checkTemperature(sim, cam, T[k], 2047);
+
+	// A pixel with a sixth of that sensitivity keeps 400..700°C inside the int16 raw word: ranges 6..8
+	sim.setEepromWord(0x2500 + 95, 300);
+	MLX90641 hot;
+	CHECK(hot.calibrate());
+	const double T_hot[7] = { 300.0, 350.0, 399.0, 401.0, 500.0, 620.0, 700.0 };
+	for (int k = 0; k < 7; k++) checkTemperature(sim, hot, T_hot[k], 300);
+	return checkResult("test_ranges");
+}
@@ -0,0 +1,91 @@
+// test_raw.cpp - raw frame capture, calibration export/import and compensation away from the sensor
+#include "test_util.h"
+
+int main() {
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	Wire.setClock(400000);
+	MLX90641 cam;
+	CHECK(cam.calibrate());
+	cam.badPixels[60] = DEFECT_MANUAL;
+
+	// Export: everything the host needs, checked on import
+	static MLX90641_CalibrationExport exp;
+	CHECK(cam.exportCalibration(&exp));
+	static MLX90641_CalibrationExport bad;
+	bad = exp;
+	bad.eepromHeader[0x33] ^= 0x0400;  // another ADC resolution: the header no longer matches the calibration
+	MLX90641 host;
+	MLX90641_FrameStore hostFrames;
+	host.setFrameStore(&hostFrames);
+	CHECK(!host.importCalibration(&bad));
+	bad = exp;
+	bad.controlReg ^= 1;
+	CHECK(!host.importCalibration(&bad));
+
+	// Import reads nothing from the bus
+	unsigned long before = Wire.transactions;
+	CHECK(host.importCalibration(&exp));
+	CHECK(Wire.transactions == before);
+	CHECK(host.badPixels[60] == DEFECT_MANUAL);
+
+	// Record a few raw frames, and compensate the same frames on the sensor side
+	const int frames = 6;
+	static MLX90641_RawFrame rec[frames];
+	static float live[frames][NUM_PIXELS];
+	MLX90641 reader;  // records only: no calibration needed
+	for (int k = 0; k < frames; k++) {
+		sim.setScene(-169.0f + 15.0f * k, 4.0f);
+		sim.nextFrame();
+		CHECK(reader.readRaw(&rec[k]));
+		CHECK(rec[k].seq == (uint32_t)k + 1 && (rec[k].status & 1) == (sim.status() & 1));
+		CHECK(rec[k].words[0x0500 - FRAME_ADDR] == sim.ramWord(0x0500));
+		cam.readTempC();
+		for (int i = 0; i < NUM_PIXELS; i++) live[k][i] = cam.T_o[i];
+	}
+
+	// The host gives bit-identical results, without a single bus transaction
+	before = Wire.transactions;
+	for (int k = 0; k < frames; k++) {
+		host.compensateRaw(&rec[k]);
+		for (int i = 0; i < NUM_PIXELS; i++) CHECK(host.T_o[i] == live[k][i]);
+		CHECK(host.latestFrame()->seq == (uint32_t)k + 1);
+	}
+	CHECK(Wire.transactions == before);
+
+	// Re-running the math with another emissivity changes the result the way the sensor would
+	MLX90641 again;
+	CHECK(again.importCalibration(&exp));
+	again.Emissivity = 0.8f;
+	cam.Emissivity = 0.8f;
+	again.compensateRaw(&rec[frames - 1]);
+	cam.readTempC();
+	for (int i = 0; i < NUM_PIXELS; i++) CHECK(again.T_o[i] == cam.T_o[i]);
+	CHECK(again.T_o[95] != host.T_o[95]);
+
+	// Raw mode: poll() stops after the read, the callback still runs and T_o[] is left alone
+	MLX90641 field;
+	CHECK(field.calibrate());
+	MLX90641_RawFrame raw;
+	field.setRawMode(&raw);
+	field.start();
+	sim.setScene(-100.0f, 2.0f);
+	sim.nextFrame();
+	int steps = 0;
+	while (!field.poll() && steps < 1000) {
+		hostAdvanceMicros(1000);
+		steps++;
+	}
+	CHECK(field.frameCount == 1 && raw.seq == 1);
+	CHECK(field.T_o[0] == 0.0f && field.latestFrame() == NULL);
+	CHECK((sim.status() & (1 << 3)) == 0);  // new data bit cleared
+	for (int i = 0; i < FRAME_WORDS; i++) CHECK(raw.words[i] == sim.ramWord(FRAME_ADDR + i));
+	field.stop();
+	cam.Emissivity = host.Emissivity;
+	cam.readTempC();
+	host.compensateRaw(&raw);
+	for (int i = 0; i < NUM_PIXELS; i++) CHECK(host.T_o[i] == cam.T_o[i]);
+	return checkResult("test_raw");
+}
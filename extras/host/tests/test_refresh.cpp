@@ -0,0 +1,94 @@
+// test_refresh.cpp - Kgain/Vdd/Ta refresh policy: cached constants, no register reads per frame, every N frames and on drift
+#include "test_util.h"
+
+// One frame on both sensors, from the same snapshot
+static void frame(SimMLX90641 &sim, MLX90641 &a, MLX90641 &b) {
+	sim.nextFrame();
+	a.readTempC();
+	b.readTempC();
+}
+
+int main() {
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	Wire.setClock(400000);
+
+	MLX90641 every, policy;
+	CHECK(every.calibrate());
+	CHECK(policy.calibrate());
+	CHECK(!policy.setRefreshPolicy(REFRESH_ON_DRIFT + 1));
+	CHECK(!policy.setRefreshPolicy(REFRESH_EVERY_N, 0));
+
+	// The frame costs the status read and the RAM burst only: no 0x800D or housekeeping reads
+	sim.nextFrame();
+	every.readTempC();
+	sim.nextFrame();
+	unsigned long t0 = Wire.transactions;
+	every.readAddr_unsigned(STATUS_ADDR);
+	every.readFrame();
+	unsigned long frameOnly = Wire.transactions - t0;
+	sim.nextFrame();
+	t0 = Wire.transactions;
+	every.readTempC();
+	CHECK(Wire.transactions - t0 == frameOnly);
+
+	// The cached constants give the datasheet values (11.2.2.2, 11.2.2.4)
+	CHECK_NEAR(every.Vdd, 3.25599, 1e-4);
+	CHECK_NEAR(every.Kgain, 1.02445038, 1e-6);
+
+	// Every N frames: identical results while the housekeeping words are steady
+	CHECK(policy.setRefreshPolicy(REFRESH_EVERY_N, 4));
+	uint32_t r0 = policy.refreshCount;
+	for (int k = 0; k < 8; k++) {
+		frame(sim, every, policy);
+		for (int i = 0; i < NUM_PIXELS; i++) CHECK(policy.T_o[i] == every.T_o[i]);
+	}
+	CHECK(policy.refreshCount - r0 == 2);  // the first frame after setRefreshPolicy(), then every 4th
+
+	// A Ta step shows up within N frames, and the CP pixel is still followed on every frame
+	sim.setRamWord(0x05A0, sim.ramWord(0x05A0) + 40);  // V_PTAT
+	int lag = 0;
+	do {
+		frame(sim, every, policy);
+		lag++;
+	} while (lag < 4 && policy.Ta != every.Ta);
+	CHECK(policy.Ta == every.Ta);
+	sim.setRamWord(0x0588, sim.ramWord(0x0588) + 3);  // CP
+	frame(sim, every, policy);
+	CHECK(policy.Ta == every.Ta);
+	for (int i = 0; i < NUM_PIXELS; i++) CHECK(policy.T_o[i] == every.T_o[i]);
+
+	// On drift: small changes keep the last values, a step past the threshold refreshes on the same frame
+	CHECK(policy.setRefreshPolicy(REFRESH_ON_DRIFT, 1, 0.5f, 0.01f, 0.001f));
+	frame(sim, every, policy);
+	r0 = policy.refreshCount;
+	float Ta0 = policy.Ta;
+	sim.setRamWord(0x05A0, sim.ramWord(0x05A0) + 1);
+	frame(sim, every, policy);
+	CHECK(policy.refreshCount == r0 && policy.Ta == Ta0 && every.Ta != Ta0);
+	CHECK_NEAR(policy.Ta, every.Ta, 0.5);
+	sim.setRamWord(0x05A0, sim.ramWord(0x05A0) + 200);
+	frame(sim, every, policy);
+	CHECK(policy.refreshCount == r0 + 1 && policy.Ta == every.Ta);
+	sim.setRamWord(0x05AA, sim.ramWord(0x05AA) + 100);  // Vdd
+	frame(sim, every, policy);
+	CHECK(policy.refreshCount == r0 + 2 && policy.Vdd == every.Vdd);
+	sim.setRamWord(0x058A, sim.ramWord(0x058A) + 50);   // gain
+	frame(sim, every, policy);
+	CHECK(policy.refreshCount == r0 + 3 && policy.Kgain == every.Kgain);
+	for (int i = 0; i < NUM_PIXELS; i++) CHECK(policy.T_o[i] == every.T_o[i]);
+
+	// setRefreshRate() keeps the cached control word: the resolution correction is unchanged
+	CHECK(every.setRefreshRate(0x05));
+	t0 = Wire.transactions;
+	float Vdd = every.readVdd();
+	CHECK(Wire.transactions == t0 && Vdd == every.Vdd);
+
+	// A new EEPROM dump replaces the cached constants
+	sim.setEepromWord(0x2426, sim.eepromWord(0x2426) ^ 0x0001);  // Vdd_25
+	CHECK(every.calibrate());
+	CHECK(every.readVdd() != Vdd);
+	return checkResult("test_refresh");
+}
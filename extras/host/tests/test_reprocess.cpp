@@ -0,0 +1,129 @@
+// test_reprocess.cpp - offline reprocessing of a recorded raw session: identical to the sensor, on any number of threads
+#include <vector>
+#include "test_util.h"
+#include "raw_session.h"
+
+static const size_t frames = 80;  // more than a defect statistics window, and than the frames per thread below
+
+// Record a session (export + settings + raw frames) while cam compensates the same frames with its own settings.
+// Pixel 150 is stuck on both subpages.
+static void record(SimMLX90641 &sim, MLX90641 &cam, std::vector<uint8_t> &file, std::vector<float> &liveTa, std::vector<float> &live) {
+	const size_t header = sizeof(MLX90641_CalibrationExport) + sizeof(MLX90641_PipelineSettings);
+	file.assign(header + frames * sizeof(MLX90641_RawFrame) + 100, 0);  // + a partial frame
+	MLX90641_RawFrame *raw = (MLX90641_RawFrame *)(file.data() + header);
+	CHECK(cam.exportCalibration((MLX90641_CalibrationExport *)file.data()));
+	cam.exportSettings((MLX90641_PipelineSettings *)(file.data() + sizeof(MLX90641_CalibrationExport)));
+	cam.beginRecording();
+	MLX90641 recorder;  // records only: no calibration needed
+	liveTa.resize(frames);
+	live.resize(frames * NUM_PIXELS);
+	for (size_t k = 0; k < frames; k++) {
+		sim.setScene(-169.0f + 9.0f * (k % 7), 4.0f);
+		for (int sp = 0; sp < 2; sp++) sim.setPixel(sp, 150, -150);
+		sim.nextFrame();
+		CHECK(recorder.readRaw(&raw[k]));
+		cam.readTempC();
+		liveTa[k] = cam.Ta;
+		for (int i = 0; i < NUM_PIXELS; i++) live[k * NUM_PIXELS + i] = cam.T_o[i];
+	}
+}
+
+int main() {
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+
+	// A chess merge of the subpages: every frame needs the last result of the other subpage
+	MLX90641 cam;
+	CHECK(cam.calibrate());
+	cam.badPixels[33] = DEFECT_MANUAL;
+	cam.calSlope = 1.05f;
+	CHECK(cam.setSubpageMode(SUBPAGE_CHESS));
+	std::vector<uint8_t> file;
+	std::vector<float> liveTa, live;
+	record(sim, cam, file, liveTa, live);
+
+	RawSession s;
+	CHECK(!openSession(file.data(), sizeof(MLX90641_CalibrationExport) + sizeof(MLX90641_PipelineSettings) - 1, &s));
+	CHECK(openSession(file.data(), file.size(), &s));
+	CHECK(s.numFrames == frames);
+	CHECK(s.settings->subpageMode == SUBPAGE_CHESS && s.settings->calSlope == 1.05f && s.settings->defectWindow == 0);
+
+	// Same result as the sensor, bit for bit, whatever the number of threads
+	const unsigned threads[3] = { 1, 4, 64 };
+	for (int t = 0; t < 3; t++) {
+		ReprocessOptions o;
+		o.threads = threads[t];
+		std::vector<float> Ta(frames), T(frames * NUM_PIXELS);
+		CHECK(reprocessSession(s, o, Ta.data(), T.data()) == threads[t]);
+		CHECK(Ta == liveTa);
+		CHECK(T == live);
+	}
+
+	// New settings: emissivity, post-hoc calibration, an extra bad pixel and no merge, as the sensor would apply them
+	ReprocessOptions o;
+	o.threads = 3;
+	o.emissivity = 0.9f;
+	o.slope = 1.1f;
+	o.intercept = -2.0f;
+	o.badPixels[100] = 1;
+	o.subpageMode = SUBPAGE_LATEST;
+	std::vector<float> Ta(frames), T(frames * NUM_PIXELS);
+	CHECK(reprocessSession(s, o, Ta.data(), T.data()) == 3);
+	MLX90641 again;
+	CHECK(again.importCalibration(s.cal));
+	CHECK(again.importSettings(s.settings));
+	again.Emissivity = 0.9f;
+	again.calSlope = 1.1f;
+	again.calIntercept = -2.0f;
+	again.badPixels[100] |= DEFECT_MANUAL;
+	CHECK(again.setSubpageMode(SUBPAGE_LATEST));
+	for (size_t k = 0; k < frames; k++) {
+		again.compensateRaw(&s.frames[k]);
+		for (int i = 0; i < NUM_PIXELS; i++) CHECK(T[k * NUM_PIXELS + i] == again.T_o[i]);
+	}
+	CHECK(T[95] != live[95]);
+
+	// Leave the session behind for the raw_reprocess smoke test
+	FILE *f = fopen("session.raw", "wb");
+	CHECK(f != NULL && fwrite(file.data(), 1, file.size(), f) == file.size());
+	if (f != NULL) fclose(f);
+
+	// Defect statistics, a filter, a refresh every 4 frames and the average of the subpages: state carries across
+	// the whole session, so it runs on one thread, and still matches the sensor bit for bit
+	MLX90641 busy;
+	MLX90641_Filter filter;
+	CHECK(busy.calibrate());
+	CHECK(busy.setDefectWindow(32));
+	CHECK(filter.setIIR(0.5f));
+	busy.setFilter(&filter);
+	CHECK(busy.setRefreshPolicy(REFRESH_EVERY_N, 4));
+	CHECK(busy.setSubpageMode(SUBPAGE_AVERAGE));
+	for (int k = 0; k < 5; k++) {  // history from before the recording, which beginRecording() forgets
+		sim.setScene(40.0f * k, 0.0f);
+		sim.nextFrame();
+		busy.readTempC();
+	}
+	record(sim, busy, file, liveTa, live);
+	CHECK(busy.badPixels[150] & DEFECT_STUCK);
+	CHECK(openSession(file.data(), file.size(), &s));
+	CHECK(s.settings->filterMode == FILTER_IIR && s.settings->filterAlpha == 0.5f && s.settings->refreshEveryN == 4);
+	o = ReprocessOptions();
+	o.threads = 8;
+	CHECK(reprocessSession(s, o, Ta.data(), T.data()) == 1);
+	CHECK(Ta == liveTa);
+	CHECK(T == live);
+	MLX90641 noFilter;
+	CHECK(!noFilter.importSettings(s.settings));
+
+	// Damaged settings and a damaged calibration are refused
+	MLX90641_PipelineSettings *settings = (MLX90641_PipelineSettings *)(file.data() + sizeof(MLX90641_CalibrationExport));
+	settings->defectWindow = 4;
+	CHECK(!openSession(file.data(), file.size(), &s));
+	settings->defectWindow = 32;
+	CHECK(openSession(file.data(), file.size(), &s));
+	((MLX90641_CalibrationExport *)file.data())->cal.Emissivity = 0.5f;
+	CHECK(!openSession(file.data(), file.size(), &s));
+	return checkResult("test_reprocess");
+}
@@ -0,0 +1,121 @@
+// test_stats.cpp - frame statistics: min/max with locations, mean, histogram, ROI aggregates and the published frame
+#include "test_util.h"
+
+// Brute-force statistics of the pixels of T selected by in[] (NULL: all), NaN left out
+static void reference(const float *T, const uint8_t *in, int &n, float &lo, float &hi, double &mean, int &loPix, int &hiPix) {
+	n = 0;
+	lo = INFINITY;
+	hi = -INFINITY;
+	mean = 0.0;
+	loPix = hiPix = 0;
+	for (int i = 0; i < NUM_PIXELS; i++) {
+		if ((in && !in[i]) || isnan(T[i])) continue;
+		n++;
+		mean += T[i];
+		if (T[i] < lo) { lo = T[i]; loPix = i; }
+		if (T[i] > hi) { hi = T[i]; hiPix = i; }
+	}
+	if (n) mean /= n;
+}
+
+static void checkRoi(const MLX90641_RoiStats &s, const float *T, const uint8_t *in) {
+	int n, loPix, hiPix;
+	float lo, hi;
+	double mean;
+	reference(T, in, n, lo, hi, mean, loPix, hiPix);
+	CHECK(s.pixels == n);
+	CHECK(s.min == lo && s.max == hi && s.minPixel == loPix && s.maxPixel == hiPix);
+	CHECK_NEAR(s.mean, mean, 1e-3);
+}
+
+int main() {
+	MLX90641 cam;
+	float T[NUM_PIXELS];
+	for (int i = 0; i < NUM_PIXELS; i++) T[i] = 20.0f + 0.05f * ((i * 7919) % 97);
+	T[77] = 95.5f;   // hotspot
+	T[150] = -5.0f;  // cold spot
+	T[10] = NAN;     // left out everywhere
+
+	// Global min/max with their pixel, mean, histogram over the default range
+	MLX90641_Stats s;
+	cam.computeStats(T, &s);
+	int n, loPix, hiPix;
+	float lo, hi;
+	double mean;
+	reference(T, NULL, n, lo, hi, mean, loPix, hiPix);
+	CHECK(s.pixels == 191 && s.maxPixel == 77 && s.minPixel == 150);
+	CHECK(s.min == lo && s.max == hi);
+	CHECK_NEAR(s.mean, mean, 1e-3);
+	CHECK(s.histMin == (float)STATS_HIST_MIN && s.histMax == (float)STATS_HIST_MAX);
+	int total = 0, bin[STATS_BINS] = { 0 };
+	const float width = (float)(STATS_HIST_MAX - STATS_HIST_MIN) / STATS_BINS;
+	for (int i = 0; i < NUM_PIXELS; i++) {
+		if (isnan(T[i])) continue;
+		int b = (int)floorf((T[i] - (float)STATS_HIST_MIN) / width);
+		bin[b < 0 ? 0 : b >= STATS_BINS ? STATS_BINS - 1 : b]++;
+	}
+	for (int b = 0; b < STATS_BINS; b++) {
+		CHECK(s.histogram[b] == bin[b]);
+		total += s.histogram[b];
+	}
+	CHECK(total == 191);
+
+	// A narrower range: everything outside lands in the first or last bin
+	CHECK(!cam.setHistogram(30.0f, 30.0f));
+	CHECK(cam.setHistogram(20.0f, 24.0f));
+	cam.computeStats(T, &s);
+	CHECK(s.histogram[0] >= 1 && s.histogram[STATS_BINS - 1] >= 1);  // -5 and 95.5
+	total = 0;
+	for (int b = 0; b < STATS_BINS; b++) total += s.histogram[b];
+	CHECK(total == 191);
+
+	// Regions of interest: a rectangle, a mask, an unused slot
+	CHECK(!cam.setRoi(MAX_ROIS, 0, 0, 1, 1) && !cam.setRoi(0, 12, 0, 5, 1) && !cam.setRoi(0, 0, 10, 1, 3) && !cam.setRoi(0, 0, 0, 0, 1));
+	CHECK(cam.setRoi(0, 3, 2, 4, 3));  // columns 3..6, rows 2..4
+	uint8_t rect[NUM_PIXELS] = { 0 }, mask[NUM_PIXELS] = { 0 };
+	for (int y = 2; y < 5; y++) for (int x = 3; x < 7; x++) rect[y * 16 + x] = 1;
+	for (int i = 0; i < NUM_PIXELS; i += 5) mask[i] = 1;  // every fifth pixel, includes 10 (NaN) and 150
+	CHECK(cam.setRoiMask(1, mask));
+	cam.computeStats(T, &s);
+	checkRoi(s.roi[0], T, rect);
+	CHECK(s.roi[0].pixels == 12);
+	checkRoi(s.roi[1], T, mask);
+	CHECK(s.roi[1].minPixel == 150);
+	CHECK(s.roi[2].pixels == 0 && isnan(s.roi[2].mean));
+	cam.clearRoi(1);
+	cam.computeStats(T, &s);
+	CHECK(s.roi[1].pixels == 0 && isnan(s.roi[1].max));
+
+	// An all-NaN frame has no statistics, but the histogram stays consistent
+	float blank[NUM_PIXELS];
+	for (int i = 0; i < NUM_PIXELS; i++) blank[i] = NAN;
+	cam.computeStats(blank, &s);
+	CHECK(s.pixels == 0 && isnan(s.min) && isnan(s.mean) && s.roi[0].pixels == 0);
+	for (int b = 0; b < STATS_BINS; b++) CHECK(s.histogram[b] == 0);
+
+	// Published with every frame: the statistics describe exactly the pixels of that frame
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	MLX90641 live;
+	CHECK(live.calibrate());
+	MLX90641_FrameStore frames;
+	live.setFrameStore(&frames);
+	CHECK(live.setRoi(0, 0, 0, 8, 12));
+	for (int k = 0; k < 3; k++) {
+		sim.setScene(-169.0f + 20.0f * k, 4.0f);
+		for (int sp = 0; sp < 2; sp++) sim.setPixel(sp, 77, 2000);  // hotspot
+		sim.nextFrame();
+		live.readTempC();
+		const MLX90641_Frame *f = live.latestFrame();
+		for (int i = 0; i < NUM_PIXELS; i++) CHECK(f->T_o[i] == live.T_o[i]);
+		reference(f->T_o, NULL, n, lo, hi, mean, loPix, hiPix);
+		CHECK(f->stats.pixels == n && f->stats.max == hi && f->stats.maxPixel == hiPix && f->stats.minPixel == loPix);
+		CHECK_NEAR(f->stats.mean, mean, 1e-3);
+		uint8_t left[NUM_PIXELS];
+		for (int i = 0; i < NUM_PIXELS; i++) left[i] = (i % 16) < 8;
+		checkRoi(f->stats.roi[0], f->T_o, left);
+	}
+	return checkResult("test_stats");
+}
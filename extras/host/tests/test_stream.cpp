@@ -0,0 +1,139 @@
+// test_stream.cpp - binary frame stream: round trips, delta escapes, keyframes, resync after corruption and gaps
+#include "test_util.h"
+#include <vector>
+
+// Smooth scene that drifts a little each frame, with a hot spot that jumps around (escapes)
+static void makeFrame(int k, float *T) {
+	for (int i = 0; i < STREAM_PIXELS; i++) T[i] = 22.0f + 0.05f * (i % 16) + 0.3f * (i / 16) + 0.07f * k;
+	T[(k * 37) % STREAM_PIXELS] = 150.0f + k;
+}
+
+// Feed bytes to the decoder, return the number of frames it reports
+static int feed(MLX90641_StreamDecoder &dec, const uint8_t *p, size_t n) {
+	int frames = 0;
+	for (size_t k = 0; k < n; k++) frames += dec.push(p[k]);
+	return frames;
+}
+
+int main() {
+	const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+	CHECK(MLX90641_crc16(check, sizeof(check)) == 0x29B1);
+
+	// Round trip: absolute first, then deltas, keyframe every STREAM_KEYFRAME frames
+	MLX90641_StreamEncoder enc;
+	MLX90641_StreamDecoder dec;
+	uint8_t buf[STREAM_MAX_BYTES];
+	float T[STREAM_PIXELS];
+	std::vector<uint8_t> stream;
+	std::vector<size_t> starts;
+	int absolute = 0;
+	for (int k = 0; k < 80; k++) {
+		makeFrame(k, T);
+		size_t n = enc.encode(T, 25.5f + 0.01f * k, 1000 + k, 100 * k, k & 1, STREAM_DELTA, buf);
+		CHECK(n <= STREAM_MAX_BYTES);
+		if (buf[2] & 0x0F) {
+			CHECK(n < STREAM_HEADER_BYTES + STREAM_PIXELS + 3 * 2 + 1);  // one byte per pixel, plus two escaped hot spot pixels
+		} else {
+			CHECK(n == STREAM_HEADER_BYTES + 2 * STREAM_PIXELS);
+			absolute++;
+		}
+		starts.push_back(stream.size());
+		stream.insert(stream.end(), buf, buf + n);
+		CHECK(feed(dec, buf, n) == 1);
+		CHECK(dec.header.seq == (uint32_t)(1000 + k));
+		CHECK(dec.header.timestamp == (uint32_t)(100 * k));
+		CHECK(dec.header.subpage == (k & 1));
+		CHECK_NEAR(dec.ambient(), 25.5 + 0.01 * k, 0.005);
+		for (int i = 0; i < STREAM_PIXELS; i++) CHECK(dec.pixels[i] == enc.toUnits(T[i]));
+	}
+	CHECK(absolute == (80 + STREAM_KEYFRAME - 1) / STREAM_KEYFRAME);
+	CHECK(dec.frames == 80 && dec.crcErrors == 0 && dec.missingReference == 0 && dec.skippedBytes == 0);
+
+	// Out-of-range values are clamped, NaN has its own code
+	CHECK(enc.toUnits(400.0f) == 32767);
+	CHECK(enc.toUnits(-400.0f) == -32767);
+	CHECK(enc.toUnits(NAN) == -32768);
+	CHECK(enc.toUnits(-0.004f) == 0 && enc.toUnits(12.345f) == 1235);
+
+	// A corrupted delta frame: it is dropped, the following deltas wait for the next keyframe, then decoding resumes
+	std::vector<uint8_t> bad = stream;
+	bad[starts[5] + STREAM_HEADER_BYTES + 10] ^= 0x01;
+	MLX90641_StreamDecoder dec2;
+	CHECK(feed(dec2, bad.data(), bad.size()) == 80 - (STREAM_KEYFRAME - 5));  // frames 5..31 lost
+	CHECK(dec2.crcErrors >= 1);
+	CHECK(dec2.missingReference == STREAM_KEYFRAME - 6);
+	CHECK(dec2.header.seq == 1079);
+	for (int i = 0; i < STREAM_PIXELS; i++) CHECK(dec2.pixels[i] == dec.pixels[i]);
+
+	// A corrupted length field must not swallow the next frame
+	bad = stream;
+	bad[starts[31] + 16] = 0xFF;  // frame 31 claims a huge payload
+	MLX90641_StreamDecoder dec3;
+	CHECK(feed(dec3, bad.data(), bad.size()) == 79);
+	CHECK(dec3.header.seq == 1079);
+
+	// Text between frames (e.g. Serial.println() from the sketch) is skipped
+	const char *text = "Refresh rate adjusted.\r\n";
+	std::vector<uint8_t> mixed(text, text + strlen(text));
+	mixed.insert(mixed.end(), stream.begin(), stream.begin() + starts[3]);
+	mixed.insert(mixed.end(), text, text + strlen(text));
+	mixed.insert(mixed.end(), stream.begin() + starts[3], stream.end());
+	MLX90641_StreamDecoder dec4;
+	CHECK(feed(dec4, mixed.data(), mixed.size()) == 80);
+	CHECK(dec4.skippedBytes == 2 * strlen(text));
+
+	// Frames the sketch chooses not to send do not break the delta chain
+	MLX90641_StreamEncoder enc2;
+	MLX90641_StreamDecoder dec5;
+	for (int k = 0; k < 20; k += 3) {
+		makeFrame(k, T);
+		size_t n = enc2.encode(T, 25.0f, k, k, 0, STREAM_DELTA, buf);
+		CHECK(feed(dec5, buf, n) == 1);
+		CHECK(dec5.pixels[7] == enc2.toUnits(T[7]));
+	}
+	CHECK(dec5.missingReference == 0 && dec5.header.encoding == STREAM_DELTA && dec5.header.ref == 3);
+
+	// The same frame sent twice (e.g. streamFrame(latestFrame()) before a new frame is ready) goes out as an
+	// absolute frame, and the delta chain carries on after it
+	makeFrame(21, T);
+	size_t n = enc2.encode(T, 25.0f, 21, 21, 0, STREAM_DELTA, buf);
+	CHECK(feed(dec5, buf, n) == 1);
+	n = enc2.encode(T, 25.0f, 21, 21, 0, STREAM_DELTA, buf);
+	CHECK((buf[2] & 0x0F) == STREAM_ABSOLUTE && feed(dec5, buf, n) == 1);
+	for (int k = 22; k < 25; k++) {
+		makeFrame(k, T);
+		n = enc2.encode(T, 25.0f, k, k, 0, STREAM_DELTA, buf);
+		CHECK((buf[2] & 0x0F) == STREAM_DELTA && feed(dec5, buf, n) == 1);
+		for (int i = 0; i < STREAM_PIXELS; i++) CHECK(dec5.pixels[i] == enc2.toUnits(T[i]));
+	}
+	CHECK(dec5.missingReference == 0 && dec5.crcErrors == 0);
+
+	// streamFrame() from the library: the published frame comes back within 0.005°C
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	Wire.setClock(400000);
+	MLX90641 cam;
+	CHECK(cam.calibrate());
+	MLX90641_FrameStore frames;
+	cam.setFrameStore(&frames);
+	MLX90641_StreamEncoder camStream;
+	CapturePrint out;
+	MLX90641_StreamDecoder dec6;
+	for (int k = 0; k < 4; k++) {
+		sim.setScene(-169.0f + 50.0f * k, 4.0f);
+		sim.nextFrame();
+		cam.readTempC();
+		const MLX90641_Frame *f = cam.latestFrame();
+		size_t n = cam.streamFrame(f, camStream, out);
+		CHECK(n == out.bytes.size());
+		CHECK(feed(dec6, out.bytes.data(), n) == 1);
+		out.bytes.clear();
+		CHECK(dec6.header.seq == f->seq);
+		CHECK_NEAR(dec6.ambient(), f->Ta, 0.005);
+		for (int i = 0; i < NUM_PIXELS; i++) CHECK_NEAR(dec6.temperature(i), f->T_o[i], 0.005);
+	}
+	CHECK(dec6.header.encoding == STREAM_DELTA);
+	return checkResult("test_stream");
+}
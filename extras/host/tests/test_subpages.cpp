@@ -0,0 +1,70 @@
+// test_subpages.cpp - subpage merge (setSubpageMode()): which subpage each pixel of T_o comes from, first frame included
+#include "test_util.h"
+
+// Raw words of subpage sp for scene k: the two subpages see different scenes, and every scene differs from the last
+static void serve(SimMLX90641 &sim, int sp, int k) {
+	for (int i = 0; i < NUM_PIXELS; i++) {
+		int16_t raw = (sp == 0) ? (int16_t)(-1000 + 10 * (i % 16) + 200 * k) : (int16_t)(600 + 15 * (i / 16) + 200 * k);
+		sim.setPixel(sp, i, raw);
+	}
+}
+
+// Subpage pixel i is taken from (SUBPAGE_CHESS and SUBPAGE_INTERLEAVED)
+static int source(uint8_t mode, int i) {
+	int row = i / 16, col = i % 16;
+	return (mode == SUBPAGE_CHESS) ? ((row + col) & 1) : (row & 1);
+}
+
+int main() {
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	Wire.setClock(400000);
+
+	MLX90641 cam;
+	CHECK(cam.calibrate());
+	CHECK(!cam.setSubpageMode(SUBPAGE_AVERAGE + 1));
+	const uint8_t modes[4] = { SUBPAGE_LATEST, SUBPAGE_CHESS, SUBPAGE_INTERLEAVED, SUBPAGE_AVERAGE };
+	for (int m = 0; m < 4; m++) {
+		MLX90641 merged, latest;  // latest: the result of each subpage on its own
+		CHECK(merged.calibrate() && latest.calibrate());
+		CHECK(merged.setSubpageMode(modes[m]));
+		float T_sp[2][NUM_PIXELS];
+		for (int k = 0; k < 5; k++) {
+			int sp = (sim.status() & 1) ^ 1;  // subpage of the next frame
+			serve(sim, sp, k);
+			sim.nextFrame();
+			latest.readTempC();
+			merged.readTempC();
+			CHECK(merged.subpage == sp && latest.subpage == sp);
+			for (int i = 0; i < NUM_PIXELS; i++) T_sp[sp][i] = latest.T_o[i];
+			for (int i = 0; i < NUM_PIXELS; i++) {
+				CHECK(merged.T_o_SP[sp][i] == T_sp[sp][i]);
+				float expected = T_sp[sp][i];  // first frame: the other subpage has no result yet, nothing to merge
+				if (k > 0 && modes[m] == SUBPAGE_AVERAGE) expected = 0.5f * (T_sp[sp][i] + T_sp[sp ^ 1][i]);
+				else if (k > 0 && modes[m] != SUBPAGE_LATEST) expected = T_sp[source(modes[m], i)][i];
+				CHECK(merged.T_o[i] == expected);
+			}
+		}
+		for (int i = 0; i < NUM_PIXELS; i++) CHECK(T_sp[0][i] < T_sp[1][i] - 10.0f);  // the source of every pixel shows
+		if (modes[m] == SUBPAGE_CHESS) CHECK(merged.T_o[0] == T_sp[0][0] && merged.T_o[1] == T_sp[1][1] && merged.T_o[16] == T_sp[1][16] && merged.T_o[17] == T_sp[0][17]);
+		if (modes[m] == SUBPAGE_INTERLEAVED) CHECK(merged.T_o[1] == T_sp[0][1] && merged.T_o[16] == T_sp[1][16]);
+	}
+
+	// Switching to a merge later on uses the other subpage's last result right away
+	MLX90641 later;
+	CHECK(later.calibrate());
+	serve(sim, (sim.status() & 1) ^ 1, 0);
+	sim.nextFrame();
+	later.readTempC();
+	float first[NUM_PIXELS];
+	for (int i = 0; i < NUM_PIXELS; i++) first[i] = later.T_o[i];
+	CHECK(later.setSubpageMode(SUBPAGE_INTERLEAVED));
+	int sp = (sim.status() & 1) ^ 1;
+	serve(sim, sp, 1);
+	sim.nextFrame();
+	later.readTempC();
+	for (int i = 0; i < NUM_PIXELS; i++) CHECK(later.T_o[i] == ((i / 16) % 2 == sp ? later.T_o_SP[sp][i] : first[i]));
+	return checkResult("test_subpages");
+}
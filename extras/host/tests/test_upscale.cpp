@@ -0,0 +1,105 @@
+// test_upscale.cpp - frame upscaling: identity, flat and linear frames, bilinear midpoints, bicubic overshoot
+#include "test_util.h"
+#include "MLX90641_Upscale.h"
+
+static int16_t out[UPSCALE_MAX_WIDTH * UPSCALE_MAX_HEIGHT];
+
+int main() {
+	MLX90641_Upscaler up;
+	CHECK(!up.begin(8, 6) && !up.begin(UPSCALE_MAX_WIDTH + 1, 96) && !up.begin(64, 48, 2));
+	CHECK(up.width == 0);
+
+	int16_t in[NUM_PIXELS];
+	for (int i = 0; i < NUM_PIXELS; i++) in[i] = (int16_t)(2000 + 37 * (i % 16) - 11 * (i / 16) + ((i * 7919) % 13) * 50);
+
+	// At 16x12 both kernels sample the pixel centres: the frame comes back unchanged
+	for (uint8_t kernel = UPSCALE_BILINEAR; kernel <= UPSCALE_BICUBIC; kernel++) {
+		CHECK(up.begin(16, 12, kernel));
+		up.upscale(in, out);
+		for (int i = 0; i < NUM_PIXELS; i++) CHECK(out[i] == in[i]);
+	}
+
+	// A flat frame stays exactly flat, at any size
+	int16_t flat[NUM_PIXELS];
+	for (int i = 0; i < NUM_PIXELS; i++) flat[i] = -1234;
+	const uint16_t sizes[3][2] = { { 64, 48 }, { 128, 96 }, { 37, 29 } };
+	for (int s = 0; s < 3; s++) {
+		for (uint8_t kernel = UPSCALE_BILINEAR; kernel <= UPSCALE_BICUBIC; kernel++) {
+			CHECK(up.begin(sizes[s][0], sizes[s][1], kernel));
+			up.upscale(flat, out);
+			for (int i = 0; i < sizes[s][0] * sizes[s][1]; i++) CHECK(out[i] == -1234);
+		}
+	}
+
+	// A linear ramp is reproduced (to the rounding) away from the border by both kernels
+	int16_t ramp[NUM_PIXELS];
+	for (int i = 0; i < NUM_PIXELS; i++) ramp[i] = (int16_t)(100 * (i % 16) + 40 * (i / 16));
+	for (uint8_t kernel = UPSCALE_BILINEAR; kernel <= UPSCALE_BICUBIC; kernel++) {
+		CHECK(up.begin(64, 48, kernel));
+		up.upscale(ramp, out);
+		for (int y = 8; y < 40; y++) {
+			for (int x = 8; x < 56; x++) {
+				double sx = (x + 0.5) / 4.0 - 0.5, sy = (y + 0.5) / 4.0 - 0.5;
+				CHECK_NEAR(out[y * 64 + x], 100.0 * sx + 40.0 * sy, 1.01);
+			}
+		}
+	}
+
+	// Bilinear 2x: each output pixel mixes its two nearest pixels 3:1 along each axis
+	CHECK(up.begin(32, 24, UPSCALE_BILINEAR));
+	up.upscale(in, out);
+	for (int y = 1; y < 23; y++) {
+		for (int x = 1; x < 31; x++) {
+			int c0 = (x - 1) / 2, c1 = c0 + 1, r0 = (y - 1) / 2, r1 = r0 + 1;
+			double fx = (x % 2) ? 0.25 : 0.75, fy = (y % 2) ? 0.25 : 0.75;
+			double top = in[r0 * 16 + c0] * (1 - fx) + in[r0 * 16 + c1] * fx;
+			double bottom = in[r1 * 16 + c0] * (1 - fx) + in[r1 * 16 + c1] * fx;
+			CHECK_NEAR(out[y * 32 + x], top * (1 - fy) + bottom * fy, 1.01);
+		}
+	}
+
+	// Bicubic overshoots a sharp step a little, bilinear never does
+	int16_t step[NUM_PIXELS];
+	for (int i = 0; i < NUM_PIXELS; i++) step[i] = (i % 16 < 8) ? 0 : 10000;
+	CHECK(up.begin(128, 96, UPSCALE_BICUBIC));
+	up.upscale(step, out);
+	int16_t hi = 0, lo = 0;
+	for (int i = 0; i < 128 * 96; i++) {
+		if (out[i] > hi) hi = out[i];
+		if (out[i] < lo) lo = out[i];
+	}
+	printf("bicubic step overshoot: %d / 10000\n", hi - 10000);
+	CHECK(hi > 10000 && hi < 10800 && lo < 0 && lo > -800);
+	CHECK(up.begin(128, 96, UPSCALE_BILINEAR));
+	up.upscale(step, out);
+	for (int i = 0; i < 128 * 96; i++) CHECK(out[i] >= 0 && out[i] <= 10000);
+
+	// From temperatures: scale sets the units, NaN counts as 0
+	float T[NUM_PIXELS];
+	for (int i = 0; i < NUM_PIXELS; i++) T[i] = 25.0f;
+	T[40] = NAN;
+	up.scale = 10;
+	CHECK(up.begin(16, 12));
+	up.upscale(T, out);
+	CHECK(out[0] == 250 && out[40] == 0);
+
+	// Straight from the compensated frame of a sensor
+	SimMLX90641 sim;
+	sim.loadDatasheetExample();
+	sim.setAutoFrames(false);
+	Wire.attach(&sim);
+	MLX90641 cam;
+	CHECK(cam.calibrate());
+	sim.setScene(-169.0f, 4.0f);
+	sim.nextFrame();
+	cam.readTempC();
+	up.scale = 100;
+	CHECK(up.begin(64, 48, UPSCALE_BICUBIC));
+	up.upscale(cam.T_o, out);
+	static int16_t ref[64 * 48];
+	int16_t units[NUM_PIXELS];
+	for (int i = 0; i < NUM_PIXELS; i++) units[i] = (int16_t)lroundf(cam.T_o[i] * 100.0f);
+	up.upscale(units, ref);
+	for (int i = 0; i < 64 * 48; i++) CHECK(out[i] == ref[i]);
+	return checkResult("test_upscale");
+}
@@ -0,0 +1,65 @@
+// test_util.h - shared helpers for the host tests: CHECK macros, sensor setup and a double-precision reference
+#ifndef test_util_h
+#define test_util_h
+
+#include <vector>
+#include <Arduino.h>
+#include <Wire.h>
+#include "MLX90641.h"
+#include "SimMLX90641.h"
+
+static int checkFailures = 0;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(value, expected, tol) \
+	do { \
+		double v_ = (double)(value), e_ = (double)(expected); \
+		if (!(fabs(v_ - e_) <= (double)(tol))) { \
+			printf("%s:%d: %s = %.10g, expected %.10g (tolerance %g)\n", __FILE__, __LINE__, #value, v_, e_, (double)(tol)); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+// Print the summary and return the process exit code
+static int checkResult(const char *name) {
+	if (checkFailures == 0) printf("%s: all checks passed\n", name);
+	else printf("%s: %d check(s) failed\n", name, checkFailures);
+	return checkFailures == 0 ? 0 : 1;
+}
+
+// Collects everything written to it (e.g. the output of streamFrame())
+class CapturePrint : public Print {
+	public:
+	std::vector<uint8_t> bytes;
+	size_t write(uint8_t c) { bytes.push_back(c); return 1; }
+};
+
+// T_o of pixel i (°C, before post-hoc calibration) from the last frame snapshot, in double precision,
+// straight from datasheet 11.2.2.5 .. 11.2.2.9.1 (with the library's alpha_comp limit)
+static inline double referenceTo(const MLX90641 &cam, int i) {
+	int16_t raw = (int16_t)cam.frameData[32 * cam.subpage + i + (i & ~31)];
+	int16_t CP = (int16_t)cam.frameData[0x0588 - FRAME_ADDR];
+	double dTa = cam.Ta - 25.0, dV = cam.Vdd - 3.3;
+	double CP_OS = CP * (double)cam.Kgain - cam.pix_OS_ref_CP * (1.0 + cam.KTa_CP * dTa) * (1.0 + cam.Kv_CP * dV);
+	double pix_OS = raw * (double)cam.Kgain - cam.pixCal.offset[cam.subpage][i] * (1.0 + cam.pixCal.Kta[i] * dTa) * (1.0 + cam.pixCal.Kv[i] * dV);
+	double V_IR = (pix_OS - cam.TGC * CP_OS) / cam.Emissivity;
+	double alpha = cam.pixCal.alpha[i] * (1.0 + cam.KsTa * dTa);
+	if (alpha < ALPHA_COMP_MIN) alpha = ALPHA_COMP_MIN;
+	double Ta4 = pow(cam.Ta + 273.15, 4.0), Tr4 = pow(cam.Ta + 268.15, 4.0);
+	double Ta_r = Tr4 - (Tr4 - Ta4) / cam.Emissivity;
+	double S_x = cam.KsTo[2] * pow(pow(alpha, 3.0) * V_IR + pow(alpha, 4.0) * Ta_r, 0.25);
+	double T = pow(V_IR / (alpha * (1.0 - cam.KsTo[2] * 273.15) + S_x) + Ta_r, 0.25) - 273.15;
+	int r = 0;
+	for (int k = 1; k < 8; k++) r += (T >= cam.CT[k]);
+	if (r != 2) T = pow(V_IR / (alpha * cam.Alpha_cr[r] * (1.0 + cam.KsTo[r] * (T - cam.CT[r]))) + Ta_r, 0.25) - 273.15;
+	return T;
+}
+
+#endif
@@ -0,0 +1,148 @@
+// raw_reprocess.cpp - compensate a recorded raw session again, with other settings, on all CPU cores
+//   raw_reprocess [options] session.raw
+//     --threads N          worker threads (default: all cores)
+//     --emissivity E       emissivity (default: the recorded calibration's)
+//     --slope S            post-hoc calibration slope (default: the recorded one)
+//     --intercept I        post-hoc calibration intercept (default: the recorded one)
+//     --bad i,j,...        flag these pixels by hand, on top of the recorded defect map
+//     --defect-window N    detect dead/stuck/outlier pixels over N frames, as on the sensor (runs on one thread;
+//                          default: the recorded window, 0 keeps the recorded defect map as it is)
+//     --subpage-mode M     combine the subpages with SUBPAGE_* mode M (default: the recorded one)
+//     --csv FILE           one line per frame: seq,timestamp_ms,Ta,p0,...,p191 (°C, round-trips exactly)
+//     --bin FILE           columnar binary: "MLXC", version, frames, columns (uint32 each), then one column at a
+//                          time: seq and timestamp (uint32), Ta and p0..p191 (float), little-endian
+// The session file is memory-mapped. The recorded settings and the throughput (frames/s) go to stderr.
+#include <chrono>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "raw_session.h"
+
+#define COLUMNAR_MAGIC "MLXC"
+#define COLUMNAR_VERSION 1
+
+static bool writeCsv(const char *path, const RawSession &s, const float *Ta, const float *T) {
+	FILE *out = fopen(path, "w");
+	if (out == NULL) return false;
+	for (size_t k = 0; k < s.numFrames; k++) {
+		fprintf(out, "%u,%u,%.9g", (unsigned)s.frames[k].seq, (unsigned)s.frames[k].timestamp, Ta[k]);
+		for (int i = 0; i < NUM_PIXELS; i++) fprintf(out, ",%.9g", T[k * NUM_PIXELS + i]);
+		fputc('\n', out);
+	}
+	return fclose(out) == 0;
+}
+
+static bool writeColumnar(const char *path, const RawSession &s, const float *Ta, const float *T) {
+	FILE *out = fopen(path, "wb");
+	if (out == NULL) return false;
+	uint32_t header[3] = { COLUMNAR_VERSION, (uint32_t)s.numFrames, 3 + NUM_PIXELS };
+	fwrite(COLUMNAR_MAGIC, 1, 4, out);
+	fwrite(header, sizeof(header), 1, out);
+	std::vector<uint32_t> u(s.numFrames);
+	for (size_t k = 0; k < s.numFrames; k++) u[k] = s.frames[k].seq;
+	fwrite(u.data(), sizeof(uint32_t), u.size(), out);
+	for (size_t k = 0; k < s.numFrames; k++) u[k] = s.frames[k].timestamp;
+	fwrite(u.data(), sizeof(uint32_t), u.size(), out);
+	fwrite(Ta, sizeof(float), s.numFrames, out);
+	std::vector<float> column(s.numFrames);
+	for (int i = 0; i < NUM_PIXELS; i++) {
+		for (size_t k = 0; k < s.numFrames; k++) column[k] = T[k * NUM_PIXELS + i];
+		fwrite(column.data(), sizeof(float), column.size(), out);
+	}
+	return fclose(out) == 0;
+}
+
+int main(int argc, char **argv) {
+	ReprocessOptions options;
+	options.threads = std::thread::hardware_concurrency();
+	const char *session = NULL, *csv = NULL, *bin = NULL;
+	for (int a = 1; a < argc; a++) {
+		bool more = a + 1 < argc;
+		if (strcmp(argv[a], "--threads") == 0 && more) {
+			options.threads = (unsigned)atoi(argv[++a]);
+		} else if (strcmp(argv[a], "--emissivity") == 0 && more) {
+			options.emissivity = (float)atof(argv[++a]);
+		} else if (strcmp(argv[a], "--slope") == 0 && more) {
+			options.slope = (float)atof(argv[++a]);
+		} else if (strcmp(argv[a], "--intercept") == 0 && more) {
+			options.intercept = (float)atof(argv[++a]);
+		} else if (strcmp(argv[a], "--bad") == 0 && more) {
+			for (char *p = strtok(argv[++a], ","); p != NULL; p = strtok(NULL, ",")) {
+				int i = atoi(p);
+				if (i >= 0 && i < NUM_PIXELS) options.badPixels[i] = 1;
+			}
+		} else if (strcmp(argv[a], "--defect-window") == 0 && more) {
+			options.defectWindow = atoi(argv[++a]);
+		} else if (strcmp(argv[a], "--subpage-mode") == 0 && more) {
+			options.subpageMode = atoi(argv[++a]);
+		} else if (strcmp(argv[a], "--csv") == 0 && more) {
+			csv = argv[++a];
+		} else if (strcmp(argv[a], "--bin") == 0 && more) {
+			bin = argv[++a];
+		} else {
+			session = argv[a];
+		}
+	}
+	if (session == NULL || (csv == NULL && bin == NULL)) {
+		fprintf(stderr, "usage: raw_reprocess [--threads N] [--emissivity E] [--slope S] [--intercept I] [--bad i,j,...] [--defect-window N] [--subpage-mode M] [--csv FILE] [--bin FILE] session.raw\n");
+		return 1;
+	}
+	if (options.defectWindow < -1 || options.defectWindow > 255) {
+		fprintf(stderr, "--defect-window: 0..255 frames\n");
+		return 1;
+	}
+	if (options.subpageMode < -1 || options.subpageMode > SUBPAGE_AVERAGE) {
+		fprintf(stderr, "--subpage-mode: 0..%d\n", SUBPAGE_AVERAGE);
+		return 1;
+	}
+
+	int fd = open(session, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		perror(session);
+		return 1;
+	}
+	size_t size = (size_t)st.st_size;
+	void *map = (size > 0) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "%s: cannot map the file\n", session);
+		return 1;
+	}
+	RawSession s;
+	if (!openSession((const uint8_t *)map, size, &s)) {
+		fprintf(stderr, "%s: not a raw session, or the calibration or the settings are damaged\n", session);
+		return 1;
+	}
+	const MLX90641_PipelineSettings &rec = *s.settings;
+	fprintf(stderr, "recorded: subpage mode %u, refresh policy %u (every %u), defect window %u, calibration %g x + %g, filter %u\n",
+	        rec.subpageMode, rec.refreshPolicy, rec.refreshEveryN, rec.defectWindow, rec.calSlope, rec.calIntercept, rec.filterMode);
+
+	std::vector<float> Ta(s.numFrames), T(s.numFrames * NUM_PIXELS);
+	auto t0 = std::chrono::steady_clock::now();
+	unsigned threads = reprocessSession(s, options, Ta.data(), T.data());
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	if (threads == 0) {
+		fprintf(stderr, "%s: cannot import the calibration or the settings\n", session);
+		return 1;
+	}
+	fprintf(stderr, "%zu frames on %u thread(s) in %.3f s: %.0f frames/s\n", s.numFrames, threads, seconds, seconds > 0 ? s.numFrames / seconds : 0.0);
+
+	bool ok = true;
+	if (csv != NULL && !writeCsv(csv, s, Ta.data(), T.data())) {
+		perror(csv);
+		ok = false;
+	}
+	if (bin != NULL && !writeColumnar(bin, s, Ta.data(), T.data())) {
+		perror(bin);
+		ok = false;
+	}
+	munmap(map, size);
+	close(fd);
+	return ok ? 0 : 1;
+}
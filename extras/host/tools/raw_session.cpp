@@ -0,0 +1,86 @@
+// raw_session.cpp - recorded raw sessions and their multi-threaded reprocessing on the host. See raw_session.h.
+#include <math.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "raw_session.h"
+
+ReprocessOptions::ReprocessOptions() {
+	threads = 1;
+	emissivity = NAN;
+	slope = NAN;
+	intercept = NAN;
+	memset(badPixels, 0, sizeof(badPixels));
+	defectWindow = -1;
+	subpageMode = -1;
+}
+
+bool openSession(const uint8_t *data, size_t size, RawSession *session) {
+	const size_t header = sizeof(MLX90641_CalibrationExport) + sizeof(MLX90641_PipelineSettings);
+	if (size < header) return false;
+	session->cal = (const MLX90641_CalibrationExport *)data;
+	session->settings = (const MLX90641_PipelineSettings *)(data + sizeof(MLX90641_CalibrationExport));
+	session->frames = (const MLX90641_RawFrame *)(data + header);
+	session->numFrames = (size - header) / sizeof(MLX90641_RawFrame);
+	MLX90641 check;
+	MLX90641_Filter filter;
+	return check.importCalibration(session->cal) && check.importSettings(session->settings, &filter);
+}
+
+// One worker: frames from..first+count-1, in order, on its own sensor object. Frames before first only warm up
+// the state carried to the next frame, their results are not stored.
+static void reprocessRun(MLX90641 *cam, const MLX90641_RawFrame *frames, size_t from, size_t first, size_t count, float *Ta, float *T) {
+	for (size_t k = from; k < first + count; k++) {
+		cam->compensateRaw(&frames[k]);
+		if (k < first) continue;
+		Ta[k] = cam->Ta;
+		memcpy(&T[k * NUM_PIXELS], cam->T_o, sizeof(cam->T_o));
+	}
+}
+
+unsigned reprocessSession(const RawSession &session, const ReprocessOptions &options, float *Ta, float *T) {
+	const MLX90641_PipelineSettings &rec = *session.settings;
+	int window = (options.defectWindow >= 0) ? options.defectWindow : rec.defectWindow;
+	int subpageMode = (options.subpageMode >= 0) ? options.subpageMode : rec.subpageMode;
+	bool sequential = window != 0 || rec.filterMode != FILTER_NONE || rec.refreshPolicy != REFRESH_EVERY_FRAME;
+	unsigned threads = (options.threads == 0 || sequential) ? 1 : options.threads;
+	if (threads > session.numFrames) threads = session.numFrames ? (unsigned)session.numFrames : 1;
+	// The sensor objects are set up here, on one thread: the constructor fills a table shared by all of them
+	std::vector<MLX90641 *> cams;
+	std::vector<MLX90641_Filter *> filters;
+	bool ok = true;
+	for (unsigned t = 0; t < threads && ok; t++) {
+		MLX90641 *cam = new MLX90641();
+		MLX90641_Filter *filter = new MLX90641_Filter();
+		cams.push_back(cam);
+		filters.push_back(filter);
+		ok = cam->importCalibration(session.cal) && cam->importSettings(session.settings, filter);
+		if (!isnan(options.emissivity)) cam->Emissivity = options.emissivity;
+		if (!isnan(options.slope)) cam->calSlope = options.slope;
+		if (!isnan(options.intercept)) cam->calIntercept = options.intercept;
+		for (int i = 0; i < NUM_PIXELS; i++) {
+			if (options.badPixels[i]) cam->badPixels[i] |= DEFECT_MANUAL;
+		}
+		if (options.defectWindow >= 0) ok = ok && cam->setDefectWindow((uint16_t)options.defectWindow, rec.defectOutlier);
+		if (options.subpageMode >= 0) ok = ok && cam->setSubpageMode((uint8_t)options.subpageMode);
+	}
+	if (ok) {
+		std::vector<std::thread> pool;
+		size_t chunk = (session.numFrames + threads - 1) / threads;
+		for (unsigned t = 0; t < threads; t++) {
+			size_t first = t * chunk;
+			size_t count = (first >= session.numFrames) ? 0 : (session.numFrames - first < chunk) ? session.numFrames - first : chunk;
+			// A merge needs the last result of both subpages: start at the last frame of the subpage not seen last
+			size_t from = first;
+			uint8_t seen = 0;
+			while (subpageMode != SUBPAGE_LATEST && count > 0 && from > 0 && seen != 3) seen |= 1 << (session.frames[--from].status & 0x01);
+			pool.push_back(std::thread(reprocessRun, cams[t], session.frames, from, first, count, Ta, T));
+		}
+		for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+	}
+	for (size_t t = 0; t < cams.size(); t++) {
+		delete cams[t];
+		delete filters[t];
+	}
+	return ok ? threads : 0;
+}
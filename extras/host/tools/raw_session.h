@@ -0,0 +1,45 @@
+// raw_session.h - recorded raw sessions and their multi-threaded reprocessing on the host
+// A session is one MLX90641_CalibrationExport and one MLX90641_PipelineSettings followed by MLX90641_RawFrame
+// records, back to back (see MLX90641.h). The recording sensor calls beginRecording() just before the first raw
+// frame, so its frame-to-frame state starts where importSettings() starts it. Each worker thread gets its own MLX90641 object and a contiguous run of
+// frames, and runs compensateRaw() on them: the same code as readTempC() on the sensor.
+#ifndef raw_session_h
+#define raw_session_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "MLX90641.h"
+
+// A session mapped in memory (nothing is copied)
+struct RawSession {
+	const MLX90641_CalibrationExport *cal;  // calibration of the recording sensor
+	const MLX90641_PipelineSettings *settings;  // pipeline settings of the recording sensor
+	const MLX90641_RawFrame *frames;     // frames in recording order
+	size_t numFrames;
+};
+
+// Settings applied before reprocessing (defaults: everything as recorded)
+struct ReprocessOptions {
+	ReprocessOptions();
+	unsigned threads;                    // worker threads (1 when state carries across many frames, see reprocessSession())
+	float emissivity;                    // NAN: the recorded calibration's
+	float slope;                         // post-hoc calibration (NAN: the recorded one)
+	float intercept;
+	uint8_t badPixels[NUM_PIXELS];       // pixels to flag by hand (DEFECT_MANUAL), on top of the recorded defect map
+	int defectWindow;                    // -1: the recorded one; 0: keep the recorded defect map as it is; otherwise detect defects over this many frames
+	int subpageMode;                     // -1: the recorded one; otherwise SUBPAGE_*
+};
+
+// Map a session stored in data[0..size). Returns false if it is too short, or the calibration or the settings are damaged.
+// A partial frame at the end (e.g. an interrupted recording) is ignored.
+bool openSession(const uint8_t *data, size_t size, RawSession *session);
+
+// Compensate every frame: Ta[k] and T[k * NUM_PIXELS + i] receive frame k's ambient and pixel temperatures, bit
+// for bit as on the recording sensor with the same settings. The defect statistics, the filter and the refresh
+// policies other than REFRESH_EVERY_FRAME carry state across any number of frames, so they run on one thread.
+// With a subpage merge, each thread first compensates the frames before its run back to the last one of each
+// subpage, without storing them. Returns the number of threads used (at most one per frame), or 0 if the
+// calibration or the settings cannot be imported.
+unsigned reprocessSession(const RawSession &session, const ReprocessOptions &options, float *Ta, float *T);
+
+#endif
@@ -0,0 +1,59 @@
+// stream_decode.cpp - convert a binary MLX90641 stream (streamFrame() output, e.g. a serial capture) to CSV
+//   stream_decode [--upscale WxH] [--bicubic] [capture.bin]      (reads stdin without a file name)
+// One line per frame: seq,timestamp_ms,Ta,p0,...,p191 (°C). With --upscale, the pixels are interpolated
+// to W x H first (bilinear, or bicubic with --bicubic), row by row. A summary goes to stderr.
+#include <stdio.h>
+#include <string.h>
+#include "MLX90641_Stream.h"
+#include "MLX90641_Upscale.h"
+
+static int16_t upscaled[UPSCALE_MAX_WIDTH * UPSCALE_MAX_HEIGHT];
+
+int main(int argc, char **argv) {
+	FILE *in = stdin;
+	unsigned width = 0, height = 0;
+	uint8_t kernel = UPSCALE_BILINEAR;
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "--upscale") == 0 && a + 1 < argc) {
+			if (sscanf(argv[++a], "%ux%u", &width, &height) != 2) width = 0;
+		} else if (strcmp(argv[a], "--bicubic") == 0) {
+			kernel = UPSCALE_BICUBIC;
+		} else {
+			in = fopen(argv[a], "rb");
+			if (in == NULL) {
+				perror(argv[a]);
+				return 1;
+			}
+		}
+	}
+	MLX90641_Upscaler upscaler;
+	if (width != 0 && !upscaler.begin(width, height, kernel)) {
+		fprintf(stderr, "--upscale: size must be between %dx%d and %dx%d\n", UPSCALE_IN_WIDTH, UPSCALE_IN_HEIGHT, UPSCALE_MAX_WIDTH, UPSCALE_MAX_HEIGHT);
+		return 1;
+	}
+	MLX90641_StreamDecoder decoder;
+	uint8_t chunk[4096];
+	size_t n, bytes = 0;
+	while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+		bytes += n;
+		for (size_t k = 0; k < n; k++) {
+			if (!decoder.push(chunk[k])) continue;
+			printf("%u,%u,%.2f", (unsigned)decoder.header.seq, (unsigned)decoder.header.timestamp, decoder.ambient());
+			if (width != 0) {
+				upscaler.upscale(decoder.pixels, upscaled);  // same units as the stream
+				for (unsigned i = 0; i < width * height; i++) printf(",%.2f", (float)upscaled[i] / (float)decoder.header.scale);
+			} else {
+				for (int i = 0; i < STREAM_PIXELS; i++) printf(",%.2f", decoder.temperature(i));
+			}
+			printf("\n");
+		}
+	}
+	if (in != stdin) fclose(in);
+	fprintf(stderr, "%u frames, %u bad frame starts, %u delta frames without reference, %u bytes skipped\n",
+	        (unsigned)decoder.frames, (unsigned)decoder.crcErrors, (unsigned)decoder.missingReference, (unsigned)decoder.skippedBytes);
+	if (bytes > 0) {
+		fprintf(stderr, "%.1f bytes per frame, %.2f:1 against 768-byte float frames\n", decoder.frames ? (double)bytes / decoder.frames : 0.0,
+		        (double)decoder.frames * STREAM_PIXELS * sizeof(float) / bytes);
+	}
+	return 0;
+}